@@ -14,6 +14,7 @@ verbose_level_t system_verbose_level = VERBOSE_NONE;
 // ---------- Setup ----------
 void setup() {
     vTaskDelay(1500 / portTICK_PERIOD_MS);  // Wait debugging console
+    termlog_setup();            // Console output of the radio tasks
 
     do_axp_exist = axp_setup(); // Init axp20x and return T-Beam Version
     led_setup(do_axp_exist);    // LED
@@ -32,7 +33,7 @@ void loop() {
     led_blinking_process();     // LED blinking
     cli_interpretation_process();  // Interpret command-line
 
-    ebyte_process();            // Store & passing data between uC & Ebyte module
+    ebyte_report_process();     // Data between uC & Ebyte module goes in the radio tasks.
     gps_decoding_process();     // Decode GPS message to print
 
     taskYIELD();
@@ -0,0 +1,269 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Selective-repeat ARQ over the half-duplex radio link.
+ *
+ * The sender keeps up to 'window' frames in flight, each retransmitted on its own timer,
+ *     RTO = SRTT + 4 * RTTVAR (Jacobson), doubled on every retry; retransmitted frames give no RTT sample (Karn).
+ * The receiver delivers payloads in order, buffering the ones that come ahead of a hole.
+ */
+#include "arq.h"
+
+
+#define SEQ_BEFORE(a, b)    ((int8_t)((uint8_t)(a) - (uint8_t)(b)) < 0)
+
+
+void arq_init(arq_t *a) {
+    memset(a, 0, sizeof(arq_t));
+    a->window = ARQ_WINDOW_MAX;
+    a->rto_ms = ARQ_RTO_INIT_MS;
+    for (uint8_t i = 0; i < ARQ_WINDOW_MAX; i++) {
+        a->tx[i].handle = -1;
+    }
+}
+
+
+/**
+ * @brief Frames in flight; about what fits in a round trip, as the other end answers only on its turn.
+ */
+void arq_set_window(arq_t *a, uint8_t window) {
+    if (window < 1) window = 1;
+    if (window > ARQ_WINDOW_MAX) window = ARQ_WINDOW_MAX;
+    a->window = window;
+}
+
+
+bool arq_can_send(arq_t *a) {
+    return (uint8_t)(a->next_seq - a->base) < a->window;
+}
+
+
+/**
+ * @brief Track a new frame just sent.
+ *
+ * @return Its seq, the one put in its header.
+ */
+uint8_t arq_sent(arq_t *a, int16_t handle, uint16_t len, uint32_t now_ms) {
+    uint8_t seq = a->next_seq++;
+    arq_tx_entry_t *e = &a->tx[seq % ARQ_WINDOW_MAX];
+    e->handle = handle;
+    e->len = len;
+    e->state = ARQ_TX_INFLIGHT;
+    e->retries = 0;
+    e->sent_ms = now_ms;
+    a->stat.sent++;
+    return seq;
+}
+
+
+static void arq_advance_base(arq_t *a) {
+    while (a->base != a->next_seq) {
+        arq_tx_entry_t *e = &a->tx[a->base % ARQ_WINDOW_MAX];
+        if (e->state != ARQ_TX_DONE  ||  e->handle >= 0) break;  // Wait for its handle to be popped.
+        e->state = ARQ_TX_FREE;
+        a->base++;
+    }
+}
+
+
+/**
+ * @brief The oldest frame whose timer has run out; frames out of retries are given up here.
+ *
+ * @return Its handle, or -1
+ */
+int arq_due(arq_t *a, uint32_t now_ms, uint8_t *seq) {
+    for (uint8_t s = a->base; s != a->next_seq; s++) {
+        arq_tx_entry_t *e = &a->tx[s % ARQ_WINDOW_MAX];
+        if (e->state != ARQ_TX_INFLIGHT) continue;
+
+        uint32_t rto = a->rto_ms << e->retries;
+        if (rto > ARQ_RTO_MAX_MS) rto = ARQ_RTO_MAX_MS;
+        if (now_ms - e->sent_ms < rto) continue;
+
+        if (e->retries >= ARQ_MAX_RETRIES) {
+            e->state = ARQ_TX_DONE;
+            a->stat.gave_up++;
+            continue;
+        }
+        *seq = s;
+        return e->handle;
+    }
+    return -1;
+}
+
+
+void arq_resent(arq_t *a, uint8_t seq, uint32_t now_ms) {
+    arq_tx_entry_t *e = &a->tx[seq % ARQ_WINDOW_MAX];
+    e->retries++;
+    e->sent_ms = now_ms;
+    a->stat.retransmits++;
+}
+
+
+/**
+ * @brief Hand back the handle of a frame acked or given up, one at a time.
+ *
+ * @return The handle, or -1
+ */
+int arq_pop_done(arq_t *a) {
+    for (uint8_t s = a->base; s != a->next_seq; s++) {
+        arq_tx_entry_t *e = &a->tx[s % ARQ_WINDOW_MAX];
+        if (e->state == ARQ_TX_DONE  &&  e->handle >= 0) {
+            int handle = e->handle;
+            e->handle = -1;
+            return handle;
+        }
+    }
+    arq_advance_base(a);
+    return -1;
+}
+
+
+bool arq_ack_due(arq_t *a, uint32_t now_ms) {
+    return a->ack_pending  &&  (int32_t)(now_ms - a->ack_due_ms) >= 0;
+}
+
+
+void arq_header(arq_t *a, uint8_t *out, bool data, uint8_t seq) {
+    uint8_t sack = 0;
+    if (a->rx_synced) {
+        for (uint8_t i = 0; i < ARQ_WINDOW_MAX; i++) {
+            const arq_rx_slot_t *slot = &a->rx[(uint8_t)(a->expected + 1 + i) % ARQ_WINDOW_MAX];
+            if (slot->used  &&  slot->seq == (uint8_t)(a->expected + 1 + i)) sack |= 1 << i;
+        }
+    }
+
+    out[0] = ((data)? ARQ_F_DATA : 0) | ((a->rx_synced)? ARQ_F_ACK : 0) | ((a->tx_synced)? 0 : ARQ_F_SYN);
+    out[1] = seq;
+    out[2] = a->base;
+    out[3] = a->expected;
+    out[4] = sack;
+
+    a->ack_pending = false;
+    if (!data) a->stat.acks_sent++;
+}
+
+
+static void arq_rtt_sample(arq_t *a, uint32_t rtt_ms) {
+    if (!a->rtt_valid) {
+        a->srtt_ms = rtt_ms;
+        a->rttvar_ms = rtt_ms / 2;
+        a->rtt_valid = true;
+    } else {
+        uint32_t err = (rtt_ms > a->srtt_ms)? rtt_ms - a->srtt_ms : a->srtt_ms - rtt_ms;
+        a->rttvar_ms = (3 * a->rttvar_ms + err) / 4;
+        a->srtt_ms = (7 * a->srtt_ms + rtt_ms) / 8;
+    }
+    a->rto_ms = a->srtt_ms + 4 * a->rttvar_ms;
+    if (a->rto_ms < ARQ_RTO_MIN_MS) a->rto_ms = ARQ_RTO_MIN_MS;
+    if (a->rto_ms > ARQ_RTO_MAX_MS) a->rto_ms = ARQ_RTO_MAX_MS;
+}
+
+
+static void arq_take_ack(arq_t *a, uint8_t ack, uint8_t sack, uint32_t now_ms) {
+    if ((uint8_t)(ack - a->base) > (uint8_t)(a->next_seq - a->base)) return;  // Stale, of another session
+    a->tx_synced = true;
+
+    for (uint8_t s = a->base; s != a->next_seq; s++) {
+        arq_tx_entry_t *e = &a->tx[s % ARQ_WINDOW_MAX];
+        if (e->state != ARQ_TX_INFLIGHT) continue;
+
+        uint8_t d = s - ack - 1;
+        if (SEQ_BEFORE(s, ack)  ||  (d < ARQ_WINDOW_MAX  &&  (sack & (1 << d)))) {
+            e->state = ARQ_TX_DONE;
+            a->stat.acked++;
+            a->stat.acked_bytes += e->len;
+            if (e->retries == 0) arq_rtt_sample(a, now_ms - e->sent_ms);
+        }
+    }
+}
+
+
+/**
+ * @brief Take a received frame, header included; NULL just to go on delivering.
+ *     Then arq_rx_next() for the payloads now in order.
+ */
+void arq_rx_begin(arq_t *a, const uint8_t *frame, size_t len, uint32_t now_ms) {
+    a->rx_cur = NULL;
+    if (frame == NULL  ||  len < ARQ_HEADER_LEN) return;
+
+    uint8_t flags = frame[0];
+    uint8_t seq = frame[1];
+    if (flags & ARQ_F_ACK) arq_take_ack(a, frame[3], frame[4], now_ms);
+    if (!(flags & ARQ_F_DATA)) return;
+
+    // Re-sync to a restarted sender
+    uint8_t d = seq - a->expected;
+    if (!a->rx_synced  ||  ((flags & ARQ_F_SYN)  &&  d >= ARQ_WINDOW_MAX  &&  (uint8_t)-d > ARQ_WINDOW_MAX)) {
+        a->rx_synced = true;
+        a->expected = frame[2];
+        for (uint8_t i = 0; i < ARQ_WINDOW_MAX; i++) a->rx[i].used = false;
+        d = seq - a->expected;
+    }
+    if (SEQ_BEFORE(a->expected, frame[2])) a->rx_base = frame[2];  // Holes the sender gave up
+    else a->rx_base = a->expected;
+
+    if (!a->ack_pending) {
+        a->ack_pending = true;
+        a->ack_due_ms = now_ms + ARQ_ACK_DELAY_MS;
+    }
+
+    const uint8_t *payload = &frame[ARQ_HEADER_LEN];
+    size_t payload_len = len - ARQ_HEADER_LEN;
+    arq_rx_slot_t *slot = &a->rx[seq % ARQ_WINDOW_MAX];
+
+    if (d == 0  &&  a->rx_base == a->expected) {  // In order
+        a->rx_cur = payload;
+        a->rx_cur_len = payload_len;
+    }
+    else if (d < ARQ_WINDOW_MAX  &&  payload_len <= ARQ_SLOT_SIZE) {  // Ahead of a hole
+        if (slot->used  &&  slot->seq == seq) {
+            a->stat.duplicates++;
+        } else {
+            slot->used = true;
+            slot->seq = seq;
+            slot->len = payload_len;
+            memcpy(slot->data, payload, payload_len);
+            a->stat.reordered++;
+        }
+    }
+    else {  // Delivered already, or too far ahead
+        a->stat.duplicates++;
+    }
+}
+
+
+/**
+ * @return true with the next payload in order, valid until the next arq_rx_begin().
+ */
+bool arq_rx_next(arq_t *a, const uint8_t **payload, size_t *len) {
+    while (true) {
+        if (a->rx_cur != NULL) {
+            *payload = a->rx_cur;
+            *len = a->rx_cur_len;
+            a->rx_cur = NULL;
+            a->expected++;
+            a->rx_base = a->expected;
+            a->stat.delivered++;
+            return true;
+        }
+
+        arq_rx_slot_t *slot = &a->rx[a->expected % ARQ_WINDOW_MAX];
+        if (slot->used  &&  slot->seq == a->expected) {
+            slot->used = false;
+            *payload = slot->data;
+            *len = slot->len;
+            a->expected++;
+            if (SEQ_BEFORE(a->rx_base, a->expected)) a->rx_base = a->expected;
+            a->stat.delivered++;
+            return true;
+        }
+
+        if (SEQ_BEFORE(a->expected, a->rx_base)) {  // Skip the hole.
+            a->expected++;
+            a->stat.skipped++;
+            continue;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef __ARQ_H__
+#define __ARQ_H__
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+
+/**
+ * @brief Selective-repeat ARQ, for the reliable mode
+ *
+ * Header, ahead of every framed payload:
+ *     flags, seq, base (sender's oldest unacked seq), ack (next seq expected), sack (bit i: ack+1+i received)
+ * ACKs ride on data frames going the other way, or on ACK-only frames when there is nothing to send.
+ * The sender gives up a frame after ARQ_MAX_RETRIES; its 'base' then tells the receiver to skip the hole.
+ */
+#define ARQ_HEADER_LEN      5
+#define ARQ_WINDOW_MAX      8    // No more than the sack bits
+#define ARQ_SLOT_SIZE       220  // EBYTE_MODULE_BUFFER_SIZE, a reordered payload
+
+#ifndef ARQ_RTO_INIT_MS
+#define ARQ_RTO_INIT_MS     500
+#endif
+#ifndef ARQ_RTO_MIN_MS
+#define ARQ_RTO_MIN_MS      50
+#endif
+#ifndef ARQ_RTO_MAX_MS
+#define ARQ_RTO_MAX_MS      4000
+#endif
+#ifndef ARQ_MAX_RETRIES
+#define ARQ_MAX_RETRIES     6
+#endif
+#ifndef ARQ_ACK_DELAY_MS
+#define ARQ_ACK_DELAY_MS    20  // Let a burst of frames in, then ACK them all at once.
+#endif
+
+#define ARQ_F_DATA  0x01
+#define ARQ_F_ACK   0x02  // 'ack' & 'sack' are valid.
+#define ARQ_F_SYN   0x04  // Nothing acked yet; the receiver may re-sync to 'base'.
+
+typedef struct {
+    uint32_t sent;
+    uint32_t retransmits;
+    uint32_t acked;
+    uint32_t acked_bytes;
+    uint32_t gave_up;
+    uint32_t acks_sent;    // ACK-only frames
+    uint32_t delivered;
+    uint32_t duplicates;
+    uint32_t reordered;
+    uint32_t skipped;      // Holes given up by the sender
+} arq_stat_t;
+
+enum {
+    ARQ_TX_FREE = 0,
+    ARQ_TX_INFLIGHT,
+    ARQ_TX_DONE,
+};
+
+typedef struct {
+    int16_t  handle;  // Of the caller, e.g. a queue block; -1 when handed back.
+    uint16_t len;
+    uint8_t  state;
+    uint8_t  retries;
+    uint32_t sent_ms;
+} arq_tx_entry_t;
+
+typedef struct {
+    bool     used;
+    uint8_t  seq;
+    uint16_t len;
+    uint8_t  data[ARQ_SLOT_SIZE];
+} arq_rx_slot_t;
+
+typedef struct {
+    // Sender
+    uint8_t  window;
+    uint8_t  base;
+    uint8_t  next_seq;
+    bool     tx_synced;  // An ACK has been received.
+    arq_tx_entry_t tx[ARQ_WINDOW_MAX];
+    uint32_t srtt_ms;
+    uint32_t rttvar_ms;
+    uint32_t rto_ms;
+    bool     rtt_valid;
+
+    // Receiver
+    bool     rx_synced;
+    uint8_t  expected;
+    uint8_t  rx_base;  // Of the sender, nothing before it will come again.
+    bool     ack_pending;
+    uint32_t ack_due_ms;
+    const uint8_t *rx_cur;  // In-order payload of the frame being taken, no copy
+    size_t   rx_cur_len;
+    arq_rx_slot_t rx[ARQ_WINDOW_MAX];
+
+    arq_stat_t stat;
+} arq_t;
+
+extern void arq_init(arq_t *a);
+extern void arq_set_window(arq_t *a, uint8_t window);
+extern bool arq_can_send(arq_t *a);
+extern uint8_t arq_sent(arq_t *a, int16_t handle, uint16_t len, uint32_t now_ms);
+extern int  arq_due(arq_t *a, uint32_t now_ms, uint8_t *seq);
+extern void arq_resent(arq_t *a, uint8_t seq, uint32_t now_ms);
+extern int  arq_pop_done(arq_t *a);
+extern bool arq_ack_due(arq_t *a, uint32_t now_ms);
+extern void arq_header(arq_t *a, uint8_t *out, bool data, uint8_t seq);
+extern void arq_rx_begin(arq_t *a, const uint8_t *frame, size_t len, uint32_t now_ms);
+extern bool arq_rx_next(arq_t *a, const uint8_t **payload, size_t *len);
+
+
+#endif  // __ARQ_H__
@@ -23,9 +23,18 @@ Command cmd_axp_show_report;
 Command cmd_ebyte_loopback;
 Command cmd_print_gps;
 Command cmd_message_type;
+Command cmd_ebyte_bench;
+Command cmd_ebyte_lane;
+Command cmd_radio_status;
+Command cmd_flow_control;
+Command cmd_reliable;
+Command cmd_fec;
+Command cmd_ebyte_stats;
+Command cmd_ebyte_counters;
 
 #define DEFAULT_SEND_MESSAGE "0123456789"
 #define DEFAULT_REPORT_COUNT 1
+#define DEFAULT_BENCH_COUNT 100
 
 const static char *help_description[] = {  // TODO: runtime configurable E34 or E28
     "  h|elp",
@@ -50,7 +59,7 @@ const static char *help_description[] = {  // TODO: runtime configurable E34 or
         #endif
 
     "  ch|annel [ch]    -- show or set channel [0-11]",
-    "  ga|p [rxtx_ms] [txtx_ms] -- show or set the gap times, btw RX-TX & TX-TX in ms",
+    "  ga|p [rxtx_ms] [txtx_ms] -- show or pin the gap times, btw RX-TX & TX-TX in ms. 'gap auto' to adapt",
     "  s|end [message]  -- send [def. \"" DEFAULT_SEND_MESSAGE "\"]",
     "  c|onfig          -- get configuration from Ebyte directly",
     "  p|ref [0]        -- save or reset preferences. 0:reset null:save",
@@ -59,6 +68,15 @@ const static char *help_description[] = {  // TODO: runtime configurable E34 or
     "  l|oopback [1|0]  -- show or set the 'send-back' mode",
     "  g|ps [n]         -- print GPS n times. 0:dis -1:always [def. \"" STR(DEFAULT_REPORT_COUNT) "\"]",
     "  ty|pe [n]        -- show or set message type [0=raw | 1=mavlink]",
+    "  b|ench [n] [size] -- send n packets, config-mode vs. transmission-mode path [def. " STR(DEFAULT_BENCH_COUNT) " " STR(EBYTE_MODULE_BUFFER_SIZE) "]",
+    "  la|ne [msgid] [class] [latest] -- show TX lanes, or map a MAVLink msgid to [0=control | 1=telemetry | 2=bulk],"
+        " latest=1 keeps only its newest frame queued",
+    "  ra|dio [ms]      -- show or set the RADIO_STATUS period to the computer, mavlink type only. 0:dis",
+    "  fl|ow [n]        -- show or set the computer flow control [0=none | 1=rts/cts | 2=xon/xoff]",
+    "  rel|iable [1|0]  -- show or set the reliable mode (ARQ), raw type only; both ends alike",
+    "  fe|c [k n]       -- show or set FEC, parity for k data fragments in n, raw type only; both ends alike. n<=k:off",
+    "  st|ats [line|reset] -- latency of the forwarding stages, p50/p90/p99/max in us; 'line' in one parsable line",
+    "  co|unters [reset] -- link counters: packets, bytes, drops by reason, timeouts, overflows; 'reset' shows then zeroes them",
 };
 
 
@@ -121,6 +139,34 @@ void cli_setup() {
 
     cmd_message_type = cli.addCommand("ty/pe", on_cmd_message_type);
     cmd_message_type.addPositionalArgument("type", "");
+
+    cmd_ebyte_bench = cli.addCommand("b/ench", on_cmd_ebyte_bench);
+    cmd_ebyte_bench.addPositionalArgument("n", STR(DEFAULT_BENCH_COUNT));
+    cmd_ebyte_bench.addPositionalArgument("size", STR(EBYTE_MODULE_BUFFER_SIZE));
+
+    cmd_ebyte_lane = cli.addCommand("la/ne", on_cmd_ebyte_lane);
+    cmd_ebyte_lane.addPositionalArgument("msgid", "");
+    cmd_ebyte_lane.addPositionalArgument("class", "");
+    cmd_ebyte_lane.addPositionalArgument("latest", "0");
+
+    cmd_radio_status = cli.addCommand("ra/dio", on_cmd_radio_status);
+    cmd_radio_status.addPositionalArgument("ms", "");
+
+    cmd_flow_control = cli.addCommand("fl/ow", on_cmd_flow_control);
+    cmd_flow_control.addPositionalArgument("mode", "");
+
+    cmd_reliable = cli.addCommand("rel/iable", on_cmd_reliable);
+    cmd_reliable.addPositionalArgument("flag", "");
+
+    cmd_fec = cli.addCommand("fe/c", on_cmd_fec);
+    cmd_fec.addPositionalArgument("k", "");
+    cmd_fec.addPositionalArgument("n", "");
+
+    cmd_ebyte_stats = cli.addCommand("st/ats", on_cmd_ebyte_stats);
+    cmd_ebyte_stats.addPositionalArgument("mode", "");
+
+    cmd_ebyte_counters = cli.addCommand("co/unters", on_cmd_ebyte_counters);
+    cmd_ebyte_counters.addPositionalArgument("mode", "");
 }
 
 // ----------------------------------------------------------------------------
@@ -158,12 +204,14 @@ static void on_cmd_help(cmd *c) {
 // ----------------------------------------------------------------------------
 static void on_cmd_reset(cmd *c) {
     term_println("[CLI] Reset... bye");
+    ebyte_pause();
     ebyte.resetModule();
     ESP.restart();
 }
 
 // ----------------------------------------------------------------------------
 void on_cmd_ebyte_version_info(cmd *c) {
+    ebyte_pause();
     uint32_t old_baud = ebyte.getBpsRate();
     ebyte.setBpsRate(EBYTE_CONFIG_BAUD);
 
@@ -181,6 +229,7 @@ void on_cmd_ebyte_version_info(cmd *c) {
     }
 
     ebyte.setBpsRate(old_baud);
+    ebyte_resume();
 }
 
 // ----------------------------------------------------------------------------
@@ -275,6 +324,10 @@ static void on_cmd_ebyte_time_gap(cmd *c) {
     String param_txtx_ms = cmd.getArgument("txtx_ms").getValue();
 
     long rxtx_ms, txtx_ms;
+    if (param_rxtx_ms == "auto") {
+        ebyte_tbtw_manual = false;
+    }
+    else
     if (extract_int(param_rxtx_ms, &rxtx_ms) == false
     ||  extract_int(param_txtx_ms, &txtx_ms) == false) {
         if (param_rxtx_ms != ""  ||  param_txtx_ms != "") {
@@ -285,10 +338,15 @@ static void on_cmd_ebyte_time_gap(cmd *c) {
     else {
         ebyte_tbtw_rxtx_ms = rxtx_ms;
         ebyte_tbtw_txtx_ms = txtx_ms;
+        ebyte_tbtw_manual = true;
     }
 
+    const gap_estimate_t *est = gap_get_estimate();
+    term_printf("[CLI] Ebyte gap mode: %s" ENDL, (ebyte_tbtw_manual)? "manual" : "auto");
     term_printf("[CLI] Ebyte time between RX & TX=%dms" ENDL, ebyte_tbtw_rxtx_ms);
     term_printf("[CLI] Ebyte time between TX & TX=%dms" ENDL, ebyte_tbtw_txtx_ms);
+    term_printf("[CLI] Ebyte gap estimates: inter_arival=%.1fms busy=%.1fms loss=%.3f backoff=%.2f" ENDL,
+        est->inter_arival_ms, est->busy_ms, est->loss_rate, est->backoff);
 }
 
 // ----------------------------------------------------------------------------
@@ -298,7 +356,9 @@ static void on_cmd_ebyte_send(cmd *c) {
     String msg = arg.getValue();
 
     uint8_t len = msg.length();
-    ResponseStatus status = ebyte.sendMessage(msg.c_str(), len);
+    ebyte_pause();  // Not to interleave with the downlink task
+    ResponseStatus status = ebyte.sendFramedMessage(msg.c_str(), len);
+    ebyte_resume();
     if (status.code != ResponseStatus::SUCCESS) {
         term_print("[CLI] Ebyte send error, E34:");
         term_println(status.desc());
@@ -312,6 +372,7 @@ static void on_cmd_ebyte_send(cmd *c) {
 void on_cmd_ebyte_get_config(cmd *c) {
     Command cmd(c);
 
+    ebyte_pause();
     uint32_t old_baud = ebyte.getBpsRate();
     ebyte.setBpsRate(EBYTE_CONFIG_BAUD);
 
@@ -330,6 +391,7 @@ void on_cmd_ebyte_get_config(cmd *c) {
     }
 
     ebyte.setBpsRate(old_baud);
+    ebyte_resume();
 }
 
 // ----------------------------------------------------------------------------
@@ -460,3 +522,232 @@ static void on_cmd_message_type(cmd *c) {
 
     term_printf("[CLI] Message type=%d" ENDL, ebyte_message_type);
 }
+
+// ----------------------------------------------------------------------------
+static void on_cmd_ebyte_bench(cmd *c) {
+    Command cmd(c);
+    String param_n = cmd.getArgument("n").getValue();
+    String param_size = cmd.getArgument("size").getValue();
+
+    long n, size;
+    if (extract_int(param_n, &n) == false  ||  extract_int(param_size, &size) == false
+    ||  n <= 0  ||  size <= 0  ||  size > EBYTE_MODULE_BUFFER_SIZE) {
+        term_print(F("[CLI] What? .."));
+        term_println(param_n); term_println(param_size);
+        return;
+    }
+
+    byte buf[EBYTE_MODULE_BUFFER_SIZE];
+    for (long i = 0; i < size; i++) buf[i] = i;
+
+    uint32_t fails[2] = {0, 0};
+    uint32_t elapsed[2];
+
+    ebyte_pause();  // The module to ourselves
+
+    // Before: config-mode path, AUX then EBYTE_EXTRA_WAIT on every packet.
+    uint32_t t = millis();
+    for (long i = 0; i < n; i++) {
+        if (ebyte.sendStruct(buf, size).code != ResponseStatus::SUCCESS) fails[0]++;
+    }
+    elapsed[0] = millis() - t;
+
+    // After: transmission-mode path, until the last packet has left the module.
+    t = millis();
+    for (long i = 0; i < n; i++) {
+        if (ebyte.sendMessage(buf, size).code != ResponseStatus::SUCCESS) fails[1]++;
+    }
+    ebyte.txReady(EBYTE_RESPONSE_TMO);
+    elapsed[1] = millis() - t;
+
+    ebyte_resume();
+
+    if (elapsed[0] == 0) elapsed[0] = 1;
+    if (elapsed[1] == 0) elapsed[1] = 1;
+
+    term_printf("[CLI] Bench airrate=%d n=%d size=%d" ENDL, ebyte_airrate_level, n, size);
+    term_printf("[CLI]   sendStruct : %.2f pkt/s %.2f B/s fail=%u" ENDL,
+        n * 1000.0 / elapsed[0], n * size * 1000.0 / elapsed[0], fails[0]);
+    term_printf("[CLI]   sendMessage: %.2f pkt/s %.2f B/s fail=%u" ENDL,
+        n * 1000.0 / elapsed[1], n * size * 1000.0 / elapsed[1], fails[1]);
+}
+
+// ----------------------------------------------------------------------------
+static void on_cmd_ebyte_lane(cmd *c) {
+    Command cmd(c);
+    String param_msgid = cmd.getArgument("msgid").getValue();
+    String param_class = cmd.getArgument("class").getValue();
+    String param_latest = cmd.getArgument("latest").getValue();
+    static const char *lane_names[EBYTE_LANES] = {"control", "telemetry", "bulk"};
+
+    long msgid, lane, latest;
+    if (extract_int(param_msgid, &msgid) == false
+    ||  extract_int(param_class, &lane) == false
+    ||  extract_int(param_latest, &latest) == false) {
+        if (param_msgid != ""  ||  param_class != "") {
+            term_print(F("[CLI] What? .."));
+            term_println(param_msgid); term_println(param_class); term_println(param_latest);
+        }
+    }
+    else {
+        bool ok = false;
+        if (msgid >= 0) {
+            ebyte_pause();  // The table is read by the downlink task on every frame.
+            ok = ebyte_lane_set(msgid, lane, latest != 0);
+            ebyte_resume();
+        }
+        if (!ok) {
+            term_println(F("[CLI] Ebyte lane error, invalid class or the table is full"));
+        }
+        else {
+            term_printf("[CLI] Ebyte msgid %ld -> %s%s" ENDL, msgid, lane_names[lane], (latest)? ", latest only" : "");
+        }
+    }
+
+    for (uint8_t i = 0; i < EBYTE_LANES; i++) {
+        const EbyteLaneStat & st = ebyte.getLaneStat(i);
+        term_printf("[CLI] Ebyte lane %d %-9s depth:%u head_age:%ums avg_age:%ums max_age:%ums sent:%u coalesced:%u drops:%u" ENDL,
+            i, lane_names[i], ebyte.lengthLaneTx(i), ebyte.headWaitLaneTx(i) / 1000,
+            (st.dequeued > 0)? (uint32_t)(st.wait_sum_us / st.dequeued / 1000) : 0, st.wait_max_us / 1000,
+            st.dequeued, st.coalesced, st.drops);
+    }
+
+    size_t count;
+    const ebyte_lane_entry_t *table = ebyte_lane_table(&count);
+    term_print(F("[CLI] Ebyte lane table (msgid:class, * latest):"));
+    for (size_t i = 0; i < count; i++) {
+        term_printf(" %u:%d%s", table[i].msgid, table[i].lane, (table[i].latest)? "*" : "");
+    }
+    term_println();
+}
+
+// ----------------------------------------------------------------------------
+static void on_cmd_radio_status(cmd *c) {
+    Command cmd(c);
+    Argument arg = cmd.getArgument("ms");
+    String param = arg.getValue();
+
+    long ms;
+    if (extract_int(param, &ms) == false  ||  ms < 0) {
+        if (param != "") {
+            term_print(F("[CLI] What? ..")); term_println(param);
+        }
+    }
+    else {
+        ebyte_radio_status_ms = ms;
+    }
+
+    term_printf("[CLI] RADIO_STATUS period=%dms%s" ENDL, ebyte_radio_status_ms, (ebyte_radio_status_ms == 0)? " (disabled)" : "");
+}
+
+// ----------------------------------------------------------------------------
+static void on_cmd_flow_control(cmd *c) {
+    Command cmd(c);
+    Argument arg = cmd.getArgument("mode");
+    String param = arg.getValue();
+    static const char *mode_names[] = {"none", "rts/cts", "xon/xoff"};
+
+    long mode;
+    if (extract_int(param, &mode) == false  ||  mode < FLOW_CTRL_NONE  ||  mode > FLOW_CTRL_XONXOFF) {
+        if (param != "") {
+            term_print(F("[CLI] What? ..")); term_println(param);
+        }
+    }
+    else {
+        ebyte_set_flow_control(mode);
+    }
+
+    term_printf("[CLI] Flow control=%s" ENDL, mode_names[ebyte_flow_control]);
+}
+
+// ----------------------------------------------------------------------------
+static void on_cmd_reliable(cmd *c) {
+    Command cmd(c);
+    Argument arg = cmd.getArgument("flag");
+    String param = arg.getValue();
+
+    long flag;
+    if (extract_int(param, &flag) == false) {
+        if (param != "") {
+            term_print(F("[CLI] What? ..")); term_println(param);
+        }
+    }
+    else {
+        ebyte_pause();  // Read by the downlink task on every step
+        ebyte_reliable = (flag == 0)? false : true;
+        ebyte_resume();
+    }
+
+    term_printf("[CLI] Reliable mode: %s%s" ENDL, (ebyte_reliable)? "true" : "false",
+        (ebyte_reliable  &&  ebyte_message_type != MSG_TYPE_RAW)? " (raw type only)" : "");
+}
+
+// ----------------------------------------------------------------------------
+static void on_cmd_fec(cmd *c) {
+    Command cmd(c);
+    String param_k = cmd.getArgument("k").getValue();
+    String param_n = cmd.getArgument("n").getValue();
+
+    long k, n;
+    if (extract_int(param_k, &k) == false  ||  extract_int(param_n, &n) == false
+    ||  k < 1  ||  k > FRAG_MAX_COUNT  ||  n < 0  ||  n > 2 * FRAG_MAX_COUNT) {
+        if (param_k != ""  ||  param_n != "") {
+            term_print(F("[CLI] What? ..")); term_print(param_k); term_print(" "); term_println(param_n);
+        }
+    }
+    else if (n - k > FEC_MAX_PARITY) {
+        term_printf("[CLI] FEC n-k=%ld, at most %u parity fragments" ENDL, n - k, FEC_MAX_PARITY);
+    }
+    else {
+        ebyte_pause();  // Read by the downlink task on every step
+        ebyte_fec_k = k;
+        ebyte_fec_n = n;
+        ebyte_resume();
+    }
+
+    if (ebyte_fec_n > ebyte_fec_k) {
+        term_printf("[CLI] FEC k/n=%u/%u, %u parity fragments per message" ENDL, ebyte_fec_k, ebyte_fec_n, ebyte_fec_n - ebyte_fec_k);
+    } else {
+        term_printf("[CLI] FEC off" ENDL);
+    }
+}
+
+// ----------------------------------------------------------------------------
+static void on_cmd_ebyte_stats(cmd *c) {
+    Command cmd(c);
+    String param = cmd.getArgument("mode").getValue();
+
+    if (param == "") {
+        ebyte_stats_print(false);
+    }
+    else if (param == "line") {
+        ebyte_stats_print(true);
+    }
+    else if (param == "reset") {
+        ebyte_stats_reset();
+        term_println("[CLI] Ebyte stats reset");
+    }
+    else {
+        term_print(F("[CLI] What? ..")); term_println(param);
+    }
+}
+
+// ----------------------------------------------------------------------------
+static void on_cmd_ebyte_counters(cmd *c) {
+    Command cmd(c);
+    String param = cmd.getArgument("mode").getValue();
+
+    if (param != ""  &&  param != "reset") {
+        term_print(F("[CLI] What? ..")); term_println(param);
+        return;
+    }
+
+    uint32_t cnt[EBYTE_CNT_COUNT];
+    ebyte_counters_read(cnt, param == "reset");  // The values up to the reset
+    for (uint8_t i = 0; i < EBYTE_CNT_COUNT; i++) {
+        term_printf("[CLI] Counter %-17s %u" ENDL, ebyte_counter_name(i), cnt[i]);
+    }
+    if (param == "reset") {
+        term_println("[CLI] Ebyte counters reset");
+    }
+}
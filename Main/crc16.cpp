@@ -0,0 +1,91 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * CRC-16/MCRF4XX kernels, shared by the MAVLink parser and the framing.
+ *
+ * The tables are generated by the compiler (constexpr, C++11 single-return style) into flash.
+ * Slice-by-N takes N bytes a step with N table lookups and no loop-carried shift per byte;
+ *     bytes are loaded one by one, as the Xtensa core faults on unaligned words.
+ */
+#include "crc16.h"
+
+
+// Table generation at compile time
+static constexpr uint16_t crc16_bits(uint16_t c, int k) {
+    return (k == 0)? c : crc16_bits((c & 1)? (c >> 1) ^ CRC16_POLY : c >> 1, k - 1);
+}
+
+static constexpr uint16_t crc16_zero_byte(uint16_t c) {
+    return (c >> 8) ^ crc16_bits(c & 0xFF, 8);
+}
+
+static constexpr uint16_t crc16_entry(int k, int b) {
+    return (k == 0)? crc16_bits(b, 8) : crc16_zero_byte(crc16_entry(k - 1, b));
+}
+
+template<int... I> struct crc16_index {};
+template<int N, int... I> struct crc16_make_index : crc16_make_index<N - 1, N - 1, I...> {};
+template<int... I> struct crc16_make_index<0, I...> { typedef crc16_index<I...> type; };
+
+template<int... I>
+static constexpr crc16_tables_t crc16_make_tables(crc16_index<I...>) {
+    return {{ {crc16_entry(0, I)...}, {crc16_entry(1, I)...}, {crc16_entry(2, I)...}, {crc16_entry(3, I)...},
+              {crc16_entry(4, I)...}, {crc16_entry(5, I)...}, {crc16_entry(6, I)...}, {crc16_entry(7, I)...} }};
+}
+
+constexpr crc16_tables_t crc16_tables = crc16_make_tables(crc16_make_index<256>::type());
+
+static_assert(crc16_tables.t[0][1] == 0x1189  &&  crc16_tables.t[0][128] == 0x8408, "CRC16 table");
+
+
+uint16_t crc16_bitwise(const void *data, size_t len, uint16_t crc) {
+    const uint8_t *p = (const uint8_t *)data;
+    while (len--) {
+        crc ^= *p++;
+        for (uint8_t k = 0; k < 8; k++) {
+            crc = (crc & 1)? (crc >> 1) ^ CRC16_POLY : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+
+uint16_t crc16_bytewise(const void *data, size_t len, uint16_t crc) {
+    const uint8_t *p = (const uint8_t *)data;
+    while (len--) {
+        crc = (crc >> 8) ^ crc16_tables.t[0][(crc ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+
+uint16_t crc16_slice4(const void *data, size_t len, uint16_t crc) {
+    const uint8_t *p = (const uint8_t *)data;
+    const uint16_t (*t)[256] = crc16_tables.t;
+    for (; len >= 4; len -= 4, p += 4) {
+        crc = t[3][(p[0] ^ crc) & 0xFF] ^ t[2][(p[1] ^ (crc >> 8)) & 0xFF] ^ t[1][p[2]] ^ t[0][p[3]];
+    }
+    return crc16_bytewise(p, len, crc);
+}
+
+
+uint16_t crc16_slice8(const void *data, size_t len, uint16_t crc) {
+    const uint8_t *p = (const uint8_t *)data;
+    const uint16_t (*t)[256] = crc16_tables.t;
+    for (; len >= 8; len -= 8, p += 8) {
+        crc = t[7][(p[0] ^ crc) & 0xFF] ^ t[6][(p[1] ^ (crc >> 8)) & 0xFF] ^ t[5][p[2]] ^ t[4][p[3]]
+            ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    }
+    return crc16_slice4(p, len, crc);
+}
+
+
+uint16_t crc16_update(const void *data, size_t len, uint16_t crc) {
+#if CRC16_SLICE == 8
+    return crc16_slice8(data, len, crc);
+#elif CRC16_SLICE == 4
+    return crc16_slice4(data, len, crc);
+#else
+    return crc16_bytewise(data, len, crc);
+#endif
+}
@@ -0,0 +1,40 @@
+#ifndef __CRC16_H__
+#define __CRC16_H__
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * @brief CRC-16/MCRF4XX, the X.25 CRC of MAVLink: reflected poly 0x8408, init 0xFFFF, no final XOR
+ *
+ * Updates are incremental; feed a stream in pieces, starting from CRC16_INIT.
+ * A message followed by its CRC, low byte first, comes to 0.
+ */
+#define CRC16_INIT      0xFFFF
+#define CRC16_POLY      0x8408
+#define CRC16_CHECK     0x6F91  // Of "123456789"
+
+#ifndef CRC16_SLICE
+#define CRC16_SLICE     8  // Of crc16_update(); 1, 4 or 8 bytes a step
+#endif
+
+typedef struct {
+    uint16_t t[8][256];  // t[k][b]: CRC of byte b followed by k zero bytes
+} crc16_tables_t;
+
+extern const crc16_tables_t crc16_tables;
+
+static inline uint16_t crc16_accumulate(uint8_t b, uint16_t crc) {
+    return (crc >> 8) ^ crc16_tables.t[0][(crc ^ b) & 0xFF];
+}
+
+extern uint16_t crc16_bitwise(const void *data, size_t len, uint16_t crc);  // Reference
+extern uint16_t crc16_bytewise(const void *data, size_t len, uint16_t crc);
+extern uint16_t crc16_slice4(const void *data, size_t len, uint16_t crc);
+extern uint16_t crc16_slice8(const void *data, size_t len, uint16_t crc);
+extern uint16_t crc16_update(const void *data, size_t len, uint16_t crc);
+
+
+#endif  // __CRC16_H__
@@ -49,21 +49,66 @@ class EbyteSetter {
 };
 
 
+/**
+ * @brief Link counters, always on: a relaxed atomic add each, no printing.
+ *     C2E is computer to Ebyte (downlink), E2C is Ebyte to computer (uplink).
+ */
+enum {
+    EBYTE_CNT_C2E_PACKETS = 0,   // Radio packets sent
+    EBYTE_CNT_C2E_BYTES,
+    EBYTE_CNT_E2C_PACKETS,       // Radio packets received
+    EBYTE_CNT_E2C_BYTES,         // Written to the computer
+    EBYTE_CNT_E2C_GAP_MS,        // Sum of the inter-arrival times
+    EBYTE_CNT_TX_AIR_US,         // AUX busy following our own departures
+    EBYTE_CNT_DROP_LANE_FULL,    // Frames from the computer, no lane slot
+    EBYTE_CNT_DROP_QUEUE_FULL,   // Raw messages from the computer, no queue slot
+    EBYTE_CNT_DROP_LOOPBACK,     // Messages not looped back
+    EBYTE_CNT_DROP_E2C_WRITE,    // Pieces not written whole to the computer
+    EBYTE_CNT_DROP_RX_ERROR,     // Radio packets failed to be received
+    EBYTE_CNT_SEND_ERRORS,
+    EBYTE_CNT_AUX_TIMEOUTS,      // No AUX HIGH / FIFO credit in time
+    EBYTE_CNT_UART_OVERFLOWS,    // Both UARTs
+    EBYTE_CNT_ALLOC_FAILS,       // No slot in a queue, lane or ring
+    EBYTE_CNT_SEGMENT_TRUNCATED, // Bytes of frames the packer had no room for
+    EBYTE_CNT_FLOW_PAUSES,       // Computer told to stop sending
+    EBYTE_CNT_QUEUE_HWM,         // Most messages queued for TX, a high-water mark
+    EBYTE_CNT_COUNT
+};
+
+
 typedef struct {
-    uint32_t report_millis;
-    uint32_t downlink_byte_sum;
-    uint32_t uplink_byte_sum;
+    uint32_t report_millis;              // Next report
+    uint32_t report_start_millis;        // Last report
+    uint32_t report_counters[EBYTE_CNT_COUNT];  // At the last report
     uint32_t prev_arival_millis;         // Previous time the packet came
     uint32_t prev_departure_millis;         // Previous time the packet went
-    uint32_t inter_arival_sum_millis;    // Cummulative sum of inter-packet arival time
-    uint32_t inter_arival_count;
 
-    uint32_t loopback_tmo_millis;  // Loopback cut-frame timeout
+    uint32_t aux_busy_count;       // Last seen EbyteAuxStat::busy_count
+    uint32_t aux_ready_timeouts;   // Last seen EbyteAuxStat::ready_timeouts
+    uint32_t uart_overflows;       // Last seen EbyteUartStat::overflows
+    uint32_t gap_losses;           // Last seen sum of the loss signals, see ebyte_gap_losses()
+    uint32_t arq_acked_bytes;      // At the last report
 } ebyte_stat_t;
 
 
+typedef struct {
+    TaskHandle_t handle;
+    SemaphoreHandle_t wake;    // Given on UART RX events & work handed over, instead of polling
+    uint32_t busy_us;          // Time spent on work, wrapping; written by the task only
+    uint32_t paused_seq;       // The last ebyte_pause() the task has stopped for
+    uint32_t report_busy_us;   // At the last report
+    uint32_t report_micros;
+} ebyte_task_stat_t;
+
+
 extern void ebyte_setup(bool do_axp_exist);
-extern void ebyte_process();  // Store & forward data between
+extern void ebyte_report_process();  // Store & forward runs in its own tasks, see ebyte_setup().
+extern void ebyte_stats_print(bool line);  // Latency of the forwarding stages
+extern void ebyte_stats_reset();
+extern void ebyte_counters_read(uint32_t *out, bool reset);  // EBYTE_CNT_COUNT values, a snapshot
+extern const char *ebyte_counter_name(uint8_t id);
+extern void ebyte_pause();   // Hold both radio tasks, e.g. to configure the module; nestable
+extern void ebyte_resume();
 
 extern void ebyte_set_configs(EbyteSetter & setter);
 extern void ebyte_apply_configs();
@@ -84,6 +129,31 @@ enum {
 extern uint8_t ebyte_message_type;
 extern uint32_t ebyte_tbtw_rxtx_ms;
 extern uint32_t ebyte_tbtw_txtx_ms;
+extern bool ebyte_tbtw_manual;
+extern uint32_t ebyte_radio_status_ms;
+
+enum {
+    FLOW_CTRL_NONE = 0,
+    FLOW_CTRL_RTSCTS = 1,
+    FLOW_CTRL_XONXOFF = 2,
+};
+extern uint8_t ebyte_flow_control;
+extern void ebyte_set_flow_control(uint8_t mode);
+extern bool ebyte_reliable;
+extern uint8_t ebyte_fec_k;
+extern uint8_t ebyte_fec_n;
+
+#define EBYTE_LANE_TABLE_SIZE 48
+
+typedef struct {
+    uint32_t msgid;
+    uint8_t  lane;    // EbyteLane
+    bool     latest;  // Only the newest frame per sysid/compid is kept queued.
+} ebyte_lane_entry_t;
+
+extern uint8_t ebyte_lane_of(uint32_t msgid, bool *latest = NULL);  // EBYTE_LANE_TELEMETRY if not in the table
+extern bool ebyte_lane_set(uint32_t msgid, uint8_t lane, bool latest = false);
+extern const ebyte_lane_entry_t *ebyte_lane_table(size_t *count);
 
 
 #endif  // __EBYTE_H__
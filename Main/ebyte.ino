@@ -16,9 +16,15 @@
 #define EBYTE_FC_PIN_RX 4   // 21: RX to Flight-controller TX
 #define EBYTE_FC_PIN_TX 23  // 22: TX to Flight-controller RX
 
+#ifndef EBYTE_FC_PIN_RTS
+#define EBYTE_FC_PIN_RTS 19  // Output, LOW: computer may send -- free while the on-board LoRa is unused
+#endif
+#ifndef EBYTE_FC_PIN_CTS
+#define EBYTE_FC_PIN_CTS 35  // Input, LOW: we may send
+#endif
+
 #define EBYTE_FC_RX_BUFFER_SIZE EBYTE_UART_BUFFER_SIZE
-// #define EBYTE_FC_UART_TMO       EBYTE_UART_BUFFER_TMO
-#define EBYTE_FC_UART_TMO       40  // Quick enough to cut separately Mavlink frames.
+#define EBYTE_FC_UART_TMO       0  // Never wait; messages are delimited by framing, not by idle time.
 
 
 // Ebyte config
@@ -35,10 +41,16 @@
 #define EBYTE_PIN_TX    2   // TX to Ebyte RX
 #define EBYTE_PIN_AUX_V07   34
 #define EBYTE_PIN_AUX_V10   15
+#ifndef EBYTE_PIN_AUX  // Pins may be given by the build, e.g. two ends in one host program, see tools/sim_link.cpp
 #define EBYTE_PIN_AUX   EBYTE_PIN_AUX_V07
+#endif
 
+#ifndef EBYTE_PIN_M0
 #define EBYTE_PIN_M0    25
+#endif
+#ifndef EBYTE_PIN_M1
 #define EBYTE_PIN_M1    14
+#endif
 
 
 #if EBYTE_MODULE == EBYTE_E34
@@ -60,9 +72,31 @@ EbyteE28 ebyte(&EBYTE_SERIAL, EBYTE_PIN_AUX, EBYTE_PIN_M0, EBYTE_PIN_M1, EBYTE_P
 #define EBYTE_REPORT_PERIOD_MS 10000
 
 // XXX: After fune-tuning for a while, I think 'time' between RX and TX is the most significance.
-#define EBYTE_LOOPBACK_TMO_MS 1000  // Used for cutting the end of loopback frame, to send it back
 #define EBYTE_TBTW_RXTX_MS 800  // ms between starting to send after receiving
 #define EBYTE_TBTW_TXTX_MS 100  // ms between sent frames
+#define EBYTE_PACK_LINGER_MS 5  // Wait for more frames to join a packet that is not full
+
+// Flow control of the computer, on the fill of the UART RX buffer & TX lanes
+#define EBYTE_FLOW_HIGH_PCT 75  // Pause the computer above
+#define EBYTE_FLOW_LOW_PCT  40  // Resume below
+#define EBYTE_FLOW_XON      0x11
+#define EBYTE_FLOW_XOFF     0x13
+
+// RADIO_STATUS to the computer, as SiK radios do, so the autopilot throttles its streams by 'txbuf'.
+#define EBYTE_RADIO_STATUS_MS     1000  // 0 is disabled
+#define EBYTE_RADIO_STATUS_SYSID  '3'   // As of SiK
+#define EBYTE_RADIO_STATUS_COMPID MAVLINK_COMP_ID_TELEMETRY_RADIO
+
+// Uplink & downlink run in their own tasks, on the core away from loop(); CLI, GPS, AXP & LED stay in loop().
+#define EBYTE_TASK_CORE          0     // loop() runs on ARDUINO_RUNNING_CORE, 1
+#define EBYTE_TASK_PRIORITY      5
+#define EBYTE_TASK_STACK_SIZE    8192  // Bytes
+#define EBYTE_TASK_YIELD_MS      100   // Let the idle task run, even when busy, for the task watchdog.
+#define EBYTE_TASK_IDLE_MS       10    // Longest sleep with no UART event; for the timers, e.g. reassembly & RADIO_STATUS
+#define EBYTE_LOOPBACK_RING_SIZE 4096  // Uplink to downlink, messages to be sent back
+#define EBYTE_ARRIVAL_RING_SIZE  256   // Uplink to downlink, arrival times for the gap controller
+#define EBYTE_RX_POOL_RING_SIZE  128   // Downlink to uplink, empty queueTx blocks to receive into
+#define EBYTE_RX_POOL_BLOCKS     2     // Lent to the uplink at most, out of EBYTE_QUEUE_TX_SLOTS
 
 int ebyte_show_report_count = 0;  // 0 is 'disable', -1 is 'forever', other +n will be counted down to zero.
 bool ebyte_loopback_flag = false;
@@ -73,17 +107,120 @@ uint8_t ebyte_channel = 6;
 uint8_t ebyte_message_type = MSG_TYPE_RAW;
 uint32_t ebyte_tbtw_rxtx_ms = EBYTE_TBTW_RXTX_MS;
 uint32_t ebyte_tbtw_txtx_ms = EBYTE_TBTW_TXTX_MS;
+bool ebyte_tbtw_manual = false;  // false: gaps are set by the adaptive controller
+uint32_t ebyte_radio_status_ms = EBYTE_RADIO_STATUS_MS;
+uint8_t ebyte_flow_control = FLOW_CTRL_NONE;
+bool ebyte_reliable = false;
+uint8_t ebyte_fec_k = 0;  // FEC off
+uint8_t ebyte_fec_n = 0;
+static bool ebyte_flow_paused = false;  // Of the downlink task, or under ebyte_pause()
+static uint8_t ebyte_flow_xchar = 0;    // XON/XOFF to be sent, from the downlink task to the uplink one
+
+static mavlink_parser_t ebyte_uplink_parser;  // Frames may span radio packets.
+static framing_decoder_t ebyte_uplink_decoder;  // Raw messages, framed over the air
+static frag_table_t ebyte_uplink_reasm;  // Raw messages larger than a packet
+static mavlink_parser_t ebyte_downlink_parser;
+static packer_t ebyte_downlink_packer;  // Whole frames into radio packets
+static uint32_t ebyte_downlink_intake_millis = 0;
+static uint32_t ebyte_downlink_head_millis = 0;  // Since when the next thing to send has waited, see gap_rxtx_hold()
+static uint8_t ebyte_downlink_stx = MAVLINK_STX_V1;  // Answer in the version the computer speaks.
+static uint8_t ebyte_radio_status_txbuf = 100;
+
+static ebyte_stat_t ebyte_stat {};
+static ebyte_task_stat_t ebyte_uplink_task_stat {};
+static ebyte_task_stat_t ebyte_downlink_task_stat {};
+static uint8_t ebyte_pause_depth = 0;  // Nesting of ebyte_pause(), from loop() only
+static uint32_t ebyte_pause_seq = 0;   // Bumped on each pause, acknowledged by the tasks
+static EbyteUartStat ebyte_computer_uart_stat {};  // Written by the UART event task only
+
+// Latency of the forwarding stages, by the cycle counter of the radio core
+enum {
+    EBYTE_LAT_C2E_INTAKE = 0,  // Computer UART RX -> enqueued
+    EBYTE_LAT_C2E_QUEUE,       // Enqueued -> AUX ready, of the oldest message in the packet
+    EBYTE_LAT_C2E_WRITE,       // AUX ready -> written to the module UART
+    EBYTE_LAT_E2C_INTAKE,      // Radio RX available -> packet received from the module UART
+    EBYTE_LAT_E2C_PARSE,       // Received -> a whole message/frame of it decoded
+    EBYTE_LAT_E2C_WRITE,       // Decoded -> written to the computer UART
+    EBYTE_LAT_STAGES,
+};
+static const char *ebyte_lat_names[EBYTE_LAT_STAGES] = {
+    "c2e_intake", "c2e_queue", "c2e_write", "e2c_intake", "e2c_parse", "e2c_write",
+};
+static lat_hist_t ebyte_lat[EBYTE_LAT_STAGES];
+static uint32_t ebyte_cpu_mhz = 240;
+static uint32_t ebyte_uplink_rx_cycles = 0;  // Of the packet being delivered
+
+static const char *ebyte_counter_names[EBYTE_CNT_COUNT] = {
+    "c2e_packets", "c2e_bytes", "e2c_packets", "e2c_bytes", "e2c_gap_ms", "tx_air_us",
+    "drop_lane_full", "drop_queue_full", "drop_loopback", "drop_e2c_write", "drop_rx_error",
+    "send_errors", "aux_timeouts", "uart_overflows", "alloc_fails", "segment_truncated", "flow_pauses", "queue_hwm",
+};
+static uint32_t ebyte_counters[EBYTE_CNT_COUNT];  // Atomic adds; see ebyte_counters_read() for a reset
+
+static spsc_ring_t ebyte_loopback_ring;
+static uint8_t ebyte_loopback_storage[EBYTE_LOOPBACK_RING_SIZE];
+static spsc_ring_t ebyte_arrival_ring;
+static uint8_t ebyte_arrival_storage[EBYTE_ARRIVAL_RING_SIZE];
+static spsc_ring_t ebyte_rx_pool_ring;
+static uint8_t ebyte_rx_pool_storage[EBYTE_RX_POOL_RING_SIZE];
+static uint8_t ebyte_rx_pool_lent = 0;  // Of the downlink task: in the pool ring, held by the uplink, or looped back
+static EbytePacket ebyte_uplink_packet;  // Of the uplink task, the block being received into
+
+// MAVLink msgid -> TX lane; the others are EBYTE_LANE_TELEMETRY.
+// 'latest' frames are periodic state; a stale copy still queued is replaced instead of sent late.
+static const ebyte_lane_entry_t ebyte_lane_defaults[] = {
+    {0,   EBYTE_LANE_CONTROL,   false},  // HEARTBEAT
+    {11,  EBYTE_LANE_CONTROL,   false},  // SET_MODE
+    {69,  EBYTE_LANE_CONTROL,   false},  // MANUAL_CONTROL
+    {70,  EBYTE_LANE_CONTROL,   true},   // RC_CHANNELS_OVERRIDE
+    {75,  EBYTE_LANE_CONTROL,   false},  // COMMAND_INT
+    {76,  EBYTE_LANE_CONTROL,   false},  // COMMAND_LONG
+    {77,  EBYTE_LANE_CONTROL,   false},  // COMMAND_ACK
+    {84,  EBYTE_LANE_CONTROL,   false},  // SET_POSITION_TARGET_LOCAL_NED
+    {86,  EBYTE_LANE_CONTROL,   false},  // SET_POSITION_TARGET_GLOBAL_INT
+    {1,   EBYTE_LANE_TELEMETRY, true},   // SYS_STATUS
+    {24,  EBYTE_LANE_TELEMETRY, true},   // GPS_RAW_INT
+    {30,  EBYTE_LANE_TELEMETRY, true},   // ATTITUDE
+    {31,  EBYTE_LANE_TELEMETRY, true},   // ATTITUDE_QUATERNION
+    {32,  EBYTE_LANE_TELEMETRY, true},   // LOCAL_POSITION_NED
+    {33,  EBYTE_LANE_TELEMETRY, true},   // GLOBAL_POSITION_INT
+    {36,  EBYTE_LANE_TELEMETRY, true},   // SERVO_OUTPUT_RAW
+    {62,  EBYTE_LANE_TELEMETRY, true},   // NAV_CONTROLLER_OUTPUT
+    {65,  EBYTE_LANE_TELEMETRY, true},   // RC_CHANNELS
+    {74,  EBYTE_LANE_TELEMETRY, true},   // VFR_HUD
+    {147, EBYTE_LANE_TELEMETRY, true},   // BATTERY_STATUS
+    {22,  EBYTE_LANE_BULK,      false},  // PARAM_VALUE
+    {110, EBYTE_LANE_BULK,      false},  // FILE_TRANSFER_PROTOCOL
+    {118, EBYTE_LANE_BULK,      false},  // LOG_ENTRY
+    {120, EBYTE_LANE_BULK,      false},  // LOG_DATA
+    {130, EBYTE_LANE_BULK,      false},  // DATA_TRANSMISSION_HANDSHAKE
+    {131, EBYTE_LANE_BULK,      false},  // ENCAPSULATED_DATA
+    {266, EBYTE_LANE_BULK,      false},  // LOGGING_DATA
+    {267, EBYTE_LANE_BULK,      false},  // LOGGING_DATA_ACKED
+};
+static_assert(ARRAY_SIZE(ebyte_lane_defaults) <= EBYTE_LANE_TABLE_SIZE, "EBYTE_LANE_TABLE_SIZE is too small");
+static ebyte_lane_entry_t ebyte_lanes[EBYTE_LANE_TABLE_SIZE];  // The defaults, then those set by the CLI
+static size_t ebyte_lane_count = 0;
 
 
 // ----------------------------------------------------------------------------
 void ebyte_setup(bool do_axp_exist) {
+    ebyte_cpu_mhz = ESP.getCpuFreqMHz();
+    memcpy(ebyte_lanes, ebyte_lane_defaults, sizeof(ebyte_lane_defaults));
+    ebyte_lane_count = ARRAY_SIZE(ebyte_lane_defaults);
+    ebyte_uplink_task_stat.wake = xSemaphoreCreateBinary();
+    ebyte_downlink_task_stat.wake = xSemaphoreCreateBinary();
+
     // Setup as a modem connected to computer
     computer.setRxBufferSize(EBYTE_FC_RX_BUFFER_SIZE);
     computer.begin(EBYTE_FC_BAUD, SERIAL_8N1, EBYTE_FC_PIN_RX, EBYTE_FC_PIN_TX);
     computer.setTimeout(EBYTE_FC_UART_TMO);
+    computer.onReceive(ebyte_computer_on_receive, false);  // RX FIFO full, or RX timeout
+    computer.onReceiveError(ebyte_computer_on_receive_error);
     while (!computer) taskYIELD();  // Yield
     while (computer.available())
         computer.read();  // Clear buffer
+    ebyte_set_flow_control(ebyte_flow_control);
 
     if (do_axp_exist) {
         ebyte.setAuxPin(EBYTE_PIN_AUX_V10);
@@ -147,9 +284,23 @@ void ebyte_setup(bool do_axp_exist) {
             term_println(rc.status.desc());  // Description of code
         }
 
-        #ifdef TEST_MAVLINK
-        mavlink_test_segmmentor();
-        #endif
+        mavlink_parser_init(&ebyte_uplink_parser);
+        framing_decoder_init(&ebyte_uplink_decoder);
+        mavlink_parser_init(&ebyte_downlink_parser);
+        packer_init(&ebyte_downlink_packer, EBYTE_MODULE_BUFFER_SIZE);
+        spsc_init(&ebyte_loopback_ring, ebyte_loopback_storage, sizeof(ebyte_loopback_storage));
+        spsc_init(&ebyte_arrival_ring, ebyte_arrival_storage, sizeof(ebyte_arrival_storage));
+        spsc_init(&ebyte_rx_pool_ring, ebyte_rx_pool_storage, sizeof(ebyte_rx_pool_storage));
+        ebyte.setRxWake(ebyte_uplink_task_stat.wake);
+        ebyte_stat.prev_arival_millis = millis();  // The first inter-arrival time is from now, not from boot.
+
+        xTaskCreatePinnedToCore(ebyte_uplink_task, "ebyte_up", EBYTE_TASK_STACK_SIZE, NULL,
+                                EBYTE_TASK_PRIORITY, &ebyte_uplink_task_stat.handle, EBYTE_TASK_CORE);
+        xTaskCreatePinnedToCore(ebyte_downlink_task, "ebyte_down", EBYTE_TASK_STACK_SIZE, NULL,
+                                EBYTE_TASK_PRIORITY, &ebyte_downlink_task_stat.handle, EBYTE_TASK_CORE);
+        if (ebyte_uplink_task_stat.handle == NULL  ||  ebyte_downlink_task_stat.handle == NULL) {
+            term_println(F("[EBYTE] Creating the radio tasks, failed!"));
+        }
     }
     else {
         term_println(F("[EBYTE] Open connection fail!"));
@@ -157,106 +308,493 @@ void ebyte_setup(bool do_axp_exist) {
 }
 
 // ----------------------------------------------------------------------------
-void ebyte_uplink_process(ebyte_stat_t *s) {
+/**
+ * @brief A stage from cycle count 'from' to 'to'; both on the same core, less than a wrap apart (~17s)
+ */
+static void ebyte_lat_add(uint8_t stage, uint32_t from, uint32_t to) {
+    lat_add(&ebyte_lat[stage], (to - from) / ebyte_cpu_mhz);
+}
+
+// ----------------------------------------------------------------------------
+/**
+ * @brief Link counters, from any task
+ */
+static inline void ebyte_count(uint8_t id, uint32_t n) {
+    __atomic_fetch_add(&ebyte_counters[id], n, __ATOMIC_RELAXED);
+}
+
+static inline void ebyte_count_max(uint8_t id, uint32_t v) {
+    uint32_t *c = &ebyte_counters[id];
+    uint32_t cur = __atomic_load_n(c, __ATOMIC_RELAXED);
+    while (v > cur  &&  !__atomic_compare_exchange_n(c, &cur, v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+// ----------------------------------------------------------------------------
+/**
+ * @brief Computer UART events, from the event task of the UART driver; they wake the downlink task.
+ */
+static void ebyte_computer_on_receive() {
+    ebyte_computer_uart_stat.rx_events++;
+    xSemaphoreGive(ebyte_downlink_task_stat.wake);
+}
+
+static void ebyte_computer_on_receive_error(hardwareSerial_error_t err) {
+    EbyteModule::countUartError(ebyte_computer_uart_stat, err);
+    if (err == UART_BUFFER_FULL_ERROR  ||  err == UART_FIFO_OVF_ERROR) ebyte_count(EBYTE_CNT_UART_OVERFLOWS, 1);
+    xSemaphoreGive(ebyte_downlink_task_stat.wake);
+}
+
+// ----------------------------------------------------------------------------
+/**
+ * @brief Forward a received piece to the computer.
+ *     The piece is 'head' + 'body'; 'head' is the part of a frame carried over from the previous packet.
+ */
+static void ebyte_uplink_forward(const byte *head, size_t head_len, const byte *body, size_t body_len) {
+    size_t len = head_len + body_len;
+    uint32_t parsed = ESP.getCycleCount();
+    ebyte_lat_add(EBYTE_LAT_E2C_PARSE, ebyte_uplink_rx_cycles, parsed);
+
+    if (computer.write(head, head_len) != head_len  ||  computer.write(body, body_len) != body_len) {
+        termlog_printf("[EBYTE] E2C error. Cannot write all" ENDL);
+        ebyte_count(EBYTE_CNT_DROP_E2C_WRITE, 1);
+    }
+    else {
+        ebyte_lat_add(EBYTE_LAT_E2C_WRITE, parsed, ESP.getCycleCount());
+        if (system_verbose_level >= VERBOSE_DEBUG) {
+            termlog_hex(head, head_len, body, body_len, "[EBYTE] Recv: %3d bytes >> ", len);
+        }
+        else if (system_verbose_level >= VERBOSE_INFO) {
+            termlog_printf("[EBYTE] Recv: %3d bytes" ENDL, len);
+        }
+        ebyte_count(EBYTE_CNT_E2C_BYTES, len);
+    }
+}
+
+/**
+ * @brief Hand a piece over to the downlink task, which owns the TX queue, to be sent back.
+ *     A record is an EbytePacket; with no block, a copy of 'head' + 'body' follows it,
+ *     so a frame split across packets is rejoined here.
+ */
+static void ebyte_uplink_loopback(const byte *head, size_t head_len, const byte *body, size_t body_len) {
+    size_t len = head_len + body_len;
+    EbytePacket pkt;
+    pkt.size = len;
+
+    if (!spsc_push(&ebyte_loopback_ring, &pkt, sizeof(pkt), head, head_len, body, body_len)) {
+        termlog_printf("[EBYTE] Loopback error on enqueueing %d bytes, ring full" ENDL, len);
+        ebyte_count(EBYTE_CNT_DROP_LOOPBACK, 1);
+        ebyte_count(EBYTE_CNT_ALLOC_FAILS, 1);
+    }
+    else {
+        xSemaphoreGive(ebyte_downlink_task_stat.wake);
+        if (system_verbose_level >= VERBOSE_INFO) {
+            termlog_printf("[EBYTE] Loopback enqueueing %3d bytes" ENDL, len);
+        }
+    }
+}
+
+/**
+ * @brief Hand the whole received block over to the downlink task, zero-copy; the uplink takes another one.
+ *
+ * @return false if the ring is full, the block is still the uplink's then
+ */
+static bool ebyte_uplink_loopback_packet(EbytePacket & pkt) {
+    if (!spsc_push(&ebyte_loopback_ring, &pkt, sizeof(pkt))) {
+        return false;
+    }
+
+    xSemaphoreGive(ebyte_downlink_task_stat.wake);
+    if (system_verbose_level >= VERBOSE_INFO) {
+        termlog_printf("[EBYTE] Loopback enqueueing %3d bytes, in place" ENDL, pkt.size);
+    }
+    pkt = EbytePacket();
+    return true;
+}
+
+static void ebyte_uplink_deliver(const byte *head, size_t head_len, const byte *body, size_t body_len) {
+    ebyte_uplink_forward(head, head_len, body, body_len);
+    if (ebyte_loopback_flag) {
+        ebyte_uplink_loopback(head, head_len, body, body_len);
+    }
+}
+
+/**
+ * @brief Uplink task body
+ *
+ * @return true if there was work
+ */
+static bool ebyte_uplink_process(ebyte_stat_t *s) {
     // XXX: Not required indeed, I think
     // if (millis() < s->prev_departure_millis + ebyte_tbtw_rxtx_ms) {  // Space between RX then TX
     //     return;
     // }
 
+    if (ebyte_uplink_reasm.chunk != ebyte.maxMessageSize()) {  // Fragments are smaller under ARQ or FEC.
+        frag_table_init(&ebyte_uplink_reasm, ebyte.maxMessageSize(), FRAG_TIMEOUT_MS);
+    }
+
+    bool busy = false;
     if (ebyte.available()) {
-        ResponseStructContainer rc = ebyte.receiveMessage();
-        char * p = (char *)rc.data;
-        size_t len = rc.size;
+        busy = true;
+        uint32_t intake_cycles = ESP.getCycleCount();
+
+        // Into a queueTx block lent by the downlink task, which owns the slab, else into a buffer of our own.
+        EbytePacket & pkt = ebyte_uplink_packet;
+        const uint8_t *rec;
+        if (pkt.block < 0  &&  spsc_peek(&ebyte_rx_pool_ring, &rec) == sizeof(pkt)) {
+            memcpy(&pkt, rec, sizeof(pkt));
+            spsc_pop(&ebyte_rx_pool_ring);
+        }
 
-        // Update stat.
-        s->inter_arival_sum_millis += millis() - s->prev_arival_millis;
-        s->prev_arival_millis = millis();  // Arrival time marking
-        s->inter_arival_count++;
+        static byte own_buf[EBYTE_MODULE_BUFFER_SIZE];
+        byte *buf = pkt.data;
+        size_t size = 0;
+        ResponseStatus status;
+        if (pkt.block >= 0  ||  ebyte_loopback_flag) {  // Only a loopback wants a block; a miss is counted then.
+            status = ebyte.receivePacket(pkt);
+        }
+        if (pkt.block < 0) {
+            buf = own_buf;
+            status = ebyte.receiveMessage(buf, sizeof(own_buf), size);
+        }
+        else {
+            size = pkt.size;
+        }
+        ebyte_uplink_rx_cycles = ESP.getCycleCount();
+        ebyte_lat_add(EBYTE_LAT_E2C_INTAKE, intake_cycles, ebyte_uplink_rx_cycles);
 
-        ////////////////////////////////////////////
-        // Preprocess depends on the message mode //
-        ////////////////////////////////////////////
-        switch (ebyte_message_type) {
-            case MSG_TYPE_RAW: break;  // Passthrough
-            case MSG_TYPE_MAVLINK: p = mavlink_segmentor(p, len, &len); break;
+        // Update stat.
+        uint32_t now = millis();
+        ebyte_count(EBYTE_CNT_E2C_PACKETS, 1);
+        ebyte_count(EBYTE_CNT_E2C_GAP_MS, now - s->prev_arival_millis);
+        s->prev_arival_millis = now;  // Arrival time marking
+
+        // Gap controller, in the downlink task
+        if (spsc_push(&ebyte_arrival_ring, &now, sizeof(now))) {
+            xSemaphoreGive(ebyte_downlink_task_stat.wake);
+        }
+        else if (system_verbose_level >= VERBOSE_DEBUG) {
+            termlog_printf("[EBYTE] Arrival ring full" ENDL);
         }
 
-        if (rc.status.code != ResponseStatus::SUCCESS) {
-            term_print("[EBYTE] E2C error!, ");
-            term_println(rc.status.desc());
+        if (status.code != ResponseStatus::SUCCESS) {
+            termlog_printf("[EBYTE] E2C error!, %s" ENDL, status.descStr());
+            ebyte_count(EBYTE_CNT_DROP_RX_ERROR, 1);
         }
         else {
-            ////////////////////
-            // Forward uplink //
-            ////////////////////
-            if (computer.write(p, len) != len) {
-                term_println("[EBYTE] E2C error. Cannot write all");
-            }
-            else {
-                if (system_verbose_level >= VERBOSE_INFO) {
-                    term_printf("[EBYTE] Recv: %3d bytes", len);
-                    if (system_verbose_level >= VERBOSE_DEBUG) {
-                        term_println(" >> " + hex_stream(p, len));
+            ////////////////////////////////////////////
+            // Preprocess depends on the message mode //
+            ////////////////////////////////////////////
+            switch (ebyte_message_type) {
+                case MSG_TYPE_RAW: {  // Only whole, CRC-valid messages, reassembled from their fragments
+                    const uint8_t *frag, *msg;
+                    size_t frag_len, msg_len;
+                    const uint8_t *frame;
+                    size_t frame_len;
+                    framing_decode_begin(&ebyte_uplink_decoder, buf, size);
+                    while (framing_decode_next(&ebyte_uplink_decoder, &frame, &frame_len)) {
+                        if (!ebyte.isReliable()) {
+                            if (frag_table_push(&ebyte_uplink_reasm, frame, frame_len, millis(), &msg, &msg_len)) {
+                                ebyte_uplink_deliver(NULL, 0, msg, msg_len);
+                            }
+                            continue;
+                        }
+
+                        ebyte.beginReliableRx(frame, frame_len);  // In order, with no duplicate
+                        while (ebyte.nextReliableRx(&frag, &frag_len)) {
+                            if (frag_table_push(&ebyte_uplink_reasm, frag, frag_len, millis(), &msg, &msg_len)) {
+                                ebyte_uplink_deliver(NULL, 0, msg, msg_len);
+                            }
+                        }
                     }
-                    else {
-                        term_println();
+                    break;
+                }
+
+                case MSG_TYPE_MAVLINK: {  // Only whole, CRC-valid frames
+                    // Frames that fill the packet exactly, in place, loop back as the block itself.
+                    // From the first one that does not, those before are copied as one piece, the rest one by one.
+                    mavlink_frame_t frame;
+                    size_t in_place = 0;  // Leading bytes of 'buf', in whole frames
+                    bool contiguous = true;
+                    mavlink_parse_begin(&ebyte_uplink_parser, buf, size);
+                    while (mavlink_parse_next(&ebyte_uplink_parser, &frame)) {
+                        ebyte_uplink_forward(frame.head, frame.head_len, frame.body, frame.body_len);
+                        if (!ebyte_loopback_flag) continue;
+
+                        if (contiguous  &&  frame.head_len == 0  &&  frame.body == buf + in_place) {
+                            in_place += frame.body_len;
+                            continue;
+                        }
+                        if (contiguous  &&  in_place > 0) {
+                            ebyte_uplink_loopback(NULL, 0, buf, in_place);
+                        }
+                        contiguous = false;
+                        ebyte_uplink_loopback(frame.head, frame.head_len, frame.body, frame.body_len);
+                    }
+
+                    if (contiguous  &&  in_place > 0) {
+                        if (in_place != size  ||  pkt.block < 0  ||  !ebyte_uplink_loopback_packet(pkt)) {
+                            ebyte_uplink_loopback(NULL, 0, buf, in_place);
+                        }
                     }
+                    break;
                 }
-                s->uplink_byte_sum += len;  // Kepp stat
             }
+        }
+    }
 
-            ///////////////////////////
-            // Loopback, on this end //
-            ///////////////////////////
-            if (ebyte_loopback_flag) {
-                ResponseStatus status = ebyte.fragmentMessageQueueTx(p, len);  // In-queuing to be sent sequentially
+    frag_table_expire(&ebyte_uplink_reasm, millis());  // Incomplete messages are dropped as a whole.
+    return busy;
+}
 
-                if (status.code != ResponseStatus::SUCCESS) {
-                    term_printf("[EBYTE] Loopback error on enqueueing %d bytes, ", len);
-                    term_println(status.desc());
-                }
-                else {
-                    if (system_verbose_level >= VERBOSE_INFO) {
-                        term_printf("[EBYTE] Loopback enqueueing %3d bytes, q size %d" ENDL, len, ebyte.lengthMessageQueueTx());
-                    }
-                    s->loopback_tmo_millis = millis() + EBYTE_LOOPBACK_TMO_MS;  // Increase timeout for the end of loopback packet
+// ----------------------------------------------------------------------------
+/**
+ * @brief MAVLink msgid -> TX lane
+ */
+uint8_t ebyte_lane_of(uint32_t msgid, bool *latest) {
+    for (size_t i = 0; i < ebyte_lane_count; i++) {
+        if (ebyte_lanes[i].msgid == msgid) {
+            if (latest) *latest = ebyte_lanes[i].latest;
+            return ebyte_lanes[i].lane;
+        }
+    }
+    if (latest) *latest = false;
+    return EBYTE_LANE_TELEMETRY;
+}
+
+bool ebyte_lane_set(uint32_t msgid, uint8_t lane, bool latest) {
+    if (lane >= EBYTE_LANES) return false;
+    for (size_t i = 0; i < ebyte_lane_count; i++) {
+        if (ebyte_lanes[i].msgid == msgid) {
+            ebyte_lanes[i].lane = lane;
+            ebyte_lanes[i].latest = latest;
+            return true;
+        }
+    }
+    if (ebyte_lane_count >= ARRAY_SIZE(ebyte_lanes)) return false;
+    ebyte_lanes[ebyte_lane_count++] = {msgid, lane, latest};
+    return true;
+}
+
+const ebyte_lane_entry_t *ebyte_lane_table(size_t *count) {
+    *count = ebyte_lane_count;
+    return ebyte_lanes;
+}
+
+/**
+ * @brief Bytes the parser may take in under the flow control, as far as the pending frame goes:
+ *     up to the end of its header, where its lane is known, then the rest of it if the lane has a free slot.
+ *     Nothing is dropped on a full lane; the rest stays in the UART, for the flow control to hold the computer.
+ *     Only the lane of the frame being parsed holds the intake back, not a full lane of another class.
+ */
+static size_t ebyte_downlink_intake_room() {
+    const mavlink_parser_t *p = &ebyte_downlink_parser;
+    if (p->pos == 0) return MAVLINK_HEADER_LEN_V1;  // The shortest header; no frame is complete within it.
+    if (p->pos < p->header_len) return p->header_len - p->pos;
+
+    uint8_t lane = ebyte_lane_of(p->msgid, NULL);
+    if (ebyte.lengthLaneTx(lane) >= EBYTE_LANE_SLOTS) return 0;  // Until the lane drains
+    return p->frame_len - p->pos;  // The frame held in carry completes, whatever its length.
+}
+
+/**
+ * @brief Parse MAVLink frames from the computer into the TX lanes, even while the gaps hold TX back.
+ */
+static bool ebyte_downlink_intake() {
+    byte buf[EBYTE_MODULE_BUFFER_SIZE];
+    size_t total = 0;
+
+    while (total < ARRAY_SIZE(buf)) {  // A bufferful per step; under the flow control, a frame or less a read
+        size_t len = computer.available();
+        if (len > ARRAY_SIZE(buf) - total) len = ARRAY_SIZE(buf) - total;
+        if (ebyte_flow_control != FLOW_CTRL_NONE) {
+            size_t room = ebyte_downlink_intake_room();
+            if (len > room) len = room;
+        }
+        if (len == 0) break;
+
+        len = computer.readBytes(buf, len);
+        if (len == 0) break;
+        total += len;
+        uint32_t rx_cycles = ESP.getCycleCount();
+        ebyte_downlink_intake_millis = millis();
+
+        mavlink_frame_t frame;
+        mavlink_parse_begin(&ebyte_downlink_parser, buf, len);
+        while (mavlink_parse_next(&ebyte_downlink_parser, &frame)) {
+            ebyte_downlink_stx = frame.stx;
+
+            bool latest;
+            uint8_t lane = ebyte_lane_of(frame.msgid, &latest);
+            uint64_t key = (latest)? (1ULL << 63) | ((uint64_t)frame.msgid << 16) | (frame.sysid << 8) | frame.compid : 0;
+            ResponseStatus status = ebyte.enqueueLaneTx(lane, frame.head, frame.head_len, frame.body, frame.body_len, key);
+            if (status.code == ResponseStatus::SUCCESS) {
+                ebyte_lat_add(EBYTE_LAT_C2E_INTAKE, rx_cycles, ESP.getCycleCount());
+            }
+            else {
+                ebyte_count(EBYTE_CNT_DROP_LANE_FULL, 1);
+                ebyte_count(EBYTE_CNT_ALLOC_FAILS, 1);
+                if (system_verbose_level >= VERBOSE_WARNING) {
+                    termlog_printf("[EBYTE] C2E drop msgid %u on lane %d, %s" ENDL, frame.msgid, lane, status.descStr());
                 }
             }
+        }
+    }
+    return total > 0;
+}
 
+/**
+ * @brief Send the next packet of whole frames, taken from the lanes by priority.
+ */
+static bool ebyte_downlink_send_packed(ebyte_stat_t *s) {
+    // Pull no more than a packet, so a late control frame still goes in the next one.
+    byte frame[EBYTE_LANE_MESSAGE_SIZE];
+    size_t frame_len;
+    uint32_t wait_us;
+    while (ebyte_downlink_packer.len < ebyte_downlink_packer.mtu  &&  ebyte.lengthLanesTx() > 0) {
+        if (ebyte.dequeueLaneTx(frame, sizeof(frame), frame_len, NULL, &wait_us).code != ResponseStatus::SUCCESS) break;
+        uint32_t enq_cycles = ESP.getCycleCount() - wait_us * ebyte_cpu_mhz;  // Tagged, for the queue stage
+        if (!packer_push(&ebyte_downlink_packer, NULL, 0, frame, frame_len, enq_cycles)) {
+            ebyte_count(EBYTE_CNT_SEGMENT_TRUNCATED, frame_len);
         }
+    }
+
+    const uint8_t *packet;
+    size_t len = packer_peek(&ebyte_downlink_packer, &packet);
+    if (len == 0) return false;
+
+    // Not full, and no more frame can join it yet.
+    bool closed = (len < ebyte_downlink_packer.len  ||  len == ebyte_downlink_packer.mtu);
+    if (!closed  &&  millis() - ebyte_downlink_intake_millis < EBYTE_PACK_LINGER_MS) return false;
 
-        rc.close();
+    ResponseStatus status = ebyte.sendMessage(packet, len);  // Waits for room in the module FIFO
+    if (status.code == ResponseStatus::ERR_TIMEOUT) {
+        termlog_printf("[EBYTE] C2E error on waiting AUX HIGH, %s" ENDL, status.descStr());
     }
+    else if (status.code != ResponseStatus::SUCCESS) {
+        termlog_printf("[EBYTE] C2E error, %s" ENDL, status.descStr());
+        ebyte_count(EBYTE_CNT_SEND_ERRORS, 1);
+    }
+    else {
+        const EbyteTxStamps & ts = ebyte.getTxStamps();
+        ebyte_lat_add(EBYTE_LAT_C2E_QUEUE, packer_tag(&ebyte_downlink_packer), ts.aux_ready);
+        ebyte_lat_add(EBYTE_LAT_C2E_WRITE, ts.aux_ready, ts.written);
+        packer_consume(&ebyte_downlink_packer, len);
+        if (system_verbose_level >= VERBOSE_INFO) {
+            termlog_printf("[EBYTE] Send: %3d bytes packed" ENDL, len);
+        }
+        ebyte_count(EBYTE_CNT_C2E_PACKETS, 1);
+        ebyte_count(EBYTE_CNT_C2E_BYTES, len);
+        s->prev_departure_millis = millis();  // Departure time marking
+        return true;
+    }
+    return false;
 }
 
-// ----------------------------------------------------------------------------
-void ebyte_downlink_process(ebyte_stat_t *s) {
-    if (millis() < s->prev_arival_millis + ebyte_tbtw_rxtx_ms) {  // Space between RX then TX
-        return;
+/**
+ * @brief Anything to be sent: queued, packed, or of the ARQ
+ */
+static bool ebyte_downlink_pending() {
+    const arq_t & arq = ebyte.getArq();
+    return ebyte.lengthMessageQueueTx() > 0  ||  ebyte.lengthLanesTx() > 0  ||  ebyte_downlink_packer.len > 0
+        || (ebyte.isReliable()  &&  (arq.base != arq.next_seq  ||  arq.ack_pending));
+}
+
+/**
+ * @brief Downlink task body
+ *
+ * @return true if there was work
+ */
+static bool ebyte_downlink_process(ebyte_stat_t *s) {
+    bool busy = false;
+    if (ebyte_message_type == MSG_TYPE_MAVLINK) {
+        busy = ebyte_downlink_intake();
+    }
+
+    // Messages to loop back, handed over by the uplink task; kept in the ring while the queue is full.
+    const uint8_t *rec;
+    size_t rec_len;
+    while ((rec_len = spsc_peek(&ebyte_loopback_ring, &rec)) >= sizeof(EbytePacket)) {
+        EbytePacket pkt;
+        memcpy(&pkt, rec, sizeof(pkt));
+        size_t msg_len = pkt.size;
+        ResponseStatus status;
+        if (pkt.block >= 0) {  // A block of ours, lent to the uplink; queued in place
+            status = ebyte.enqueuePacketTx(pkt, msg_len);
+        }
+        else {
+            status = ebyte.fragmentMessageQueueTx(rec + sizeof(pkt), rec_len - sizeof(pkt));
+        }
+        if (status.code == ResponseStatus::ERR_QUEUE_FULL) {
+            ebyte_count(EBYTE_CNT_ALLOC_FAILS, 1);  // Retried on the next step
+            break;
+        }
+
+        if (status.code != ResponseStatus::SUCCESS) {
+            termlog_printf("[EBYTE] Loopback error on enqueueing %d bytes, %s" ENDL, msg_len, status.descStr());
+            ebyte_count(EBYTE_CNT_DROP_LOOPBACK, 1);
+        }
+        else if (system_verbose_level >= VERBOSE_DEBUG) {
+            termlog_printf("[EBYTE] Loopback queued %3d bytes, q size %d" ENDL, msg_len, ebyte.lengthMessageQueueTx());
+        }
+        if (pkt.block >= 0) {  // Queued or dropped, not lent anymore; the queue keeps its own reference.
+            ebyte.releasePacket(pkt);
+            ebyte_rx_pool_lent--;
+        }
+        spsc_pop(&ebyte_loopback_ring);
+        busy = true;
+    }
+
+    // Blocks for the uplink to receive into, while looping back; those lent stay lent once it is off.
+    while (ebyte_loopback_flag  &&  ebyte_rx_pool_lent < EBYTE_RX_POOL_BLOCKS) {
+        EbytePacket pkt;
+        if (!ebyte.allocPacket(pkt)) break;
+        if (!spsc_push(&ebyte_rx_pool_ring, &pkt, sizeof(pkt))) {
+            ebyte.releasePacket(pkt);
+            break;
+        }
+        ebyte_rx_pool_lent++;
+    }
+
+    // Space between RX then TX, shorter for a head that has waited long under it, see gap_rxtx_hold().
+    // Raw messages are read from the computer only once past the gaps; so, waiting there too.
+    uint32_t now = millis();
+    bool waiting = ebyte_downlink_pending()  ||  computer.available() > 0;
+    if (!waiting  ||  (int32_t)(s->prev_departure_millis - ebyte_downlink_head_millis) > 0) {
+        ebyte_downlink_head_millis = now;  // A new head from here
+    }
+    if (now - s->prev_arival_millis < gap_rxtx_hold(ebyte_tbtw_rxtx_ms, now - ebyte_downlink_head_millis)) {
+        return busy;
     }
 
     if (millis() < s->prev_departure_millis + ebyte_tbtw_txtx_ms) {  // Space between sent TX frames
-        return;
+        return busy;
     }
 
     //////////////////////////////////
     // Loopback, to the another end //
     //////////////////////////////////
+    // Also the fragments of raw messages.
     // if no more data to be queued, and queue is ready.
     if (ebyte.available() == 0
-    &&  ebyte.lengthMessageQueueTx() > 0
-    &&  millis() > s->loopback_tmo_millis) {
+    &&  ebyte.hasMessageQueueTx()) {
         size_t len = ebyte.processMessageQueueTx();  // Send out the loopback frames
 
         if (len == 0) {
-            term_println(F("[EBYTE] Loopback error on sending queue!"));
+            termlog_printf("[EBYTE] Loopback error on sending queue!" ENDL);
+            ebyte_count(EBYTE_CNT_SEND_ERRORS, 1);
         }
         else {
+            const EbyteTxStamps & ts = ebyte.getTxStamps();
+            if (ts.enqueued != 0) ebyte_lat_add(EBYTE_LAT_C2E_QUEUE, ts.enqueued, ts.aux_ready);
+            ebyte_lat_add(EBYTE_LAT_C2E_WRITE, ts.aux_ready, ts.written);
             if (system_verbose_level >= VERBOSE_DEBUG) {
-                term_printf("[EBYTE] Loopback sending queue %3d bytes, q size %d" ENDL, len, ebyte.lengthMessageQueueTx());
+                termlog_printf("[EBYTE] Loopback sending queue %3d bytes, q size %d" ENDL, len, ebyte.lengthMessageQueueTx());
             }
-            s->downlink_byte_sum += len;  // Kepp stat
+            ebyte_count(EBYTE_CNT_C2E_PACKETS, 1);
+            ebyte_count(EBYTE_CNT_C2E_BYTES, len);
             s->prev_departure_millis = millis();  // Departure time marking
+            busy = true;
         }
     }
 
@@ -266,83 +804,495 @@ void ebyte_downlink_process(ebyte_stat_t *s) {
     // Forward downlink //
     //////////////////////
     // from upper to lower, if no more loopback queued frame.
-    if (computer.available()) {
-        ResponseStatus status;
-        status = ebyte.auxReady(EBYTE_NO_AUX_WAIT);
-
-        // Forward downlink
-        if (status.code == ResponseStatus::SUCCESS) {
-            byte buf[EBYTE_MODULE_BUFFER_SIZE];
-            size_t len = (computer.available() < ARRAY_SIZE(buf))? computer.available() : ARRAY_SIZE(buf);
+    if (ebyte_message_type == MSG_TYPE_MAVLINK  ||  ebyte_downlink_packer.len > 0  ||  ebyte.lengthLanesTx() > 0) {
+        busy |= ebyte_downlink_send_packed(s);  // Also flush the leftover after switching to raw.
+    }
+    else if (computer.available()) {
+        // One message of up to FRAG_MAX_MESSAGE bytes, queued as fragments sent back-to-back above.
+        static byte buf[FRAG_MAX_MESSAGE];
+        size_t max_len = ebyte.availableMessageQueueTx() * ebyte.maxMessageSize();  // Whole message, or nothing
+        if (max_len > sizeof(buf)) max_len = sizeof(buf);
+        size_t len = ((size_t)computer.available() < max_len)? computer.available() : max_len;
+
+        if (len > 0) {
             computer.readBytes(buf, len);
+            uint32_t rx_cycles = ESP.getCycleCount();
+            busy = true;
 
-            status = ebyte.sendMessage(buf, len);
+            ResponseStatus status = ebyte.fragmentMessageQueueTx(buf, len);
+            if (status.code == ResponseStatus::SUCCESS) {
+                ebyte_lat_add(EBYTE_LAT_C2E_INTAKE, rx_cycles, ESP.getCycleCount());
+            }
 
             if (status.code != ResponseStatus::SUCCESS) {
-                term_print("[EBYTE] C2E error, ");
-                term_println(status.desc());
+                termlog_printf("[EBYTE] C2E error, %s" ENDL, status.descStr());
+                ebyte_count(EBYTE_CNT_DROP_QUEUE_FULL, 1);
+                if (status.code == ResponseStatus::ERR_QUEUE_FULL) ebyte_count(EBYTE_CNT_ALLOC_FAILS, 1);
             }
-            else {
-                if (system_verbose_level >= VERBOSE_INFO) {
-                    term_printf("[EBYTE] Send: %3d bytes" ENDL, len);
-                }
-                s->downlink_byte_sum += len;  // Keep stat
-                s->prev_departure_millis = millis();  // Departure time marking
+            else if (system_verbose_level >= VERBOSE_INFO) {
+                termlog_printf("[EBYTE] Send: %3d bytes, q size %d" ENDL, len, ebyte.lengthMessageQueueTx());
             }
         }
-        else {
-            term_printf("[EBYTE] C2E error on waiting AUX HIGH, ");
-            term_println(status.desc());
-        }
+    }
+    return busy;
+}
+
+// ----------------------------------------------------------------------------
+/**
+ * @brief Fill of the fullest buffer the computer feeds: the UART RX buffer or any TX lane, in %
+ */
+static uint32_t ebyte_buffer_used_pct() {
+    uint32_t used = computer.available() * 100 / EBYTE_FC_RX_BUFFER_SIZE;
+    for (uint8_t i = 0; i < EBYTE_LANES; i++) {
+        uint32_t lane_used = ebyte.lengthLaneTx(i) * 100 / EBYTE_LANE_SLOTS;
+        if (lane_used > used) used = lane_used;
+    }
+    return used;
+}
+
+/**
+ * @brief Select the flow control of the computer UART; the radio tasks are held meanwhile.
+ *     RTS is a GPIO driven by the watermarks; the UART's own RTS only follows its 128-byte FIFO,
+ *         which is drained into the RX buffer long before the buffer is full.
+ *     CTS from the computer gates our UART TX in hardware.
+ *     XON/XOFF bytes are sent by the uplink task, between whole frames; the computer must not expect them
+ *         inside binary data.
+ */
+void ebyte_set_flow_control(uint8_t mode) {
+    ebyte_pause();  // ebyte_flow_paused & the computer UART are ours till the end.
+
+    __atomic_store_n(&ebyte_flow_xchar, 0, __ATOMIC_RELEASE);
+    if (ebyte_flow_paused) {  // Release the computer of the old mode first.
+        if (ebyte_flow_control == FLOW_CTRL_RTSCTS) digitalWrite(EBYTE_FC_PIN_RTS, LOW);
+        if (ebyte_flow_control == FLOW_CTRL_XONXOFF) computer.write(EBYTE_FLOW_XON);
+        ebyte_flow_paused = false;
+    }
+
+    ebyte_flow_control = mode;
+    if (mode == FLOW_CTRL_RTSCTS) {
+        pinMode(EBYTE_FC_PIN_RTS, OUTPUT);
+        digitalWrite(EBYTE_FC_PIN_RTS, LOW);
+        computer.setPins(EBYTE_FC_PIN_RX, EBYTE_FC_PIN_TX, EBYTE_FC_PIN_CTS, -1);
+        computer.setHwFlowCtrlMode(HW_FLOWCTRL_CTS);
+    }
+    else {
+        computer.setHwFlowCtrlMode(HW_FLOWCTRL_DISABLE);
+    }
+
+    ebyte_resume();
+}
+
+/**
+ * @brief Pause the computer above the high watermark, resume below the low one.
+ */
+static void ebyte_flow_control_process() {
+    if (ebyte_flow_control == FLOW_CTRL_NONE) return;
+
+    uint32_t used = ebyte_buffer_used_pct();
+    bool pause;
+    if (!ebyte_flow_paused  &&  used >= EBYTE_FLOW_HIGH_PCT) pause = true;
+    else if (ebyte_flow_paused  &&  used <= EBYTE_FLOW_LOW_PCT) pause = false;
+    else return;
+
+    if (ebyte_flow_control == FLOW_CTRL_RTSCTS) {
+        digitalWrite(EBYTE_FC_PIN_RTS, (pause)? HIGH : LOW);
+    }
+    else {  // Not to land inside a frame the uplink task is writing
+        __atomic_store_n(&ebyte_flow_xchar, (pause)? EBYTE_FLOW_XOFF : EBYTE_FLOW_XON, __ATOMIC_RELEASE);
+        xSemaphoreGive(ebyte_uplink_task_stat.wake);
+    }
+    ebyte_flow_paused = pause;
+    if (pause) ebyte_count(EBYTE_CNT_FLOW_PAUSES, 1);
+
+    if (system_verbose_level >= VERBOSE_DEBUG) {
+        termlog_printf("[EBYTE] Flow %s at %u%%" ENDL, (pause)? "paused" : "resumed", used);
+    }
+}
+
+// ----------------------------------------------------------------------------
+/**
+ * @brief Report our buffer room to the computer, between the uplink frames.
+ *     'txbuf' is the free share of the fullest buffer: the computer UART or any TX lane.
+ */
+static void ebyte_radio_status_process() {
+    static uint32_t next_millis = 0;
+    static uint8_t seq = 0;
+
+    uint32_t now = millis();
+    if (ebyte_message_type != MSG_TYPE_MAVLINK  ||  ebyte_radio_status_ms == 0  ||  now < next_millis) {
+        return;
+    }
+    next_millis = now + ebyte_radio_status_ms;
+
+    uint32_t used = ebyte_buffer_used_pct();
+    ebyte_radio_status_txbuf = (used < 100)? 100 - used : 0;
+
+    mavlink_radio_status_t rs = {
+        .rxerrors = (uint16_t)ebyte_uplink_parser.stat.crc_errors,
+        .fixed = (uint16_t)ebyte_uplink_reasm.stat.recovered,  // Rebuilt by FEC, raw type only
+        .rssi = UINT8_MAX,  // Not reported by the module in transparent mode
+        .remrssi = UINT8_MAX,
+        .txbuf = ebyte_radio_status_txbuf,
+        .noise = UINT8_MAX,
+        .remnoise = UINT8_MAX,
+    };
+    byte frame[MAVLINK_MAX_FRAME_LEN];
+    size_t len = mavlink_pack_radio_status(frame, ebyte_downlink_stx, seq++,
+                                           EBYTE_RADIO_STATUS_SYSID, EBYTE_RADIO_STATUS_COMPID, &rs);
+    if (computer.write(frame, len) != len) {
+        termlog_printf("[EBYTE] E2C error. Cannot write all RADIO_STATUS" ENDL);
+    }
+    else if (system_verbose_level >= VERBOSE_DEBUG) {
+        termlog_printf("[EBYTE] RADIO_STATUS txbuf:%u%% rxerrors:%u" ENDL, rs.txbuf, rs.rxerrors);
     }
 }
 
 // ----------------------------------------------------------------------------
-void ebyte_process() {
-    static ebyte_stat_t stat {};
+/**
+ * @brief Loss signals for the gap controller, as a running sum:
+ *     CRC errors of the framing & of MAVLink, reassembly timeouts, and ARQ retransmits.
+ *     The first three are kept by the uplink task; a word read of them is enough here.
+ */
+static uint32_t ebyte_gap_losses() {
+    return ebyte_uplink_decoder.stat.crc_errors + ebyte_uplink_parser.stat.crc_errors
+         + ebyte_uplink_reasm.stat.timeouts + ebyte.getArq().stat.retransmits;
+}
+
+// ----------------------------------------------------------------------------
+/**
+ * @brief Downlink task body, with the flow control & the adaptive gaps
+ */
+static bool ebyte_downlink_step() {
+    ebyte_stat_t & stat = ebyte_stat;
+    ebyte.setFraming(ebyte_message_type == MSG_TYPE_RAW);  // MAVLink frames carry their own CRC.
+    ebyte.setReliable(ebyte_reliable  &&  ebyte_message_type == MSG_TYPE_RAW);
+    ebyte.setFec(ebyte_fec_k, ebyte_fec_n);
+
+    // Arrivals -- arriving while our own packet is still on air is a half-duplex collision.
+    const uint8_t *rec;
+    while (spsc_peek(&ebyte_arrival_ring, &rec) == sizeof(uint32_t)) {
+        uint32_t arrival;
+        memcpy(&arrival, rec, sizeof(arrival));
+        spsc_pop(&ebyte_arrival_ring);
+        gap_on_arrival(arrival);
+        gap_on_feedback(arrival - stat.prev_departure_millis < gap_get_estimate()->busy_ms);
+    }
+    uint32_t losses = ebyte_gap_losses();
+    if (losses > stat.gap_losses) {  // Lower on a reset, e.g. of the reassembly table; taken as is.
+        for (uint32_t i = stat.gap_losses; i < losses; i++) gap_on_feedback(true);
+    }
+    stat.gap_losses = losses;
+
+    bool busy = ebyte_downlink_process(&stat);
+    ebyte_flow_control_process();
 
     //
-    // Uplink -- Ebyte to Computer
+    // Adaptive gaps
     //
-    ebyte_uplink_process(&stat);
+    EbyteAuxStat aux = ebyte.getAuxStat();
+    if (aux.busy_count != stat.aux_busy_count) {
+        stat.aux_busy_count = aux.busy_count;
+        gap_on_aux_busy(aux.busy_last_us);
+        if (stat.prev_departure_millis >= stat.prev_arival_millis) {  // Our own TX, nothing received since
+            ebyte_count(EBYTE_CNT_TX_AIR_US, aux.busy_last_us);
+        }
+    }
 
     //
-    // Downlink -- Computer to Ebyte
+    // Counters kept by the module
     //
-    ebyte_downlink_process(&stat);
+    if (aux.ready_timeouts != stat.aux_ready_timeouts) {
+        ebyte_count(EBYTE_CNT_AUX_TIMEOUTS, aux.ready_timeouts - stat.aux_ready_timeouts);
+        stat.aux_ready_timeouts = aux.ready_timeouts;
+    }
+    uint32_t overflows = ebyte.getUartStat().overflows;
+    if (overflows != stat.uart_overflows) {
+        ebyte_count(EBYTE_CNT_UART_OVERFLOWS, overflows - stat.uart_overflows);
+        stat.uart_overflows = overflows;
+    }
+    ebyte_count_max(EBYTE_CNT_QUEUE_HWM, ebyte.lengthMessageQueueTx() + ebyte.lengthLanesTx());
+    gap_set_manual(ebyte_tbtw_manual);
+    gap_update(&ebyte_tbtw_rxtx_ms, &ebyte_tbtw_txtx_ms);
+    return busy;
+}
+
+/**
+ * @brief Longest sleep of the downlink task: a tick while anything is to be sent, for the gaps & the timers.
+ */
+static TickType_t ebyte_downlink_idle_ticks() {
+    return (ebyte_downlink_pending())? 1 : pdMS_TO_TICKS(EBYTE_TASK_IDLE_MS);
+}
+
+/**
+ * @brief Uplink task body, with XON/XOFF & RADIO_STATUS between whole frames
+ */
+static bool ebyte_uplink_step() {
+    bool busy = ebyte_uplink_process(&ebyte_stat);
+
+    uint8_t xchar = __atomic_exchange_n(&ebyte_flow_xchar, 0, __ATOMIC_ACQ_REL);  // Only the latest state matters.
+    if (xchar != 0) computer.write(xchar);
+
+    ebyte_radio_status_process();
+    return busy;
+}
+
+static TickType_t ebyte_uplink_idle_ticks() {
+    return pdMS_TO_TICKS(EBYTE_TASK_IDLE_MS);
+}
+
+/**
+ * @brief Run a radio task; with no work, it sleeps until woken by a UART event or until the idle ticks.
+ */
+static void ebyte_task_run(ebyte_task_stat_t *t, bool (*step)(), TickType_t (*idle_ticks)()) {
+    uint32_t yield_millis = millis();
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&ebyte_pause_seq, __ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&ebyte_pause_depth, __ATOMIC_ACQUIRE) > 0) {
+            __atomic_store_n(&t->paused_seq, seq, __ATOMIC_RELEASE);  // Nothing on the module from now on
+            vTaskDelay(1);
+            continue;
+        }
+
+        uint32_t start = micros();
+        bool busy = step();
+        if (busy) t->busy_us += micros() - start;
+
+        if (!busy) {
+            xSemaphoreTake(t->wake, idle_ticks());
+            yield_millis = millis();
+        }
+        else if (millis() - yield_millis >= EBYTE_TASK_YIELD_MS) {
+            vTaskDelay(1);
+            yield_millis = millis();
+        }
+    }
+}
+
+static void ebyte_uplink_task(void *) {
+    ebyte_task_run(&ebyte_uplink_task_stat, ebyte_uplink_step, ebyte_uplink_idle_ticks);
+}
+
+static void ebyte_downlink_task(void *) {
+    ebyte_task_run(&ebyte_downlink_task_stat, ebyte_downlink_step, ebyte_downlink_idle_ticks);
+}
+
+/**
+ * @brief Hold the radio tasks off the module, e.g. to configure it; returns once both have stopped.
+ *     Called from loop() only.
+ */
+void ebyte_pause() {
+    if (__atomic_fetch_add(&ebyte_pause_depth, 1, __ATOMIC_SEQ_CST) > 0) return;  // Already held
+    uint32_t seq = __atomic_add_fetch(&ebyte_pause_seq, 1, __ATOMIC_SEQ_CST);  // After the depth, seen by the tasks
+
+    ebyte_task_stat_t *tasks[] = {&ebyte_uplink_task_stat, &ebyte_downlink_task_stat};
+    for (uint8_t i = 0; i < ARRAY_SIZE(tasks); i++) {
+        if (tasks[i]->handle == NULL) continue;  // Not started yet
+        while (__atomic_load_n(&tasks[i]->paused_seq, __ATOMIC_ACQUIRE) != seq) vTaskDelay(1);
+    }
+}
+
+void ebyte_resume() {
+    if (ebyte_pause_depth > 0) {
+        __atomic_sub_fetch(&ebyte_pause_depth, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+/**
+ * @brief CPU load since the last report, in %
+ */
+static uint32_t ebyte_task_load_pct(ebyte_task_stat_t *t) {
+    uint32_t now = micros();
+    uint32_t busy = t->busy_us;  // Only ever added to, by the task
+    uint32_t elapsed = now - t->report_micros;
+    uint32_t pct = (elapsed > 0)? (uint32_t)((uint64_t)(busy - t->report_busy_us) * 100 / elapsed) : 0;
+    t->report_busy_us = busy;
+    t->report_micros = now;
+    return pct;
+}
+
+// ----------------------------------------------------------------------------
+void ebyte_report_process() {
+    ebyte_stat_t & stat = ebyte_stat;
 
     //
     // Statistic calculation
     //
     uint32_t now = millis();
     if (now > stat.report_millis) {
+        // Since the last report, from the counters; a reset in between restarts from zero.
+        uint32_t cnt[EBYTE_CNT_COUNT], d[EBYTE_CNT_COUNT];
+        ebyte_counters_read(cnt, false);
+        for (uint8_t i = 0; i < EBYTE_CNT_COUNT; i++) {
+            d[i] = (cnt[i] >= stat.report_counters[i])? cnt[i] - stat.report_counters[i] : cnt[i];
+        }
+        uint32_t tx_air_us = d[EBYTE_CNT_TX_AIR_US];
+
         if (ebyte_show_report_count > 0  ||  ebyte_show_report_count < 0) {
-            float period = (EBYTE_REPORT_PERIOD_MS + (now - stat.report_millis)) / 1000;  // Int. division
-            float up_rate = stat.uplink_byte_sum / period;
-            float down_rate = stat.downlink_byte_sum / period;  // per second
+            float period = (now - stat.report_start_millis) / 1000.0f;
+            float up_rate = d[EBYTE_CNT_E2C_BYTES] / period;
+            float down_rate = d[EBYTE_CNT_C2E_BYTES] / period;  // per second
 
             char inter_arival_str[10];
-            if (stat.inter_arival_count > 0) {
-                snprintf(inter_arival_str, sizeof(inter_arival_str), "%dms", stat.inter_arival_sum_millis / stat.inter_arival_count);
+            if (d[EBYTE_CNT_E2C_PACKETS] > 0) {
+                snprintf(inter_arival_str, sizeof(inter_arival_str), "%dms", d[EBYTE_CNT_E2C_GAP_MS] / d[EBYTE_CNT_E2C_PACKETS]);
             } else {
                 snprintf(inter_arival_str, sizeof(inter_arival_str), "--ms");
             }
-            stat.inter_arival_sum_millis = 0;
-            stat.inter_arival_count = 0;
 
             term_printf("[Ebyte] Report up:%.2fB/s down:%.2fB/s period:%.2fs inter_arival:%s" ENDL,
                 up_rate, down_rate, period, inter_arival_str);
 
+            const EbyteBufferStat & buf_stat = ebyte.getBufferStat();
+            term_printf("[Ebyte] Buffer heap_allocs:%u copy_bytes:%u pool_misses:%u" ENDL,
+                buf_stat.heap_allocs, buf_stat.copy_bytes, buf_stat.pool_misses);
+
+            if (ebyte_flow_control != FLOW_CTRL_NONE) {
+                term_printf("[Ebyte] Flow %s:%s pauses:%u buffer:%u%%" ENDL,
+                    (ebyte_flow_control == FLOW_CTRL_RTSCTS)? "rtscts" : "xonxoff", (ebyte_flow_paused)? "paused" : "running",
+                    cnt[EBYTE_CNT_FLOW_PAUSES], ebyte_buffer_used_pct());
+            }
+
+            EbyteAuxStat aux_stat = ebyte.getAuxStat();
+            // Stack high-water marks are in bytes on ESP32.
+            term_printf("[Ebyte] Task uplink load:%u%% stack_free:%uB downlink load:%u%% stack_free:%uB loop stack_free:%uB" ENDL,
+                ebyte_task_load_pct(&ebyte_uplink_task_stat),
+                (ebyte_uplink_task_stat.handle)? uxTaskGetStackHighWaterMark(ebyte_uplink_task_stat.handle) : 0,
+                ebyte_task_load_pct(&ebyte_downlink_task_stat),
+                (ebyte_downlink_task_stat.handle)? uxTaskGetStackHighWaterMark(ebyte_downlink_task_stat.handle) : 0,
+                uxTaskGetStackHighWaterMark(NULL));
+
+            termlog_stat_t log_stat = termlog_stat();
+            term_printf("[Ebyte] Log posted:%u dropped:%u" ENDL, log_stat.posted, log_stat.dropped);
+
+            EbyteUartStat uart = ebyte.getUartStat();
+            term_printf("[Ebyte] UART ebyte rx_events:%u overflows:%u breaks:%u errors:%u"
+                " computer rx_events:%u overflows:%u breaks:%u errors:%u" ENDL,
+                uart.rx_events, uart.overflows, uart.breaks, uart.errors,
+                ebyte_computer_uart_stat.rx_events, ebyte_computer_uart_stat.overflows,
+                ebyte_computer_uart_stat.breaks, ebyte_computer_uart_stat.errors);
+
+            term_printf("[Ebyte] AUX busy count:%u avg:%uus max:%uus last:%uus edge_drops:%u" ENDL,
+                aux_stat.busy_count, (aux_stat.busy_count > 0)? aux_stat.busy_sum_us / aux_stat.busy_count : 0,
+                aux_stat.busy_max_us, aux_stat.busy_last_us, aux_stat.edge_drops);
+
+            if (tx_air_us > 0) {  // Payload bytes per second of airtime
+                term_printf("[Ebyte] Goodput:%.2fB/s airtime:%.3fs" ENDL,
+                    d[EBYTE_CNT_C2E_BYTES] * 1e6 / tx_air_us, tx_air_us / 1e6);
+            } else {
+                term_printf("[Ebyte] Goodput:--B/s airtime:0s" ENDL);
+            }
+
+            if (ebyte_message_type == MSG_TYPE_RAW) {
+                const framing_stat_t & frm_stat = ebyte_uplink_decoder.stat;
+                term_printf("[Ebyte] Framing frames:%u crc_errors:%u overflows:%u" ENDL,
+                    frm_stat.frames, frm_stat.crc_errors, frm_stat.overflows);
+
+                const frag_stat_t & frag_stat = ebyte_uplink_reasm.stat;
+                term_printf("[Ebyte] Reassembly messages:%u fragments:%u timeouts:%u evictions:%u malformed:%u recovered:%u late:%u" ENDL,
+                    frag_stat.messages, frag_stat.fragments, frag_stat.timeouts, frag_stat.evictions, frag_stat.malformed,
+                    frag_stat.recovered, frag_stat.late);
+
+                if (ebyte.isReliable()) {
+                    const arq_t & arq = ebyte.getArq();
+                    term_printf("[Ebyte] ARQ sent:%u retransmits:%u acked:%u gave_up:%u acks:%u window:%u rto:%ums srtt:%ums" ENDL,
+                        arq.stat.sent, arq.stat.retransmits, arq.stat.acked, arq.stat.gave_up, arq.stat.acks_sent,
+                        arq.window, arq.rto_ms, arq.srtt_ms);
+                    term_printf("[Ebyte] ARQ delivered:%u duplicates:%u reordered:%u skipped:%u" ENDL,
+                        arq.stat.delivered, arq.stat.duplicates, arq.stat.reordered, arq.stat.skipped);
+                    if (tx_air_us > 0) {  // Acked payload bytes per second of airtime
+                        term_printf("[Ebyte] ARQ goodput:%.2fB/s" ENDL,
+                            (arq.stat.acked_bytes - stat.arq_acked_bytes) * 1e6 / tx_air_us);
+                    }
+                    stat.arq_acked_bytes = arq.stat.acked_bytes;
+                }
+            }
+
+            if (ebyte_message_type == MSG_TYPE_MAVLINK) {
+                const mavlink_parser_stat_t & mav_stat = ebyte_uplink_parser.stat;
+                term_printf("[Ebyte] MAVLink frames:%u crc_errors:%u unknown_msgids:%u skipped_bytes:%u txbuf:%u%%" ENDL,
+                    mav_stat.frames, mav_stat.crc_errors, mav_stat.unknown_msgids, mav_stat.skipped_bytes,
+                    ebyte_radio_status_txbuf);
+
+                for (uint8_t i = 0; i < EBYTE_LANES; i++) {
+                    const EbyteLaneStat & lane_stat = ebyte.getLaneStat(i);
+                    term_printf("[Ebyte] Lane %d sent:%u coalesced:%u drops:%u age avg:%ums max:%ums" ENDL, i,
+                        lane_stat.dequeued, lane_stat.coalesced, lane_stat.drops,
+                        (lane_stat.dequeued > 0)? (uint32_t)(lane_stat.wait_sum_us / lane_stat.dequeued / 1000) : 0,
+                        lane_stat.wait_max_us / 1000);
+                }
+
+                const packer_stat_t & pack_stat = ebyte_downlink_packer.stat;
+                term_printf("[Ebyte] Pack packets:%u frames:%u fill:%u%% splits:%u drops:%u" ENDL,
+                    pack_stat.packets, pack_stat.frames,
+                    (pack_stat.packets > 0)? pack_stat.bytes * 100 / (pack_stat.packets * ebyte_downlink_packer.mtu) : 0,
+                    pack_stat.splits, pack_stat.drops);
+            }
+
             if (ebyte_show_report_count > 0)
                 ebyte_show_report_count--;
         }
 
-        stat.uplink_byte_sum = 0;
-        stat.downlink_byte_sum = 0;
+        memcpy(stat.report_counters, cnt, sizeof(cnt));
+        stat.report_start_millis = now;
         stat.report_millis = now + EBYTE_REPORT_PERIOD_MS;
     }
 }
 
+// ----------------------------------------------------------------------------
+/**
+ * @brief Latency of the stages, as a table, or as a single line to be parsed:
+ *     "STATS <stage>:<count>,<p50>,<p90>,<p99>,<max> ..." in us
+ */
+void ebyte_stats_print(bool line) {
+    if (line) {
+        term_print("STATS");
+        for (uint8_t i = 0; i < EBYTE_LAT_STAGES; i++) {
+            const lat_hist_t *h = &ebyte_lat[i];
+            term_printf(" %s:%u,%u,%u,%u,%u", ebyte_lat_names[i], h->count,
+                lat_percentile(h, 50), lat_percentile(h, 90), lat_percentile(h, 99), h->max);
+        }
+        term_print(ENDL);
+        return;
+    }
+
+    term_printf("[Ebyte] Latency %-12s %8s %8s %8s %8s %8s (us)" ENDL, "stage", "count", "p50", "p90", "p99", "max");
+    for (uint8_t i = 0; i < EBYTE_LAT_STAGES; i++) {
+        const lat_hist_t *h = &ebyte_lat[i];
+        term_printf("[Ebyte] Latency %-12s %8u %8u %8u %8u %8u" ENDL, ebyte_lat_names[i], h->count,
+            lat_percentile(h, 50), lat_percentile(h, 90), lat_percentile(h, 99), h->max);
+    }
+}
+
+/**
+ * @brief Zero the histograms, with the tasks held off them; from loop() only.
+ */
+void ebyte_stats_reset() {
+    ebyte_pause();  // The tasks add to them with plain stores
+    for (uint8_t i = 0; i < EBYTE_LAT_STAGES; i++) {
+        lat_reset(&ebyte_lat[i]);
+    }
+    ebyte_resume();
+}
+
+// ----------------------------------------------------------------------------
+/**
+ * @brief Snapshot of the link counters, optionally resetting them at once.
+ *
+ * On a reset, each counter is read & zeroed in one atomic exchange; an add lands either before it,
+ *     in the snapshot, or after it, in the new count. Counters are taken one by one, though,
+ *     so the snapshot as a whole is not of a single instant.
+ */
+void ebyte_counters_read(uint32_t *out, bool reset) {
+    for (uint8_t i = 0; i < EBYTE_CNT_COUNT; i++) {
+        out[i] = (reset)? __atomic_exchange_n(&ebyte_counters[i], 0, __ATOMIC_RELAXED)
+                        : __atomic_load_n(&ebyte_counters[i], __ATOMIC_RELAXED);
+    }
+}
+
+const char *ebyte_counter_name(uint8_t id) {
+    return (id < EBYTE_CNT_COUNT)? ebyte_counter_names[id] : "?";
+}
+
 // ----------------------------------------------------------------------------
 /**
  * @brief Get configuration information.
@@ -372,6 +1322,7 @@ ResponseStructContainer ebyte_set_config(EbyteSetter & setter) {
  * @brief ebyte_setter
  */
 void ebyte_set_configs(EbyteSetter & setter) {
+    ebyte_pause();
     ebyte.setBpsRate(EBYTE_CONFIG_BAUD);  // Change the baudrate for configuring.
 
     // Setting
@@ -395,6 +1346,7 @@ void ebyte_set_configs(EbyteSetter & setter) {
     }
 
     ebyte.setBpsRate(EBYTE_BAUD);  // Change the baudrate for data transfer.
+    ebyte_resume();
 }
 
 /**
@@ -66,6 +66,24 @@ EbyteVersion * EbyteE28::createVersion(void) const {
 }
 
 
+/**
+ * @brief Air rate in bit/s, 0 if unknown
+ */
+uint32_t EbyteE28::airRateBps(Configuration & config) const {
+    EB::Speed * spd = (EB::Speed *)&config.speed;
+    switch (spd->airDataRate) {
+        case EB::AIR_RATE_1K:   return 1000;
+        case EB::AIR_RATE_5K:   return 5000;
+        case EB::AIR_RATE_10K:  return 10000;
+        case EB::AIR_RATE_50K:  return 50000;
+        case EB::AIR_RATE_100K: return 100000;
+        case EB::AIR_RATE_1M:   return 1000000;
+        case EB::AIR_RATE_2M:   return 2000000;
+    }
+    return 0;
+}
+
+
 /**
  * @brief Print debug
  */
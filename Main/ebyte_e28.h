@@ -34,6 +34,9 @@
 #include "ebyte_module.h"
 
 
+#define E28_FIFO_SIZE 220  // Module internal buffer, as shown in the datasheet
+
+
 namespace E28 {
 
 enum UART_PARITY {
@@ -266,6 +269,8 @@ class EbyteE28 : public EbyteModule {
     void printParameters(Configuration & config) const override;
 
   protected:
+    size_t   fifoSize() const override { return E28_FIFO_SIZE; }
+    uint32_t airRateBps(Configuration & config) const override;
     EbyteMode * createMode(void) const override;
     EbyteVersion * createVersion(void) const override;
 };
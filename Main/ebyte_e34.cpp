@@ -67,6 +67,21 @@ EbyteVersion * EbyteE34::createVersion(void) const {
 }
 
 
+/**
+ * @brief Air rate in bit/s, 0 if unknown
+ */
+uint32_t EbyteE34::airRateBps(Configuration & config) const {
+    EB::Speed * spd = (EB::Speed *)&config.speed;
+    switch (spd->airDataRate) {
+        case EB::AIR_RATE_250: return 250000;
+        case EB::AIR_RATE_1M:  return 1000000;
+        case EB::AIR_RATE_2M:
+        case EB::AIR_RATE_2M_: return 2000000;
+    }
+    return 0;
+}
+
+
 /**
  * @brief Print debug
  */
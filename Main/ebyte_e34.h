@@ -34,6 +34,9 @@
 #include "ebyte_module.h"
 
 
+#define E34_FIFO_SIZE 256  // Module internal buffer, as shown in the datasheet
+
+
 namespace E34 {
 
 enum REVISION {
@@ -268,6 +271,8 @@ class EbyteE34 : public EbyteModule {
     void printParameters(Configuration & config) const override;
 
   protected:
+    size_t   fifoSize() const override { return E34_FIFO_SIZE; }
+    uint32_t airRateBps(Configuration & config) const override;
     E34::REVISION revision;
     EbyteMode * createMode(void) const override;
     EbyteVersion * createVersion(void) const override;
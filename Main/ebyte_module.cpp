@@ -35,6 +35,7 @@
 
 EbyteModule::EbyteModule(HardwareSerial * serial, byte auxPin, uint8_t mPin_cnt, uint8_t * mPins, byte rxPin, byte txPin) {
     this->hs = serial;
+    this->port = hal_serial_of(serial);
 
     this->auxPin = auxPin;
     pinMode(this->auxPin, INPUT);
@@ -45,7 +46,11 @@ EbyteModule::EbyteModule(HardwareSerial * serial, byte auxPin, uint8_t mPin_cnt,
     this->rxPin = rxPin;
     this->txPin = txPin;
 
-    q_init(&this->queueTx);
+    sq_init(&this->queueTx, this->queueTxSlab, EBYTE_MODULE_BUFFER_SIZE, EBYTE_QUEUE_TX_SLOTS);
+    arq_init(&this->arq);
+    for (uint8_t i = 0; i < EBYTE_LANES; i++) {
+        sq_init(&this->laneTx[i], this->laneTxSlab[i], sizeof(EbyteLaneHeader) + EBYTE_LANE_MESSAGE_SIZE, EBYTE_LANE_SLOTS);
+    }
 }
 
 EbyteModule::~EbyteModule() {
@@ -56,14 +61,20 @@ EbyteModule::~EbyteModule() {
         delete this->current_mode;
     }
 
-    while (q_length(&this->queueTx) > 0) {
-        q_dequeue(&this->queueTx, NULL, 0);
+    if (this->auxIrqAttached) {
+        detachInterrupt(digitalPinToInterrupt(this->auxPin));
     }
 }
 
 bool EbyteModule::begin() {
     this->setBpsRate(this->bpsRate);
 
+    // AUX is followed by its edges, not by polling.
+    pinMode(this->auxPin, INPUT);
+    this->auxLevel = hal_pin_read(this->auxPin);
+    attachInterruptArg(digitalPinToInterrupt(this->auxPin), EbyteModule::auxIsr, this, CHANGE);
+    this->auxIrqAttached = true;
+
     this->current_mode = this->createMode();  // Factory method
     this->current_mode->setModeDefault();
     ResponseStatus status = this->setMode(this->current_mode);
@@ -76,16 +87,17 @@ bool EbyteModule::begin() {
  */
 
 int EbyteModule::available() {
-    return this->hs->available();
+    return hal_serial_available(&this->port);
 }
 
 void EbyteModule::waitTxBuffer() {  // Waiting UART Tx buffer complete
-    this->hs->flush();
+    hal_serial_flush(&this->port);
 }
 
 void EbyteModule::clearRxBuffer() {  // Clear UART Rx buffer
+    uint8_t b;
     while (this->available()) {
-        this->hs->read();
+        hal_serial_read(&this->port, &b, 1);
     }
 }
 
@@ -112,6 +124,7 @@ void EbyteModule::setBpsRate(uint32_t new_bps) {
         }
 
         while (!this->hs) taskYIELD();  // wait for serial port to connect. Needed for native USB
+        this->attachUartEvents();  // Dropped by end()
     }
 
     this->hs->setTimeout(EBYTE_UART_BUFFER_TMO);  // Timeout data in the buffer, then send.
@@ -122,6 +135,39 @@ uint32_t EbyteModule::getBpsRate() {
 }
 
 
+/**
+ * @brief UART events
+ *     The callbacks run in the event task of the UART driver, not in an ISR.
+ */
+
+void EbyteModule::setRxWake(SemaphoreHandle_t wake) {
+    this->rxWake = wake;
+    this->attachUartEvents();
+}
+
+void EbyteModule::attachUartEvents() {
+    this->hs->onReceive([this]() {  // RX FIFO full, or RX timeout
+        this->uartStat.rx_events++;
+        if (this->rxWake != NULL) xSemaphoreGive(this->rxWake);
+    }, false);
+    this->hs->onReceiveError([this](hardwareSerial_error_t err) {
+        EbyteModule::countUartError(this->uartStat, err);
+        if (this->rxWake != NULL) xSemaphoreGive(this->rxWake);
+    });
+}
+
+void EbyteModule::countUartError(EbyteUartStat & stat, hardwareSerial_error_t err) {
+    switch (err) {
+        case UART_BUFFER_FULL_ERROR:
+        case UART_FIFO_OVF_ERROR:   stat.overflows++; break;
+        case UART_BREAK_ERROR:      stat.breaks++; break;
+        case UART_FRAME_ERROR:
+        case UART_PARITY_ERROR:     stat.errors++; break;
+        default:                    break;
+    }
+}
+
+
 /**
  * @brief Auxiliary functions
  */
@@ -134,47 +180,220 @@ bool EbyteModule::isTimeout(unsigned long t, unsigned long t_prev, unsigned long
 }
 
 void EbyteModule::managedDelay(unsigned long timeout) {
-    unsigned long t_prev = millis();  // It will be overflow about every 50 days.
+    unsigned long t_prev = hal_millis();  // It will be overflow about every 50 days.
     while (1) {
-        unsigned long t = millis();
+        unsigned long t = hal_millis();
         if (this->isTimeout(t, t_prev, timeout)) {
             break;
         }
-        taskYIELD();
+        hal_yield(0);
+    }
+}
+
+void IRAM_ATTR EbyteModule::auxIsr(void * arg) {
+    EbyteModule * self = (EbyteModule *)arg;
+    uint32_t now = hal_micros();
+    uint8_t level = hal_pin_read(self->auxPin);
+    BaseType_t woken = pdFALSE;
+
+    portENTER_CRITICAL_ISR(&self->auxMux);
+    if (level != self->auxLevel) {
+        self->auxLevel = level;
+
+        // Busy duration, LOW to HIGH
+        if (level == HAL_LOW) {
+            self->auxFallMicros = now;
+        }
+        else {
+            uint32_t busy = now - self->auxFallMicros;
+            self->auxStat.busy_count++;
+            self->auxStat.busy_sum_us += busy;
+            self->auxStat.busy_last_us = busy;
+            if (busy > self->auxStat.busy_max_us) self->auxStat.busy_max_us = busy;
+        }
+
+        // Single-producer ring, the oldest edge is kept on overflow.
+        // It is read by updateTxCredit() on TX only; a drop counts while a TX waits for its edges, not on receiving.
+        uint8_t next = (self->auxEdgeHead + 1) & (EBYTE_AUX_EDGE_RING_SIZE - 1);
+        if (next == self->auxEdgeTail) {
+            if (self->auxEdgeWanted) self->auxStat.edge_drops++;
+        }
+        else {
+            self->auxEdges[self->auxEdgeHead].micros = now;
+            self->auxEdges[self->auxEdgeHead].level = level;
+            self->auxEdgeHead = next;
+        }
+        if (level == HAL_HIGH  &&  (long)(now - self->txSettleMicros) >= 0) {
+            self->auxEdgeWanted = false;  // The module has emptied its FIFO, that edge is the last one of the TX.
+        }
+    }
+    portEXIT_CRITICAL_ISR(&self->auxMux);
+
+    if (level == HAL_HIGH  &&  self->auxWaiter != NULL) {
+        vTaskNotifyGiveFromISR(self->auxWaiter, &woken);
+    }
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
     }
 }
 
 bool EbyteModule::auxIsActive() {
-    return digitalRead(this->auxPin) == LOW;
+    if (this->auxIrqAttached) {
+        return this->auxLevel == HAL_LOW;
+    }
+    return hal_pin_read(this->auxPin) == HAL_LOW;
 }
 
 ResponseStatus EbyteModule::auxReady(unsigned long timeout) {
-    unsigned long t_prev = millis();
+    unsigned long t_prev = hal_millis();
     ResponseStatus status = { .code = ResponseStatus::SUCCESS, };
     bool printed_aux_waiting = false;
 
     // If AUX pin was supplied, and look for HIGH state.
     // XXX: You can omit using AUX if no pins are available, but you will have to use delay() to let module finish
+    if (this->auxIrqAttached) {
+        ulTaskNotifyTake(pdTRUE, 0);  // Drop a stale notification
+        this->auxWaiter = xTaskGetCurrentTaskHandle();
+    }
+
     while (this->auxIsActive()) {
-        unsigned long t = millis();  // It will be overflow about every 50 days.
+        unsigned long t = hal_millis();  // It will be overflow about every 50 days.
 
         if (isTimeout(t, t_prev, timeout)) {
             DEBUG_PRINTLN(F(EBYTE_LABEL "Wait AUX HIGH: timeout! AUX still LOW"));
             status.code = ResponseStatus::ERR_TIMEOUT;
-            return status;
+            break;
         }
 
         if (printed_aux_waiting == false) {
             DEBUG_PRINTLN(F(EBYTE_LABEL "Wait AUX HIGH.."));
             printed_aux_waiting = true;
         }
-        taskYIELD();
+
+        if (this->auxIrqAttached) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout - (t - t_prev)) + 1);  // Sleep until the rising edge
+        }
+        else {
+            hal_yield(0);
+        }
+    }
+    this->auxWaiter = NULL;
+
+    if (status.code == ResponseStatus::SUCCESS) {
+        DEBUG_PRINTLN(F(EBYTE_LABEL "AUX HIGH!"));
+    }
+    return status;
+}
+
+bool EbyteModule::popAuxEdge(EbyteAuxEdge & edge) {
+    if (this->auxEdgeTail == this->auxEdgeHead) {
+        return false;
     }
+    edge = this->auxEdges[this->auxEdgeTail];
+    this->auxEdgeTail = (this->auxEdgeTail + 1) & (EBYTE_AUX_EDGE_RING_SIZE - 1);
+    return true;
+}
+
+EbyteAuxStat EbyteModule::getAuxStat() {
+    portENTER_CRITICAL(&this->auxMux);
+    EbyteAuxStat stat = this->auxStat;
+    portEXIT_CRITICAL(&this->auxMux);
+    return stat;
+}
 
-    DEBUG_PRINTLN(F(EBYTE_LABEL "AUX HIGH!"));
+/**
+ * @brief Readiness for the next message in transmission mode -- no fixed delay, unlike waitCompleteResponse()
+ */
+bool EbyteModule::isTxSettled() {
+    // A falling edge after the last write proves that the module has taken it.
+    if (this->auxIrqAttached  &&  (long)(this->auxFallMicros - this->txWriteMicros) >= 0) {
+        return true;
+    }
+    return (long)(hal_micros() - this->txSettleMicros) >= 0;
+}
+
+bool EbyteModule::isTxReady() {
+    return this->isTxSettled()  &&  !this->auxIsActive();
+}
+
+ResponseStatus EbyteModule::txReady(unsigned long timeout, size_t size) {
+    unsigned long t_prev = hal_millis();
+    ResponseStatus status = { .code = ResponseStatus::SUCCESS, };
+
+    // Top up the FIFO as soon as there is room, rather than waiting for it to drain.
+    if (size > 0  &&  this->airBps > 0) {
+        if (size > this->fifoSize()) size = this->fifoSize();
+
+        while (this->txCredit() < size) {
+            if (isTimeout(hal_millis(), t_prev, timeout)) {
+                DEBUG_PRINTLN(F(EBYTE_LABEL "Wait TX credit: timeout!"));
+                status.code = ResponseStatus::ERR_TIMEOUT;
+                this->countReadyTimeout();
+                return status;
+            }
+            hal_yield(1);
+        }
+        return status;
+    }
+
+    // The last message may be still on the wire, so AUX has not gone LOW for it yet.
+    while (this->isTxSettled() == false) {
+        if ((long)(this->txSettleMicros - hal_micros()) > portTICK_PERIOD_MS * 1000) {
+            hal_yield(1);
+        }
+        else {
+            hal_yield(0);
+        }
+    }
+
+    unsigned long t = hal_millis() - t_prev;
+    status = this->auxReady((t < timeout)? timeout - t : 0);
+    if (status.code == ResponseStatus::ERR_TIMEOUT) {
+        this->countReadyTimeout();
+    }
     return status;
 }
 
+void EbyteModule::countReadyTimeout() {
+    portENTER_CRITICAL(&this->auxMux);
+    this->auxStat.ready_timeouts++;
+    portEXIT_CRITICAL(&this->auxMux);
+}
+
+/**
+ * @brief FIFO credit, estimated from the air rate & corrected by AUX edges
+ */
+void EbyteModule::updateTxCredit() {
+    unsigned long now = hal_micros();
+
+    // Module has emptied its FIFO, if AUX rose after the last message got in.
+    EbyteAuxEdge edge;
+    while (this->popAuxEdge(edge)) {
+        if (edge.level == HAL_HIGH  &&  (long)(edge.micros - this->txSettleMicros) >= 0) {
+            this->fifoBytes = 0;
+        }
+    }
+
+    if (this->isTxReady()) {
+        this->fifoBytes = 0;  // Idle
+    }
+    else if (this->auxIsActive()  &&  this->fifoBytes > 0) {  // Draining on air
+        uint64_t drained = (uint64_t)(now - this->fifoMicros) * this->airBps * EBYTE_AIR_EFFICIENCY_PCT / (100 * 8 * 1000000UL);
+        this->fifoBytes = (drained < this->fifoBytes)? this->fifoBytes - drained : 0;
+        if (drained == 0) return;  // Keep the fraction for the next time.
+    }
+    this->fifoMicros = now;
+}
+
+size_t EbyteModule::txCredit() {
+    if (this->airBps == 0) {
+        return (this->isTxReady())? this->fifoSize() : 0;
+    }
+
+    this->updateTxCredit();
+    return (this->fifoBytes < this->fifoSize())? this->fifoSize() - this->fifoBytes : 0;
+}
+
 ResponseStatus EbyteModule::waitCompleteResponse(unsigned long timeout, unsigned long waitNoAux) {
     ResponseStatus status = this->auxReady(timeout);
 
@@ -209,8 +428,8 @@ ResponseStatus EbyteModule::setMode(EbyteMode * mode) {
     // Set M* pins
     DEBUG_PRINT(F(EBYTE_LABEL "Mode: "));
     for (int i = this->mPin_cnt-1; i >= 0; i--) {
-        uint8_t b = ((mode->getMode() >> i) & 0x1)? HIGH : LOW;
-        digitalWrite(this->mPins[i], b);
+        uint8_t b = ((mode->getMode() >> i) & 0x1)? HAL_HIGH : HAL_LOW;
+        hal_pin_write(this->mPins[i], b);
         DEBUG_PRINT(b);
     }
     DEBUG_PRINTLN(" \"" + mode->description() + "\"");
@@ -245,7 +464,7 @@ EbyteMode * EbyteModule::getMode() {
 void EbyteModule::writeProgramCommand(EBYTE_COMMAND_T cmd) {
     uint8_t CMD[3] = {cmd, cmd, cmd};
     // uint8_t size =
-    this->hs->write(CMD, 3);
+    hal_serial_write(&this->port, CMD, 3);
     this->managedDelay(EBYTE_EXTRA_WAIT);
 }
 
@@ -290,6 +509,9 @@ ResponseStructContainer EbyteModule::getConfiguration() {
         ((Configuration *)rc.data)->getHead() != 0xC2) {
         rc.status.code = ResponseStatus::ERR_HEAD_NOT_RECOGNIZED;
     }
+    else {
+        this->airBps = this->airRateBps(*(Configuration *)rc.data);  // For the FIFO credit model
+    }
 
     return rc;
 }
@@ -380,6 +602,9 @@ ResponseStatus EbyteModule::setConfiguration(Configuration & config, EBYTE_COMMA
     if (config.getHead() != 0xC0  &&  config.getHead() != 0xC2) {
         status.code = ResponseStatus::ERR_HEAD_NOT_RECOGNIZED;
     }
+    else {
+        this->airBps = this->airRateBps(config);  // For the FIFO credit model
+    }
 
     return status;
 }
@@ -445,7 +670,7 @@ ResponseStatus EbyteModule::sendStruct(const void * structureManaged, size_t siz
         return status;
     }
 
-    size_t len = this->hs->write((uint8_t *)structureManaged, size_of_st);
+    size_t len = hal_serial_write(&this->port, (uint8_t *)structureManaged, size_of_st);
     DEBUG_PRINTF(EBYTE_LABEL "Send struct len:%d size:%d" ENDL, len, size_of_st);
 
     if (len != size_of_st) {
@@ -459,7 +684,7 @@ ResponseStatus EbyteModule::sendStruct(const void * structureManaged, size_t siz
 ResponseStatus EbyteModule::receiveStruct(void * structureManaged, size_t size_of_st) {
     ResponseStatus status;
 
-    size_t len = this->hs->readBytes((uint8_t *)structureManaged, size_of_st);
+    size_t len = hal_serial_read(&this->port, (uint8_t *)structureManaged, size_of_st);
     DEBUG_PRINTF(EBYTE_LABEL "Recv struct len:%d size:%d" ENDL, len, size_of_st);
 
     if (len != size_of_st) {
@@ -475,7 +700,7 @@ ResponseStatus EbyteModule::receiveStruct(void * structureManaged, size_t size_o
  */
 
 ResponseStructContainer EbyteModule::receiveMessage() {
-    return this->receiveMessageFixedSize(this->hs->available());
+    return this->receiveMessageFixedSize(hal_serial_available(&this->port));
 }
 
 ResponseStructContainer EbyteModule::receiveMessageFixedSize(size_t size) {
@@ -483,9 +708,67 @@ ResponseStructContainer EbyteModule::receiveMessageFixedSize(size_t size) {
     rc.data   = malloc(size);
     rc.size   = size;
     rc.status = this->receiveStruct(rc.data, size);
+    this->bufferStat.heap_allocs++;
     return rc;
 }
 
+ResponseStatus EbyteModule::receiveMessage(void * buf, size_t maxlen, size_t & len) {
+    ResponseStatus status = { .code = ResponseStatus::SUCCESS, };
+
+    // Data in transmission mode is already in the UART buffer; no need to wait for AUX like receiveStruct().
+    len = hal_serial_available(&this->port);
+    if (len > maxlen) len = maxlen;
+    len = hal_serial_read(&this->port, (uint8_t *)buf, len);
+
+    if (len == 0) {
+        status.code = ResponseStatus::ERR_NO_RESPONSE_FROM_DEVICE;
+    }
+    return status;
+}
+
+/**
+ * @brief Borrow an empty block of the queueTx slab, by the owner of the queue, to be lent out
+ *
+ * @return false if the pool has none free
+ */
+bool EbyteModule::allocPacket(EbytePacket & pkt) {
+    int b = sq_alloc(&this->queueTx);
+    if (b < 0) {
+        return false;
+    }
+
+    pkt.block = b;
+    pkt.data  = sq_block(&this->queueTx, b);
+    pkt.size  = 0;
+    return true;
+}
+
+/**
+ * @brief Receive into a block of allocPacket(); without one, a miss and no read
+ *
+ */
+ResponseStatus EbyteModule::receivePacket(EbytePacket & pkt) {
+    ResponseStatus status;
+
+    if (pkt.block < 0) {
+        this->bufferStat.pool_misses++;
+        status.code = ResponseStatus::ERR_QUEUE_FULL;
+        return status;
+    }
+
+    status = this->receiveMessage(pkt.data, EBYTE_MODULE_BUFFER_SIZE, pkt.size);
+    return status;
+}
+
+void EbyteModule::releasePacket(EbytePacket & pkt) {
+    if (pkt.block >= 0) {
+        sq_release(&this->queueTx, pkt.block);
+    }
+    pkt.block = -1;
+    pkt.data  = NULL;
+    pkt.size  = 0;
+}
+
 // ResponseContainer EbyteModule::receiveMessage() {
 //     ResponseContainer rc;
 //     rc.status.code = ResponseStatus::SUCCESS;
@@ -521,11 +804,73 @@ ResponseStructContainer EbyteModule::receiveMessageFixedSize(size_t size) {
  * @brief Sending
  */
 
-ResponseStatus EbyteModule::sendMessage(const void * message, size_t size) {
-    ResponseStatus status = this->sendStruct(message, size);
+/**
+ * @brief The only wait before a send: for room in the module FIFO, up to 'timeout', not the datasheet's config-mode delay
+ */
+ResponseStatus EbyteModule::sendMessage(const void * message, size_t size, unsigned long timeout) {
+    ResponseStatus status;
+
+    if (size > EBYTE_MODULE_BUFFER_SIZE) {
+        status.code = ResponseStatus::ERR_PACKET_TOO_BIG;
+        return status;
+    }
+
+    status = this->txReady(timeout, size);
+    if (status.code != ResponseStatus::SUCCESS) {
+        return status;
+    }
+    return this->writeMessage(message, size);
+}
+
+/**
+ * @brief Write to a module already found ready by txReady()
+ */
+ResponseStatus EbyteModule::writeMessage(const void * message, size_t size) {
+    ResponseStatus status = { .code = ResponseStatus::SUCCESS, };
+
+    this->txStamps.aux_ready = hal_cycles();
+    this->updateTxCredit();
+    this->txWriteMicros = hal_micros();
+    size_t len = hal_serial_write(&this->port, (uint8_t *)message, size);
+    this->txStamps.written = hal_cycles();
+    this->fifoBytes += len;
+    DEBUG_PRINTF(EBYTE_LABEL "Send message len:%d size:%d" ENDL, len, size);
+
+    // AUX is meaningful again once the bytes have been shifted out to the module.
+    this->txSettleMicros = this->txWriteMicros + (len * 10 * 1000000UL) / this->bpsRate + EBYTE_AUX_SETTLE_US;
+    this->auxEdgeWanted = true;  // Drained by updateTxCredit() above
+
+    if (len != size) {
+        status.code = (len == 0)? ResponseStatus::ERR_NO_RESPONSE_FROM_DEVICE : ResponseStatus::ERR_DATA_SIZE_NOT_MATCH;
+    }
     return status;
 }
 
+/**
+ * @brief One message of up to maxMessageSize() bytes, in a frame of a single fragment when framing is on
+ */
+ResponseStatus EbyteModule::sendFramedMessage(const void * message, size_t size) {
+    if (!this->framing) {
+        return this->sendMessage(message, size);
+    }
+    if (this->reliable) {  // Needs a seq, and to be kept for retransmission
+        return this->fragmentMessageQueueTx(message, size);
+    }
+
+    ResponseStatus status;
+    if (size > this->maxMessageSize()) {
+        status.code = ResponseStatus::ERR_PACKET_TOO_BIG;
+        return status;
+    }
+
+    byte payload[FRAG_HEADER_LEN + EBYTE_MODULE_BUFFER_SIZE];
+    frag_header(payload, this->fragMsgId++, 0, 1);
+    memcpy(&payload[FRAG_HEADER_LEN], message, size);
+
+    byte frame[EBYTE_MODULE_BUFFER_SIZE];
+    return this->sendMessage(frame, framing_encode(payload, FRAG_HEADER_LEN + size, frame));
+}
+
 // ResponseStatus EbyteModule::sendMessage(const String message) {
 //     return this->sendMessage(message.c_str(), message.length());
 // }
@@ -564,53 +909,415 @@ ResponseStatus EbyteModule::sendMessage(const void * message, size_t size) {
  */
 
 size_t EbyteModule::lengthMessageQueueTx() {
-    return q_length(&this->queueTx);
+    return sq_length(&this->queueTx);
 }
 
 ResponseStatus EbyteModule::fragmentMessageQueueTx(const void * message, size_t size) {
     ResponseStatus status;
     status.code = ResponseStatus::SUCCESS;
 
+    // All fragments or nothing, so a message is never cut in the middle.
+    size_t frag_size = this->maxMessageSize();
+    size_t frag_cnt = (size + frag_size - 1) / frag_size;
+    size_t parity_cnt = (this->framing)? fec_parity_count(this->fecK, this->fecN, frag_cnt) : 0;
+    if (this->framing  &&  (frag_cnt + parity_cnt > FRAG_MAX_COUNT  ||  size > FRAG_MAX_MESSAGE)) {
+        status.code = ResponseStatus::ERR_PACKET_TOO_BIG;
+        return status;
+    }
+    if (frag_cnt + parity_cnt > sq_available(&this->queueTx)) {
+        status.code = ResponseStatus::ERR_QUEUE_FULL;
+        return status;
+    }
+
+    // Framed, every fragment tells its message id, index and count for the reassembly.
+    uint8_t msg_id = this->fragMsgId++;
+    const byte * data[FRAG_MAX_COUNT];
+
     byte * p = (byte *)message;
-    while (size > 0) {
-        size_t len = (size < EBYTE_MODULE_BUFFER_SIZE)? size : EBYTE_MODULE_BUFFER_SIZE;
-        size -= len;
-        if (q_enqueue(&this->queueTx, p, len) == NULL) {
-            status.code = ResponseStatus::ERR_BUF_TOO_SMALL;
-            break;
+    for (uint8_t index = 0; index < frag_cnt; index++) {
+        size_t len = (size - index * frag_size < frag_size)? size - index * frag_size : frag_size;
+        if (index < FRAG_MAX_COUNT) data[index] = p;
+
+        if (!this->enqueueFragmentTx(msg_id, index, frag_cnt, NULL, 0, p, len)) {
+            status.code = ResponseStatus::ERR_QUEUE_FULL;
+            return status;
         }
+        this->bufferStat.copy_bytes += len;
         p += len;
     }
 
+    // Parity of the zero-padded data fragments, after them
+    if (parity_cnt > 0) {
+        size_t parity_len = (frag_cnt > 1)? frag_size : size;
+        byte last[EBYTE_MODULE_BUFFER_SIZE] = {};
+        memcpy(last, data[frag_cnt - 1], size - (frag_cnt - 1) * frag_size);
+        data[frag_cnt - 1] = last;
+
+        byte len_le[FEC_HEADER_LEN] = {(byte)size, (byte)(size >> 8)};
+        byte parity[EBYTE_MODULE_BUFFER_SIZE];
+        for (uint8_t j = 0; j < parity_cnt; j++) {
+            fec_encode(data, frag_cnt, parity_len, j, parity);
+            if (!this->enqueueFragmentTx(msg_id, frag_cnt + j, frag_cnt, len_le, sizeof(len_le), parity, parity_len)) {
+                status.code = ResponseStatus::ERR_QUEUE_FULL;
+                break;
+            }
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief One fragment into queueTx: its header, 'pre', then 'data'
+ */
+bool EbyteModule::enqueueFragmentTx(uint8_t msg_id, uint8_t index, uint8_t count,
+                                    const byte * pre, size_t pre_len, const byte * data, size_t len) {
+    if (!this->framing) {
+        if (sq_enqueue(&this->queueTx, data, len) != SQ_OK) return false;
+        this->queueTxStamps[sq_item(&this->queueTx, sq_length(&this->queueTx) - 1)] = hal_cycles();
+        return true;
+    }
+
+    int b = sq_alloc(&this->queueTx);
+    if (b < 0) {
+        return false;
+    }
+
+    // Plain under ARQ, encoded on every (re)transmission with the latest ACK; else encoded right into the block.
+    byte payload[FRAG_HEADER_LEN + EBYTE_MODULE_BUFFER_SIZE];
+    byte * dst = (this->reliable)? sq_block(&this->queueTx, b) : payload;
+    frag_header(dst, msg_id, index, count);
+    if (pre_len > 0) memcpy(&dst[FRAG_HEADER_LEN], pre, pre_len);
+    memcpy(&dst[FRAG_HEADER_LEN + pre_len], data, len);
+
+    size_t n = FRAG_HEADER_LEN + pre_len + len;
+    if (!this->reliable) {
+        n = framing_encode(payload, n, sq_block(&this->queueTx, b));
+    }
+    this->queueTxStamps[b] = hal_cycles();
+    sq_enqueue_block(&this->queueTx, b, n);
+    sq_release(&this->queueTx, b);  // Held by the ring only
+    return true;
+}
+
+ResponseStatus EbyteModule::enqueuePacketTx(EbytePacket & pkt, size_t size) {
+    ResponseStatus status;
+    status.code = ResponseStatus::SUCCESS;
+
+    if (pkt.block < 0  ||  this->framing) {  // Not from the pool, or to be framed; copy it then.
+        return this->fragmentMessageQueueTx(pkt.data, size);
+    }
+
+    this->queueTxStamps[pkt.block] = hal_cycles();
+    switch (sq_enqueue_block(&this->queueTx, pkt.block, size)) {
+        case SQ_OK:         break;
+        case SQ_TOO_BIG:    status.code = ResponseStatus::ERR_PACKET_TOO_BIG; break;
+        default:            status.code = ResponseStatus::ERR_QUEUE_FULL; break;
+    }
     return status;
 }
 
 size_t EbyteModule::processMessageQueueTx() {
+    if (this->reliable) {
+        return this->processReliableQueueTx();
+    }
+
     if (this->lengthMessageQueueTx() > 0) {
-        ResponseStatus status = this->auxReady(EBYTE_NO_AUX_WAIT);
-        if (status.code == ResponseStatus::SUCCESS)
-        {
-            byte * p = (byte *)q_item(&this->queueTx, 0)->data;
-            size_t len = q_item(&this->queueTx, 0)->len;
-            status = this->sendMessage(p, len);
-            if (status.code == ResponseStatus::SUCCESS) {
-                q_dequeue(&this->queueTx, NULL, 0);  // Succeeded!
-                return len;
-            }
-            else {
-                DEBUG_PRINT(F(EBYTE_LABEL "Process queueTx error on sending message, "));
-                DEBUG_PRINTLN(status.desc());    
-            }
+        const void * p;
+        size_t len = sq_peek(&this->queueTx, &p);
+        this->txStamps.enqueued = this->queueTxStamps[sq_item(&this->queueTx, 0)];
+
+        ResponseStatus status = this->sendMessage(p, len);
+        if (status.code == ResponseStatus::SUCCESS) {
+            sq_dequeue(&this->queueTx, NULL, 0);  // Succeeded!
+            return len;
         }
-        else {
+        else if (status.code == ResponseStatus::ERR_TIMEOUT) {
             DEBUG_PRINT(F(EBYTE_LABEL "Process queueTx error on waiting AUX HIGH, "));
             DEBUG_PRINTLN(status.desc());
         }
+        else {
+            DEBUG_PRINT(F(EBYTE_LABEL "Process queueTx error on sending message, "));
+            DEBUG_PRINTLN(status.desc());
+        }
     }
 
     return 0;
 }
 
+bool EbyteModule::hasMessageQueueTx() {
+    if (!this->reliable) {
+        return this->lengthMessageQueueTx() > 0;
+    }
+
+    // Acked blocks go back first; a window all acked would otherwise hold the next frame forever.
+    uint8_t seq;
+    int done;
+    portENTER_CRITICAL(&this->arqMux);
+    while ((done = arq_pop_done(&this->arq)) >= 0) {
+        sq_release(&this->queueTx, done);
+    }
+    bool has = (this->lengthMessageQueueTx() > 0  &&  arq_can_send(&this->arq))
+            || arq_due(&this->arq, hal_millis(), &seq) >= 0
+            || arq_ack_due(&this->arq, hal_millis());
+    portEXIT_CRITICAL(&this->arqMux);
+    return has;
+}
+
+
+/**
+ * @brief Reliable mode
+ *     Queued blocks hold plain payloads. A block sent is kept out of the ring by an extra reference,
+ *         until it is acked or given up.
+ *     The ARQ state is shared by the sending & the receiving tasks, under 'arqMux'; never held over any I/O.
+ */
+
+void EbyteModule::setReliable(bool on) {
+    if (on == this->reliable) return;
+
+    // Payloads queued in the other format are no use.
+    while (sq_dequeue(&this->queueTx, NULL, 0) > 0);
+    portENTER_CRITICAL(&this->arqMux);
+    for (uint8_t i = 0; i < ARQ_WINDOW_MAX; i++) {
+        if (this->arq.tx[i].handle >= 0) sq_release(&this->queueTx, this->arq.tx[i].handle);
+    }
+    arq_init(&this->arq);
+    this->reliable = on;
+    portEXIT_CRITICAL(&this->arqMux);
+}
+
+size_t EbyteModule::processReliableQueueTx() {
+    uint32_t now = hal_millis();
+
+    portENTER_CRITICAL(&this->arqMux);
+    int done;
+    while ((done = arq_pop_done(&this->arq)) >= 0) {
+        sq_release(&this->queueTx, done);
+    }
+
+    // About the frames that fit in a round trip
+    if (this->airBps > 0  &&  this->arq.rtt_valid) {
+        uint32_t frame_ms = EBYTE_MODULE_BUFFER_SIZE * 8 * 1000 / this->airBps + 1;
+        arq_set_window(&this->arq, 1 + this->arq.srtt_ms / frame_ms);
+    }
+
+    // Retransmission first, then a new frame, else an ACK alone.
+    uint8_t seq = 0;
+    int b = arq_due(&this->arq, now, &seq);
+    bool retransmit = (b >= 0);
+    if (!retransmit  &&  this->lengthMessageQueueTx() > 0  &&  arq_can_send(&this->arq)) {
+        b = sq_item(&this->queueTx, 0);
+    }
+    bool idle = (b < 0  &&  !arq_ack_due(&this->arq, now));
+    portEXIT_CRITICAL(&this->arqMux);
+    if (idle) {
+        return 0;
+    }
+
+    // Only this task releases blocks, so 'payload' stays valid out of the lock.
+    const byte * payload = (b >= 0)? sq_block(&this->queueTx, b) : NULL;
+    this->txStamps.enqueued = (b >= 0)? this->queueTxStamps[b] : 0;
+    size_t payload_len = (b >= 0)? this->queueTx.lens[b] : 0;
+
+    ResponseStatus status = this->txReady(EBYTE_NO_AUX_WAIT, FRAMING_OVERHEAD + ARQ_HEADER_LEN + payload_len);
+    if (status.code != ResponseStatus::SUCCESS) {
+        DEBUG_PRINT(F(EBYTE_LABEL "Process queueTx error on waiting AUX HIGH, "));
+        DEBUG_PRINTLN(status.desc());
+        return 0;
+    }
+
+    byte frame[ARQ_HEADER_LEN + EBYTE_MODULE_BUFFER_SIZE];
+    portENTER_CRITICAL(&this->arqMux);
+    if (retransmit  &&  this->arq.tx[seq % ARQ_WINDOW_MAX].state != ARQ_TX_INFLIGHT) {  // Acked meanwhile
+        retransmit = false;
+        b = -1;
+        payload_len = 0;
+        this->txStamps.enqueued = 0;
+    }
+    if (b >= 0  &&  !retransmit) {  // Track it, kept past the dequeue.
+        seq = arq_sent(&this->arq, b, payload_len, now);
+        sq_retain(&this->queueTx, b);
+        sq_dequeue(&this->queueTx, NULL, 0);
+    }
+    else if (retransmit) {
+        arq_resent(&this->arq, seq, now);
+    }
+    arq_header(&this->arq, frame, b >= 0, seq);
+    portEXIT_CRITICAL(&this->arqMux);
+    if (payload_len > 0) memcpy(&frame[ARQ_HEADER_LEN], payload, payload_len);
+
+    byte encoded[EBYTE_MODULE_BUFFER_SIZE];
+    size_t len = framing_encode(frame, ARQ_HEADER_LEN + payload_len, encoded);
+    status = this->writeMessage(encoded, len);  // Ready since the wait above, before the window moved
+    if (status.code != ResponseStatus::SUCCESS) {  // Left to the retransmission timer
+        DEBUG_PRINT(F(EBYTE_LABEL "Process queueTx error on sending message, "));
+        DEBUG_PRINTLN(status.desc());
+        return 0;
+    }
+    return len;
+}
+
+void EbyteModule::beginReliableRx(const void * frame, size_t size) {
+    portENTER_CRITICAL(&this->arqMux);
+    arq_rx_begin(&this->arq, (const uint8_t *)frame, size, hal_millis());
+    portEXIT_CRITICAL(&this->arqMux);
+}
+
+bool EbyteModule::nextReliableRx(const uint8_t ** payload, size_t * size) {
+    portENTER_CRITICAL(&this->arqMux);
+    bool more = arq_rx_next(&this->arq, payload, size);
+    portEXIT_CRITICAL(&this->arqMux);
+    return more;
+}
+
+
+/**
+ * @brief TX lanes
+ *
+ * A message waits in the lane of its class. Strict lanes are always served first, so control traffic
+ *     only waits for the packet on air; the other lanes share the rest by their EBYTE_LANE_WEIGHTS.
+ * A message with a latest-value key overwrites the queued one of the same key, in place,
+ *     so periodic state never queues behind its own stale copies.
+ */
+
+ResponseStatus EbyteModule::enqueueLaneTx(uint8_t lane, const void * head, size_t head_len, const void * body, size_t body_len,
+                                          uint64_t key) {
+    ResponseStatus status;
+    status.code = ResponseStatus::SUCCESS;
+
+    if (lane >= EBYTE_LANES) lane = EBYTE_LANES - 1;
+    if (head_len + body_len > EBYTE_LANE_MESSAGE_SIZE) {
+        status.code = ResponseStatus::ERR_PACKET_TOO_BIG;
+        return status;
+    }
+
+    slab_queue_t * q = &this->laneTx[lane];
+    EbyteLaneHeader hdr = {key, (uint32_t)hal_micros()};
+    size_t len = sizeof(hdr) + head_len + body_len;
+
+    if (key != 0) {  // Latest value, look for an older copy.
+        for (uint8_t i = 0; i < sq_length(q); i++) {
+            int b = sq_item(q, i);
+            uint8_t * p = sq_block(q, b);
+            EbyteLaneHeader old;
+            memcpy(&old, p, sizeof(old));  // Blocks are only 4-byte aligned.
+            if (old.key == key) {
+                memcpy(p, &hdr, sizeof(hdr));
+                if (head_len > 0) memcpy(&p[sizeof(hdr)], head, head_len);
+                if (body_len > 0) memcpy(&p[sizeof(hdr) + head_len], body, body_len);
+                sq_set_length(q, b, len);
+
+                this->bufferStat.copy_bytes += head_len + body_len;
+                this->laneStat[lane].coalesced++;
+                return status;
+            }
+        }
+    }
+
+    int b = sq_alloc(q);
+    if (b < 0) {
+        this->laneStat[lane].drops++;
+        status.code = ResponseStatus::ERR_QUEUE_FULL;
+        return status;
+    }
+
+    uint8_t * p = sq_block(q, b);
+    memcpy(p, &hdr, sizeof(hdr));
+    if (head_len > 0) memcpy(&p[sizeof(hdr)], head, head_len);
+    if (body_len > 0) memcpy(&p[sizeof(hdr) + head_len], body, body_len);
+    sq_enqueue_block(q, b, len);
+    sq_release(q, b);  // Held by the ring only
+
+    this->bufferStat.copy_bytes += head_len + body_len;
+    this->laneStat[lane].enqueued++;
+    return status;
+}
+
+/**
+ * @brief The lane to be served next, or -1 if all are empty; its DRR credit is charged by dequeueLaneTx(), once dequeued
+ */
+int EbyteModule::pickLaneTx() {
+    for (uint8_t i = 0; i < EBYTE_LANES_STRICT; i++) {
+        if (sq_length(&this->laneTx[i]) > 0) return i;
+    }
+
+    bool any = false;
+    for (uint8_t i = EBYTE_LANES_STRICT; i < EBYTE_LANES; i++) {
+        if (sq_length(&this->laneTx[i]) > 0) any = true;
+        else this->laneDeficit[i] = 0;  // No credit is saved up while idle.
+    }
+    if (!any) return -1;
+
+    static const uint8_t weights[EBYTE_LANES] = EBYTE_LANE_WEIGHTS;
+    while (true) {  // Ends, as a non-empty lane gains credit every round.
+        uint8_t i = this->laneTurn;
+        const void * p;
+        size_t len = sq_peek(&this->laneTx[i], &p);
+        if (len > 0) {
+            len -= sizeof(EbyteLaneHeader);
+            if (this->laneDeficit[i] >= len) {
+                return i;
+            }
+            this->laneDeficit[i] += (uint32_t)weights[i] * EBYTE_LANE_QUANTUM;
+        }
+        this->laneTurn = (i + 1 < EBYTE_LANES)? i + 1 : EBYTE_LANES_STRICT;
+    }
+}
+
+ResponseStatus EbyteModule::dequeueLaneTx(void * buf, size_t maxlen, size_t & len, uint8_t * lane, uint32_t * wait_us) {
+    ResponseStatus status;
+    status.code = ResponseStatus::SUCCESS;
+    len = 0;
+
+    int i = this->pickLaneTx();
+    if (i < 0) {
+        status.code = ResponseStatus::ERR_QUEUE_EMPTY;
+        return status;
+    }
+
+    slab_queue_t * q = &this->laneTx[i];
+    const uint8_t * p;
+    size_t size = sq_peek(q, (const void **)&p) - sizeof(EbyteLaneHeader);
+    if (size > maxlen) {
+        status.code = ResponseStatus::ERR_PACKET_TOO_BIG;
+        return status;
+    }
+
+    EbyteLaneHeader hdr;
+    memcpy(&hdr, p, sizeof(hdr));
+    memcpy(buf, &p[sizeof(hdr)], size);
+    sq_dequeue(q, NULL, 0);
+    if (i >= EBYTE_LANES_STRICT) this->laneDeficit[i] -= size;  // Not on a failure above, nothing went out.
+    len = size;
+    if (lane) *lane = i;
+
+    EbyteLaneStat & st = this->laneStat[i];
+    uint32_t wait = hal_micros() - hdr.enq_us;
+    st.dequeued++;
+    st.wait_sum_us += wait;
+    if (wait > st.wait_max_us) st.wait_max_us = wait;
+    if (wait_us) *wait_us = wait;
+    return status;
+}
+
+size_t EbyteModule::lengthLaneTx(uint8_t lane) {
+    return (lane < EBYTE_LANES)? sq_length(&this->laneTx[lane]) : 0;
+}
+
+size_t EbyteModule::lengthLanesTx() {
+    size_t n = 0;
+    for (uint8_t i = 0; i < EBYTE_LANES; i++) n += sq_length(&this->laneTx[i]);
+    return n;
+}
+
+uint32_t EbyteModule::headWaitLaneTx(uint8_t lane) {
+    const uint8_t * p;
+    if (lane >= EBYTE_LANES  ||  sq_peek(&this->laneTx[lane], (const void **)&p) == 0) return 0;
+    EbyteLaneHeader hdr;
+    memcpy(&hdr, p, sizeof(hdr));
+    return hal_micros() - hdr.enq_us;
+}
+
 
 /**
  * @brief Print debug
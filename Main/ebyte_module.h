@@ -33,7 +33,11 @@
 #include <Arduino.h>
 
 #include "queue.h"
+#include "framing.h"
+#include "fragment.h"
+#include "arq.h"
 #include "helper.h"
+#include "hal.h"
 
 
 // Uncomment to enable printing out nice debug messages.
@@ -60,8 +64,23 @@
 // #define EBYTE_MODULE_BUFFER_SIZE 120  // E28 max tx packet size
 #endif
 
+#ifndef EBYTE_QUEUE_TX_SLOTS
+#define EBYTE_QUEUE_TX_SLOTS 16  // Number of EBYTE_MODULE_BUFFER_SIZE blocks statically reserved for queueTx
+#endif
+
+// TX lanes -- strict priority first, then weighted-fair (deficit round robin) among the rest.
+#define EBYTE_LANES             3
+#define EBYTE_LANES_STRICT      1     // Lanes [0, EBYTE_LANES_STRICT) always go first.
+#define EBYTE_LANE_SLOTS        8     // Per lane
+#define EBYTE_LANE_MESSAGE_SIZE 280   // A whole MAVLink v2 signed frame
+#define EBYTE_LANE_QUANTUM      64    // Bytes of credit per weight, per DRR round
+#define EBYTE_LANE_WEIGHTS      {0, 3, 1}  // Of the weighted-fair lanes; strict lanes ignore it.
+
 #define EBYTE_EXTRA_WAIT        40
 #define EBYTE_NO_AUX_WAIT       100
+#define EBYTE_AUX_SETTLE_US     1000  // After the last UART byte, AUX takes a moment to go LOW for the new data.
+#define EBYTE_AUX_EDGE_RING_SIZE 16   // Power of 2
+#define EBYTE_AIR_EFFICIENCY_PCT 50   // Share of the air rate that drains the FIFO; preamble, header & turnaround take the rest.
 #define EBYTE_RESPONSE_TMO      1000
 #define EBYTE_CONFIG_BAUD       9600
 
@@ -117,30 +136,36 @@ struct ResponseStatus {
         ERR_HEAD_NOT_RECOGNIZED,
         ERR_NO_RESPONSE_FROM_DEVICE,
         ERR_WRONG_UART_CONFIG,
-        ERR_PACKET_TOO_BIG
+        ERR_PACKET_TOO_BIG,
+        ERR_QUEUE_FULL,
+        ERR_QUEUE_EMPTY
     } Status;
 
     Status code;
 
-    String desc() {
+    const char * descStr() {  // A literal, fine to keep or to log
         switch (this->code) {
-            case SUCCESS:                   return F("Success");
-            case ERR_UNKNOWN:               return F("Unknown");
-            case ERR_NOT_SUPPORT:           return F("Not support!");
-            case ERR_NOT_IMPLEMENT:         return F("Not implement");
-            case ERR_NOT_INITIAL:           return F("Not initial!");
-            case ERR_INVALID_PARAM:         return F("Invalid param!");
-            case ERR_DATA_SIZE_NOT_MATCH:   return F("Data size not match!");
-            case ERR_BUF_TOO_SMALL:         return F("Buff too small!");
-            case ERR_TIMEOUT:               return F("Timeout!!");
-            case ERR_HARDWARE:              return F("Hardware error!");
-            case ERR_HEAD_NOT_RECOGNIZED:   return F("Save mode returned not recognized!");
-            case ERR_NO_RESPONSE_FROM_DEVICE: return F("No response from device! (Check wiring)");
-            case ERR_WRONG_UART_CONFIG:     return F("Wrong UART configuration! (BPS must be " STR(EBYTE_CONFIG_BAUD) " for configuration)");
-            case ERR_PACKET_TOO_BIG:        return F("Support only " STR(EBYTE_MODULE_BUFFER_SIZE) " bytes of data transmission!");
+            case SUCCESS:                   return "Success";
+            case ERR_UNKNOWN:               return "Unknown";
+            case ERR_NOT_SUPPORT:           return "Not support!";
+            case ERR_NOT_IMPLEMENT:         return "Not implement";
+            case ERR_NOT_INITIAL:           return "Not initial!";
+            case ERR_INVALID_PARAM:         return "Invalid param!";
+            case ERR_DATA_SIZE_NOT_MATCH:   return "Data size not match!";
+            case ERR_BUF_TOO_SMALL:         return "Buff too small!";
+            case ERR_TIMEOUT:               return "Timeout!!";
+            case ERR_HARDWARE:              return "Hardware error!";
+            case ERR_HEAD_NOT_RECOGNIZED:   return "Save mode returned not recognized!";
+            case ERR_NO_RESPONSE_FROM_DEVICE: return "No response from device! (Check wiring)";
+            case ERR_WRONG_UART_CONFIG:     return "Wrong UART configuration! (BPS must be " STR(EBYTE_CONFIG_BAUD) " for configuration)";
+            case ERR_PACKET_TOO_BIG:        return "Support only " STR(EBYTE_MODULE_BUFFER_SIZE) " bytes of data transmission!";
+            case ERR_QUEUE_FULL:            return "Queue full! (" STR(EBYTE_QUEUE_TX_SLOTS) " slots)";
+            case ERR_QUEUE_EMPTY:           return "Queue empty!";
         }
-        return F("Invalid status!");
+        return "Invalid status!";
     }
+
+    String desc() { return this->descStr(); }
 };
 
 struct ResponseStructContainer {
@@ -156,6 +181,92 @@ struct ResponseContainer {
 };
 
 
+/**
+ * @brief Packet buffer borrowed from the queueTx slab, see EbyteModule::receivePacket()
+ *
+ */
+struct EbytePacket {
+    int16_t block = -1;  // Slab block index; -1 when no block is held.
+    byte *  data  = NULL;
+    size_t  size  = 0;
+};
+
+/**
+ * @brief AUX transitions, timestamped by the GPIO interrupt
+ *
+ */
+struct EbyteAuxEdge {
+    uint32_t micros;
+    uint8_t  level;  // Level after the transition
+};
+
+struct EbyteAuxStat {
+    uint32_t busy_count;    // Completed LOW periods, i.e. the module was busy
+    uint32_t busy_sum_us;
+    uint32_t busy_max_us;
+    uint32_t busy_last_us;
+    uint32_t edge_drops;    // Edges lost on a full ring, during a TX
+    uint32_t ready_timeouts;  // txReady() gave up, AUX LOW or no FIFO credit
+};
+
+/**
+ * @brief Stages of the last message written to the module, by ESP.getCycleCount() of the writing core
+ *
+ */
+struct EbyteTxStamps {
+    uint32_t enqueued;   // Into queueTx; 0 if not from there, e.g. an ACK alone
+    uint32_t aux_ready;  // Room in the module, right before the write
+    uint32_t written;    // Into the UART driver
+};
+
+/**
+ * @brief UART events, from the event queue of the UART driver
+ *
+ */
+struct EbyteUartStat {
+    uint32_t rx_events;     // RX FIFO full, or RX timeout
+    uint32_t overflows;     // RX FIFO or RX buffer overflow; the bytes are lost.
+    uint32_t breaks;
+    uint32_t errors;        // Framing or parity
+};
+
+/**
+ * @brief Traffic classes of the TX lanes, the highest priority first
+ */
+enum EbyteLane : uint8_t {
+    EBYTE_LANE_CONTROL = 0,  // Strict priority, e.g. HEARTBEAT, COMMAND_LONG, RC override
+    EBYTE_LANE_TELEMETRY,
+    EBYTE_LANE_BULK,         // e.g. PARAM_VALUE, log download, FTP
+};
+
+struct EbyteLaneStat {
+    uint32_t enqueued;
+    uint32_t dequeued;
+    uint32_t drops;         // Lane full
+    uint32_t coalesced;     // Replaced by a newer message of the same key
+    uint64_t wait_sum_us;   // Age at dequeue, of the dequeued messages -- of the newest copy if coalesced
+    uint32_t wait_max_us;
+};
+
+/**
+ * @brief Header of a message in a lane block
+ */
+struct EbyteLaneHeader {
+    uint64_t key;     // Latest-value key, 0 is none
+    uint32_t enq_us;  // micros() on enqueue, or on the last replacement
+};
+
+/**
+ * @brief Buffer usage on the data path
+ *
+ */
+struct EbyteBufferStat {
+    uint32_t heap_allocs;  // malloc() for received messages
+    uint32_t copy_bytes;   // Bytes memcpy()'ed into the queue
+    uint32_t pool_misses;  // No pooled block at hand for receivePacket()
+};
+
+
 /**
  * @brief Class Ebyte configuration
  *
@@ -214,6 +325,7 @@ class EbyteMode {
 
   public:
     EbyteMode(uint8_t code = 0) : code(code) {}
+    virtual ~EbyteMode() {}  // Deleted through this base, see ~EbyteModule()
 
     uint8_t getMode(void) { return this->code; }
     void setMode(uint8_t code) { this->code = code; }
@@ -262,11 +374,16 @@ class EbyteModule {
 
     ResponseStructContainer receiveMessage();
     ResponseStructContainer receiveMessageFixedSize(size_t size);
+    ResponseStatus          receiveMessage(void * buf, size_t maxlen, size_t & len);  // Into a caller-provided buffer
+    bool                    allocPacket(EbytePacket & pkt);    // By the queue's owner task only
+    ResponseStatus          receivePacket(EbytePacket & pkt);  // Into a pooled buffer
+    void                    releasePacket(EbytePacket & pkt);  // By the queue's owner task only
     // ResponseContainer       receiveMessage();
     // ResponseContainer       receiveMessageUntil(char delimiter = '\0');
     // ResponseContainer       receiveMessageString(size_t size);
 
-    ResponseStatus          sendMessage(const void * message, size_t size);
+    ResponseStatus          sendMessage(const void * message, size_t size, unsigned long timeout = EBYTE_NO_AUX_WAIT);  // Transmission mode, no fixed delay
+    ResponseStatus          sendFramedMessage(const void * message, size_t size);  // Framed if setFraming(true)
     // ResponseStatus          sendMessage(const String message);
     // ResponseStatus          sendFixedTxModeMessage(byte addh, byte addl, byte chan, const void * message, size_t size);
     // ResponseStatus          sendFixedTxModeMessage(byte addh, byte addl, byte chan, const String message);
@@ -275,7 +392,19 @@ class EbyteModule {
 
 
     bool            auxIsActive();
-    ResponseStatus  auxReady(unsigned long timeout);
+    bool            isAuxReady() { return !this->auxIsActive(); };
+    ResponseStatus  auxReady(unsigned long timeout);  // Sleeps until the AUX interrupt says HIGH
+    bool            popAuxEdge(EbyteAuxEdge & edge);
+    EbyteAuxStat    getAuxStat();
+
+    void            setRxWake(SemaphoreHandle_t wake);  // Given on every RX event, to wake the receiving task
+    EbyteUartStat   getUartStat() { return this->uartStat; };
+    const EbyteTxStamps & getTxStamps() { return this->txStamps; };
+    static void     countUartError(EbyteUartStat & stat, hardwareSerial_error_t err);
+    bool            isTxReady();
+    ResponseStatus  txReady(unsigned long timeout, size_t size = 0);  // size 0: wait until the module is empty
+    size_t          txCredit();  // Bytes the module FIFO can take right now
+    uint32_t        getAirBps() { return this->airBps; };
     int             available();
     void            waitTxBuffer();
     void            clearRxBuffer();
@@ -285,24 +414,103 @@ class EbyteModule {
     void            printHead(byte head) const;
     virtual void    printParameters(Configuration & config) const = 0;
 
+    void            setFraming(bool on) { this->framing = on; };  // COBS + CRC16 + fragment header on every message, see framing.h & fragment.h
+    bool            isFraming() { return this->framing; };
+    size_t          maxMessageSize() {  // Per packet
+        return (this->framing)? FRAMING_MAX_PAYLOAD(EBYTE_MODULE_BUFFER_SIZE) - FRAG_HEADER_LEN - ((this->reliable)? ARQ_HEADER_LEN : 0)
+                                    - ((this->fecN > this->fecK)? FEC_HEADER_LEN : 0)
+                              : EBYTE_MODULE_BUFFER_SIZE; };
+    void            setFec(uint8_t k, uint8_t n) { this->fecK = k; this->fecN = n; };  // Parity fragments of k data in n, framed only; n <= k: off
+    void            setReliable(bool on);  // Selective-repeat ARQ on framed messages, see arq.h
+    bool            isReliable() { return this->reliable; };
+    void            beginReliableRx(const void * frame, size_t size);  // A decoded frame, then nextReliableRx()
+    bool            nextReliableRx(const uint8_t ** payload, size_t * size);  // In order
+    const arq_t &   getArq() { return this->arq; };
+
     size_t          lengthMessageQueueTx();
+    size_t          availableMessageQueueTx() { return sq_available(&this->queueTx); };  // Free blocks
     ResponseStatus  fragmentMessageQueueTx(const void * message, size_t size);
+    ResponseStatus  enqueuePacketTx(EbytePacket & pkt, size_t size);  // Zero-copy
     size_t          processMessageQueueTx();
+    bool            hasMessageQueueTx();  // Something to send: queued, or a retransmission or an ACK due; by the sending task, as it hands back acked blocks
+
+    ResponseStatus  enqueueLaneTx(uint8_t lane, const void * head, size_t head_len, const void * body = NULL, size_t body_len = 0,
+                                  uint64_t key = 0);  // Non-zero key: replace the queued message of the same key
+    ResponseStatus  dequeueLaneTx(void * buf, size_t maxlen, size_t & len, uint8_t * lane = NULL, uint32_t * wait_us = NULL);
+    size_t          lengthLaneTx(uint8_t lane);
+    size_t          lengthLanesTx();
+    uint32_t        headWaitLaneTx(uint8_t lane);  // us the oldest message has waited
+    const EbyteLaneStat & getLaneStat(uint8_t lane) { return this->laneStat[lane]; };
+
+    const EbyteBufferStat & getBufferStat() { return this->bufferStat; };
 
     void setAuxPin(int8_t pin) { this->auxPin = pin; };  // Set AUX pin directly. Must be called before calling begin()
 
   protected:
-    HardwareSerial * hs;
+    HardwareSerial * hs;  // Set up here; the data goes through 'port'
+    hal_serial_t     port;
     uint32_t bpsRate = EBYTE_CONFIG_BAUD;
     uint32_t serialConfig = SERIAL_8N1;
+    SemaphoreHandle_t rxWake = NULL;
+    EbyteUartStat     uartStat = {};  // Written by the UART event task only
+    void              attachUartEvents();
 
     int8_t    auxPin    = -1;
+    bool      auxIrqAttached = false;
+    volatile uint8_t      auxLevel = HIGH;
+    volatile uint32_t     auxFallMicros = 0;
+    volatile TaskHandle_t auxWaiter = NULL;
+    EbyteAuxEdge          auxEdges[EBYTE_AUX_EDGE_RING_SIZE];
+    volatile uint8_t      auxEdgeHead = 0;  // Written by the ISR only
+    volatile uint8_t      auxEdgeTail = 0;  // Written by the task only
+    volatile bool         auxEdgeWanted = false;  // A TX is on, updateTxCredit() will read its edges.
+    EbyteAuxStat          auxStat = {};
+    portMUX_TYPE          auxMux = portMUX_INITIALIZER_UNLOCKED;
+    static void IRAM_ATTR auxIsr(void * arg);
     uint8_t   mPin_cnt  = 0;
     uint8_t * mPins     = NULL;
     int8_t    rxPin     = -1;
     int8_t    txPin     = -1;
 
-    queue_t queueTx;
+    ResponseStatus writeMessage(const void * message, size_t size);  // sendMessage() without the wait
+    unsigned long txWriteMicros = 0;
+    unsigned long txSettleMicros = 0;  // AUX is not trusted before this time, the last message may be still on the wire.
+    bool          isTxSettled();
+    void          countReadyTimeout();
+
+    // FIFO credit model -- bytes written vs. bytes drained on air
+    uint32_t      airBps = 0;       // 0 is unknown, then fall back to waiting AUX HIGH.
+    uint32_t      fifoBytes = 0;    // Estimated bytes held in the module
+    unsigned long fifoMicros = 0;   // Last time fifoBytes was updated
+    void          updateTxCredit();
+    virtual size_t   fifoSize() const = 0;
+    virtual uint32_t airRateBps(Configuration & config) const = 0;
+
+    bool framing = false;
+    uint8_t fragMsgId = 0;
+    uint8_t fecK = 0;
+    uint8_t fecN = 0;
+    bool enqueueFragmentTx(uint8_t msg_id, uint8_t index, uint8_t count,
+                           const byte * pre, size_t pre_len, const byte * data, size_t len);
+
+    bool reliable = false;
+    arq_t arq;
+    portMUX_TYPE arqMux = portMUX_INITIALIZER_UNLOCKED;  // Uplink & downlink tasks
+    size_t processReliableQueueTx();
+
+    slab_queue_t queueTx;
+    uint32_t queueTxStamps[EBYTE_QUEUE_TX_SLOTS];  // Of the blocks, on enqueue
+    EbyteTxStamps txStamps = {};
+    uint8_t queueTxSlab[SQ_STORAGE_SIZE(EBYTE_MODULE_BUFFER_SIZE, EBYTE_QUEUE_TX_SLOTS)];
+    EbyteBufferStat bufferStat = {};
+
+    // Each block holds an EbyteLaneHeader, then the message.
+    slab_queue_t laneTx[EBYTE_LANES];
+    uint8_t laneTxSlab[EBYTE_LANES][SQ_STORAGE_SIZE(sizeof(EbyteLaneHeader) + EBYTE_LANE_MESSAGE_SIZE, EBYTE_LANE_SLOTS)];
+    EbyteLaneStat laneStat[EBYTE_LANES] = {};
+    uint32_t laneDeficit[EBYTE_LANES] = {};  // DRR credit in bytes
+    uint8_t  laneTurn = EBYTE_LANES_STRICT;
+    int      pickLaneTx();
 
     bool            isTimeout(unsigned long t, unsigned long t_prev, unsigned long timeout);
     void            managedDelay(unsigned long timeout);
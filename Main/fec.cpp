@@ -0,0 +1,154 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Reed-Solomon erasure code, table-driven.
+ *
+ * GF(256) of the polynomial 0x11D; multiplication by the log/exp tables, or by a 256-byte row
+ *     of the products of one coefficient, for the bulk of the bytes.
+ * Parity row j of data i is 1 / (x_j + y_i), x_j = FEC_MAX_DATA + j, y_i = i;
+ *     every square sub-matrix of a Cauchy matrix is invertible, so any k fragments will do.
+ */
+#include "fec.h"
+
+
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+static bool gf_ready = false;
+
+
+void fec_init() {
+    if (gf_ready) return;
+
+    uint16_t x = 1;
+    for (uint16_t i = 0; i < 255; i++) {
+        gf_exp[i] = x;
+        gf_log[x] = i;
+        x <<= 1;
+        if (x & 0x100) x ^= 0x11D;
+    }
+    for (uint16_t i = 255; i < 512; i++) {
+        gf_exp[i] = gf_exp[i - 255];
+    }
+    gf_ready = true;
+}
+
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+    return (a == 0  ||  b == 0)? 0 : gf_exp[gf_log[a] + gf_log[b]];
+}
+
+static inline uint8_t gf_inv(uint8_t a) {
+    return gf_exp[255 - gf_log[a]];
+}
+
+static inline uint8_t fec_coef(uint8_t row, uint8_t i) {
+    return gf_inv((FEC_MAX_DATA + row) ^ i);
+}
+
+/**
+ * @brief dst ^= c * src
+ */
+static void gf_mul_add(uint8_t *dst, const uint8_t *src, uint8_t c, size_t len) {
+    uint8_t mul[256];
+    uint8_t log_c = gf_log[c];
+    mul[0] = 0;
+    for (uint16_t v = 1; v < 256; v++) {
+        mul[v] = gf_exp[gf_log[v] + log_c];
+    }
+    for (size_t b = 0; b < len; b++) {
+        dst[b] ^= mul[src[b]];
+    }
+}
+
+
+/**
+ * @brief Parity fragments of a group, for k data out of n fragments; at least one when n > k.
+ */
+uint8_t fec_parity_count(uint8_t k, uint8_t n, uint8_t data_count) {
+    if (k == 0  ||  n <= k) return 0;
+
+    uint16_t p = ((uint16_t)data_count * (n - k) + k - 1) / k;
+    if (p > FEC_MAX_PARITY) p = FEC_MAX_PARITY;
+    if (data_count + p > FEC_MAX_DATA) p = FEC_MAX_DATA - data_count;
+    return p;
+}
+
+
+void fec_encode(const uint8_t *const data[], uint8_t k, size_t len, uint8_t row, uint8_t *parity) {
+    fec_init();
+    memset(parity, 0, len);
+    for (uint8_t i = 0; i < k; i++) {
+        gf_mul_add(parity, data[i], fec_coef(row, i), len);
+    }
+}
+
+
+/**
+ * @brief Rebuild the data fragments not in 'present' (bit i: data[i]), in place.
+ *
+ * @return false if there are not enough parity fragments
+ */
+bool fec_decode(uint8_t *const data[], uint16_t present, uint8_t k,
+                const uint8_t *const parity[], const uint8_t rows[], uint8_t parity_count, size_t len) {
+    fec_init();
+
+    uint8_t missing[FEC_MAX_PARITY];
+    uint8_t e = 0;
+    for (uint8_t i = 0; i < k; i++) {
+        if (present & (1 << i)) continue;
+        if (e == parity_count  ||  e == FEC_MAX_PARITY) return false;
+        missing[e++] = i;
+    }
+    if (e == 0) return true;
+
+    // Syndromes, what the missing fragments add up to in each parity row
+    uint8_t syn[FEC_MAX_PARITY][FEC_MAX_LEN];
+    if (len > FEC_MAX_LEN) return false;
+    for (uint8_t j = 0; j < e; j++) {
+        memcpy(syn[j], parity[j], len);
+        for (uint8_t i = 0; i < k; i++) {
+            if (present & (1 << i)) gf_mul_add(syn[j], data[i], fec_coef(rows[j], i), len);
+        }
+    }
+
+    // Invert the e x e Cauchy sub-matrix, Gauss-Jordan.
+    uint8_t a[FEC_MAX_PARITY][FEC_MAX_PARITY], inv[FEC_MAX_PARITY][FEC_MAX_PARITY];
+    for (uint8_t j = 0; j < e; j++) {
+        for (uint8_t t = 0; t < e; t++) {
+            a[j][t] = fec_coef(rows[j], missing[t]);
+            inv[j][t] = (j == t)? 1 : 0;
+        }
+    }
+    for (uint8_t c = 0; c < e; c++) {
+        uint8_t pivot = c;
+        while (pivot < e  &&  a[pivot][c] == 0) pivot++;
+        if (pivot == e) return false;  // Rows of the same parity twice
+        if (pivot != c) {
+            for (uint8_t t = 0; t < e; t++) {
+                uint8_t tmp = a[c][t];   a[c][t] = a[pivot][t];     a[pivot][t] = tmp;
+                tmp = inv[c][t];         inv[c][t] = inv[pivot][t]; inv[pivot][t] = tmp;
+            }
+        }
+        uint8_t f = gf_inv(a[c][c]);
+        for (uint8_t t = 0; t < e; t++) {
+            a[c][t] = gf_mul(a[c][t], f);
+            inv[c][t] = gf_mul(inv[c][t], f);
+        }
+        for (uint8_t r = 0; r < e; r++) {
+            if (r == c  ||  a[r][c] == 0) continue;
+            uint8_t g = a[r][c];
+            for (uint8_t t = 0; t < e; t++) {
+                a[r][t] ^= gf_mul(g, a[c][t]);
+                inv[r][t] ^= gf_mul(g, inv[c][t]);
+            }
+        }
+    }
+
+    for (uint8_t t = 0; t < e; t++) {
+        memset(data[missing[t]], 0, len);
+        for (uint8_t j = 0; j < e; j++) {
+            if (inv[t][j] != 0) gf_mul_add(data[missing[t]], syn[j], inv[t][j], len);
+        }
+    }
+    return true;
+}
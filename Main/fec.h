@@ -0,0 +1,29 @@
+#ifndef __FEC_H__
+#define __FEC_H__
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+
+/**
+ * @brief Reed-Solomon erasure code over GF(256), systematic with a Cauchy matrix
+ *
+ * A group of k data fragments gets up to FEC_MAX_PARITY parity fragments;
+ *     any k of them, data or parity, rebuild the data.
+ * Fragments are of the same length; a short one is zero-padded.
+ */
+#define FEC_MAX_DATA    16
+#define FEC_MAX_PARITY  4
+#define FEC_MAX_LEN     256  // Of a fragment
+#define FEC_HEADER_LEN  2   // Message length, ahead of a parity fragment
+
+extern void    fec_init();
+extern uint8_t fec_parity_count(uint8_t k, uint8_t n, uint8_t data_count);  // For a k/n ratio
+extern void    fec_encode(const uint8_t *const data[], uint8_t k, size_t len, uint8_t row, uint8_t *parity);
+extern bool    fec_decode(uint8_t *const data[], uint16_t present, uint8_t k,
+                          const uint8_t *const parity[], const uint8_t rows[], uint8_t parity_count, size_t len);
+
+
+#endif  // __FEC_H__
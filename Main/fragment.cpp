@@ -0,0 +1,194 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Fragmentation & reassembly of messages larger than a radio packet.
+ *
+ * Fragments of a message are put in place by index, so they may come in any order and interleave
+ *     with other messages. A slot holds a message until all of its fragments are in,
+ *     or until it times out, or is evicted for a newer message when the table is full.
+ * With FEC, a message is complete as soon as its data and parity fragments in hand are as many as
+ *     its data fragments; the missing ones are rebuilt (fec.h).
+ */
+#include "fragment.h"
+
+
+void frag_header(uint8_t *out, uint8_t msg_id, uint8_t index, uint8_t count) {
+    out[0] = msg_id;
+    out[1] = (index << 4) | ((count - 1) & 0x0F);
+}
+
+
+void frag_table_init(frag_table_t *t, size_t chunk, uint32_t timeout_ms) {
+    memset(t, 0, sizeof(frag_table_t));
+    t->chunk = chunk;
+    t->timeout_ms = timeout_ms;
+}
+
+
+static bool frag_is_done(frag_table_t *t, uint8_t msg_id) {
+    for (uint8_t i = 0; i < FRAG_DONE_HISTORY; i++) {
+        if (t->done_ids[i] == (0x100 | msg_id)) return true;
+    }
+    return false;
+}
+
+static void frag_done(frag_table_t *t, uint8_t msg_id) {
+    t->done_ids[t->done_head] = 0x100 | msg_id;
+    t->done_head = (t->done_head + 1) % FRAG_DONE_HISTORY;
+    t->stat.messages++;
+}
+
+
+/**
+ * @brief Rebuild the missing data fragments, once the data and parity in hand are as many as the data.
+ */
+static bool frag_recover(frag_table_t *t, frag_slot_t *slot) {
+    uint16_t data_mask = (1 << slot->count) - 1;
+    uint16_t present = slot->received & data_mask;
+    if (present == data_mask) return true;
+
+    uint8_t *data[FRAG_MAX_COUNT];
+    const uint8_t *parity[FEC_MAX_PARITY];
+    uint8_t rows[FEC_MAX_PARITY];
+    uint8_t parity_count = 0, data_count = 0;
+    for (uint8_t i = 0; i < slot->count; i++) {
+        data[i] = &slot->data[i * t->chunk];
+        if (present & (1 << i)) data_count++;
+    }
+    for (uint8_t j = 0; j < FEC_MAX_PARITY  &&  slot->count + j < FRAG_MAX_COUNT; j++) {
+        if (slot->received & (1 << (slot->count + j))) {
+            parity[parity_count] = slot->parity[j];
+            rows[parity_count++] = j;
+        }
+    }
+    if (slot->total_len == 0  ||  data_count + parity_count < slot->count) return false;
+
+    size_t len = (slot->count > 1)? t->chunk : slot->total_len;
+    if (!fec_decode(data, present, slot->count, parity, rows, parity_count, len)) return false;
+    t->stat.recovered += slot->count - data_count;
+    return true;
+}
+
+
+/**
+ * @brief Take a fragment, header included.
+ *
+ * @return true with the whole message, valid until the next push.
+ */
+bool frag_table_push(frag_table_t *t, const uint8_t *frag, size_t len, uint32_t now_ms,
+                     const uint8_t **msg, size_t *msg_len) {
+    if (len < FRAG_HEADER_LEN) {
+        t->stat.malformed++;
+        return false;
+    }
+    uint8_t msg_id = frag[0];
+    uint8_t index = frag[1] >> 4;
+    uint8_t count = (frag[1] & 0x0F) + 1;
+    const uint8_t *payload = &frag[FRAG_HEADER_LEN];
+    size_t payload_len = len - FRAG_HEADER_LEN;
+
+    bool is_parity = (index >= count);
+    bool last = (index == count - 1);
+    size_t total_len = 0;
+    if (is_parity) {  // Message length, then parity as long as the longest data fragment
+        if (payload_len >= FEC_HEADER_LEN) {
+            total_len = payload[0] | (payload[1] << 8);
+            payload += FEC_HEADER_LEN;
+            payload_len -= FEC_HEADER_LEN;
+        }
+        if (index - count >= FEC_MAX_PARITY
+        ||  total_len <= (count - 1) * t->chunk  ||  total_len > count * t->chunk  ||  total_len > FRAG_MAX_MESSAGE
+        ||  payload_len != ((count > 1)? t->chunk : total_len)) {
+            t->stat.malformed++;
+            return false;
+        }
+    }
+    else if ((!last  &&  payload_len != t->chunk)
+         ||  (last  &&  payload_len > t->chunk)
+         ||  (count - 1) * t->chunk >= FRAG_MAX_MESSAGE
+         ||  (last  &&  index * t->chunk + payload_len > FRAG_MAX_MESSAGE)) {
+        t->stat.malformed++;
+        return false;
+    }
+    t->stat.fragments++;
+
+    if (frag_is_done(t, msg_id)) {  // Parity, or data rebuilt already
+        t->stat.late++;
+        return false;
+    }
+
+    if (count == 1  &&  !is_parity) {  // Whole already, no copy
+        frag_done(t, msg_id);
+        *msg = payload;
+        *msg_len = payload_len;
+        return true;
+    }
+
+    // Find the message, or a slot for it.
+    frag_slot_t *slot = NULL, *oldest = NULL, *unused = NULL;
+    for (uint8_t i = 0; i < FRAG_SLOTS; i++) {
+        frag_slot_t *s = &t->slots[i];
+        if (!s->used) {
+            if (unused == NULL) unused = s;
+        }
+        else if (s->msg_id == msg_id  &&  s->count == count) {
+            slot = s;
+            break;
+        }
+        else if (oldest == NULL  ||  (int32_t)(s->start_ms - oldest->start_ms) < 0) {
+            oldest = s;
+        }
+    }
+    if (slot == NULL) {
+        if (unused != NULL) {
+            slot = unused;
+        }
+        else {
+            slot = oldest;
+            t->stat.evictions++;
+        }
+        slot->used = true;
+        slot->msg_id = msg_id;
+        slot->count = count;
+        slot->received = 0;
+        slot->total_len = 0;
+        slot->start_ms = now_ms;
+    }
+
+    if (slot->received & (1 << index)) return false;  // Duplicate
+    slot->received |= 1 << index;
+    if (is_parity) {
+        memcpy(slot->parity[index - count], payload, payload_len);
+        slot->total_len = total_len;
+    }
+    else {
+        uint8_t *dst = &slot->data[index * t->chunk];
+        memcpy(dst, payload, payload_len);
+        if (last) {
+            memset(&dst[payload_len], 0, t->chunk - payload_len);  // The padding of the parity
+            slot->total_len = index * t->chunk + payload_len;
+        }
+    }
+
+    if (!frag_recover(t, slot)) return false;
+
+    slot->used = false;  // Data stay until the slot is taken again.
+    frag_done(t, msg_id);
+    *msg = slot->data;
+    *msg_len = slot->total_len;
+    return true;
+}
+
+
+/**
+ * @brief Drop the messages older than the timeout, as units.
+ */
+void frag_table_expire(frag_table_t *t, uint32_t now_ms) {
+    for (uint8_t i = 0; i < FRAG_SLOTS; i++) {
+        frag_slot_t *s = &t->slots[i];
+        if (s->used  &&  now_ms - s->start_ms > t->timeout_ms) {
+            s->used = false;
+            t->stat.timeouts++;
+        }
+    }
+}
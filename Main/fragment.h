@@ -0,0 +1,74 @@
+#ifndef __FRAGMENT_H__
+#define __FRAGMENT_H__
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "fec.h"
+
+
+/**
+ * @brief Fragment header, ahead of every framed payload: message id, then index & count nibbles
+ *
+ * A message is delivered whole, or dropped as a unit on timeout or eviction.
+ * Memory budget is FRAG_SLOTS * (FRAG_MAX_MESSAGE + (1 + FEC_MAX_PARITY) * FRAG_MAX_CHUNK) bytes;
+ *     latency budget is the timeout.
+ *
+ * With FEC, parity fragments follow the 'count' data fragments, index 'count' onward;
+ *     each carries the message length (FEC_HEADER_LEN), then the parity of the zero-padded data fragments.
+ */
+#define FRAG_HEADER_LEN     2
+#define FRAG_MAX_COUNT      16   // Data & parity fragments
+#define FRAG_MAX_CHUNK      220  // EBYTE_MODULE_BUFFER_SIZE
+#define FRAG_DONE_HISTORY   8    // Messages delivered lately, whose late parity is dropped quietly
+
+#ifndef FRAG_MAX_MESSAGE
+#define FRAG_MAX_MESSAGE    512  // Largest message; both ends must agree.
+#endif
+#ifndef FRAG_SLOTS
+#define FRAG_SLOTS          4    // Messages being reassembled at once
+#endif
+#ifndef FRAG_TIMEOUT_MS
+#define FRAG_TIMEOUT_MS     1000
+#endif
+
+typedef struct {
+    uint32_t messages;   // Delivered
+    uint32_t fragments;
+    uint32_t timeouts;   // Dropped as a unit, incomplete in time
+    uint32_t evictions;  // Dropped as a unit, for a newer message on a full table
+    uint32_t malformed;
+    uint32_t recovered;  // Data fragments rebuilt from parity
+    uint32_t late;       // Fragments of a message delivered already
+} frag_stat_t;
+
+typedef struct {
+    bool     used;
+    uint8_t  msg_id;
+    uint8_t  count;
+    uint16_t received;   // Bitmap of fragments, data & parity
+    uint16_t total_len;  // 0 until the last data fragment, or a parity one, comes.
+    uint32_t start_ms;
+    uint8_t  data[FRAG_MAX_MESSAGE + FRAG_MAX_CHUNK];  // Room for the padding of the last fragment
+    uint8_t  parity[FEC_MAX_PARITY][FRAG_MAX_CHUNK];
+} frag_slot_t;
+
+typedef struct {
+    size_t   chunk;       // Payload of every fragment but the last
+    uint32_t timeout_ms;
+    frag_slot_t slots[FRAG_SLOTS];
+    uint16_t done_ids[FRAG_DONE_HISTORY];  // 0x100 | msg_id
+    uint8_t  done_head;
+    frag_stat_t stat;
+} frag_table_t;
+
+extern void frag_header(uint8_t *out, uint8_t msg_id, uint8_t index, uint8_t count);
+extern void frag_table_init(frag_table_t *t, size_t chunk, uint32_t timeout_ms);
+extern bool frag_table_push(frag_table_t *t, const uint8_t *frag, size_t len, uint32_t now_ms,
+                            const uint8_t **msg, size_t *msg_len);
+extern void frag_table_expire(frag_table_t *t, uint32_t now_ms);
+
+
+#endif  // __FRAGMENT_H__
@@ -0,0 +1,116 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * COBS framing with CRC16 for the raw message type.
+ *
+ * Frame boundaries used to be guessed from idle time on the UARTs, which added the idle time
+ *     to every message and let corrupted radio data through. Here a frame is complete on its
+ *     delimiter, and delivered only if its CRC matches.
+ */
+#include "framing.h"
+#include "crc16.h"
+
+
+/**
+ * @brief Encode a payload of up to 251 bytes.
+ *
+ * @return Frame length, including the delimiter
+ */
+size_t framing_encode(const void *payload, size_t len, uint8_t *out) {
+    const uint8_t *p = (const uint8_t *)payload;
+    uint16_t crc = crc16_update(p, len, CRC16_INIT);
+
+    out[0] = FRAMING_DELIM;
+    size_t code_pos = 1;
+    size_t n = 2;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len + FRAMING_CRC_LEN; i++) {
+        uint8_t b = (i < len)? p[i] : (i == len)? (crc & 0xFF) : (crc >> 8);
+        if (b == 0) {
+            out[code_pos] = code;
+            code_pos = n++;
+            code = 1;
+        }
+        else {
+            out[n++] = b;
+            if (++code == 0xFF) {
+                out[code_pos] = code;
+                code_pos = n++;
+                code = 1;
+            }
+        }
+    }
+    out[code_pos] = code;
+    out[n++] = FRAMING_DELIM;
+    return n;
+}
+
+
+void framing_decoder_init(framing_decoder_t *d) {
+    memset(d, 0, sizeof(framing_decoder_t));
+}
+
+
+/**
+ * @brief Feed a new block of the stream
+ */
+void framing_decode_begin(framing_decoder_t *d, const uint8_t *data, size_t len) {
+    d->data = data;
+    d->data_len = len;
+    d->cursor = 0;
+}
+
+
+/**
+ * @brief Decode the block until a valid frame is complete.
+ *
+ * @return true with the payload, valid until the next call; false when the block runs out.
+ */
+bool framing_decode_next(framing_decoder_t *d, const uint8_t **payload, size_t *len) {
+    while (d->cursor < d->data_len) {
+        uint8_t b = d->data[d->cursor++];
+
+        if (b == FRAMING_DELIM) {
+            bool complete = (!d->overflow  &&  d->left == 0  &&  d->len >= FRAMING_CRC_LEN);
+            size_t n = d->len;
+            d->len = 0;
+            d->left = 0;
+            d->code = 0;
+            d->overflow = false;
+            if (!complete) continue;  // Empty, or cut short
+
+            uint16_t crc = crc16_update(d->buf, n - FRAMING_CRC_LEN, CRC16_INIT);
+            if (d->buf[n - 2] != (crc & 0xFF)  ||  d->buf[n - 1] != (crc >> 8)) {
+                d->stat.crc_errors++;
+                continue;
+            }
+
+            d->stat.frames++;
+            *payload = d->buf;
+            *len = n - FRAMING_CRC_LEN;
+            return true;
+        }
+
+        if (d->overflow) continue;
+
+        if (d->left == 0) {  // A code byte; the previous block ended with a zero, unless it was a full one.
+            if (d->code != 0  &&  d->code != 0xFF) {
+                if (d->len >= FRAMING_BUFFER_SIZE) goto overflow;
+                d->buf[d->len++] = 0;
+            }
+            d->code = b;
+            d->left = b - 1;
+        }
+        else {
+            if (d->len >= FRAMING_BUFFER_SIZE) goto overflow;
+            d->buf[d->len++] = b;
+            d->left--;
+        }
+        continue;
+
+      overflow:
+        d->overflow = true;
+        d->stat.overflows++;
+    }
+    return false;
+}
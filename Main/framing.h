@@ -0,0 +1,47 @@
+#ifndef __FRAMING_H__
+#define __FRAMING_H__
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+
+/**
+ * @brief Over-the-air framing of raw data: 0x00 + COBS(payload + CRC16) + 0x00
+ *
+ * The delimiter never shows up inside a frame, so a receiver knows exactly when a frame ends,
+ *     and resynchronizes on the next delimiter after any loss.
+ * The leading delimiter cuts off whatever a lost radio packet left unfinished, so it costs only its own frame.
+ */
+#define FRAMING_DELIM       0x00
+#define FRAMING_CRC_LEN     2
+#define FRAMING_OVERHEAD    (1 + 1 + FRAMING_CRC_LEN + 1)  // Delimiters, COBS code & CRC; for up to 253 bytes of payload + CRC
+#define FRAMING_MAX_PAYLOAD(mtu) ((((mtu) - FRAMING_OVERHEAD) < 251)? (mtu) - FRAMING_OVERHEAD : 251)
+#define FRAMING_BUFFER_SIZE 256  // Decoded payload + CRC
+
+typedef struct {
+    uint32_t frames;
+    uint32_t crc_errors;
+    uint32_t overflows;  // Too long, no delimiter in time
+} framing_stat_t;
+
+typedef struct {
+    uint8_t  code;        // Of the current COBS block
+    uint8_t  left;        // Bytes left in the current block
+    bool     overflow;    // Skip until the next delimiter.
+    size_t   len;         // Decoded
+    uint8_t  buf[FRAMING_BUFFER_SIZE];
+    const uint8_t *data;  // Current block of the stream
+    size_t   data_len;
+    size_t   cursor;
+    framing_stat_t stat;
+} framing_decoder_t;
+
+extern size_t framing_encode(const void *payload, size_t len, uint8_t *out);  // out: len + FRAMING_OVERHEAD bytes
+extern void   framing_decoder_init(framing_decoder_t *d);
+extern void   framing_decode_begin(framing_decoder_t *d, const uint8_t *data, size_t len);
+extern bool   framing_decode_next(framing_decoder_t *d, const uint8_t **payload, size_t *len);
+
+
+#endif  // __FRAMING_H__
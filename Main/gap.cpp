@@ -0,0 +1,118 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Adaptive inter-frame gaps, replacing the fixed ebyte_tbtw_rxtx_ms & ebyte_tbtw_txtx_ms.
+ *
+ * RX-TX gap: wait for the far end's burst to end, i.e. a few of its inter-arrival times.
+ * TX-TX gap: about the on-air time of a packet, measured by AUX busy periods.
+ * Both are multiplied by a backoff that grows when loss/collision goes over GAP_LOSS_TARGET,
+ *     and shrinks back slowly otherwise -- minimum latency, bounded collision rate.
+ */
+#include "gap.h"
+
+
+#define EWMA(avg, x, shift) ((avg) += ((x) - (avg)) / (1 << (shift)))
+
+static gap_estimate_t est = {
+    .manual = false,
+    .inter_arival_ms = 0,
+    .busy_ms = 0,
+    .loss_rate = 0,
+    .backoff = 1.0,
+    .rxtx_ms = 0,
+    .txtx_ms = 0,
+};
+static uint32_t prev_arival_ms = 0;
+
+
+static uint32_t clamp(float v, uint32_t lo, uint32_t hi) {
+    return (v < lo)? lo : (v > hi)? hi : (uint32_t)v;
+}
+
+
+/**
+ * @brief Pin to manual values, or let the controller run
+ */
+void gap_set_manual(bool manual) {
+    est.manual = manual;
+}
+
+
+/**
+ * @brief Feed a packet arrival
+ */
+void gap_on_arrival(uint32_t now_ms) {
+    uint32_t dt = now_ms - prev_arival_ms;
+    prev_arival_ms = now_ms;
+
+    if (dt <= GAP_BURST_MAX_MS) {  // Within a burst
+        EWMA(est.inter_arival_ms, (float)dt, 3);
+    }
+}
+
+
+/**
+ * @brief Feed an on-air period, from AUX falling to rising
+ */
+void gap_on_aux_busy(uint32_t busy_us) {
+    EWMA(est.busy_ms, busy_us / 1000.0f, 3);
+}
+
+
+/**
+ * @brief Feed a loss/collision (true) or a good packet (false)
+ */
+void gap_on_feedback(bool lost) {
+    EWMA(est.loss_rate, lost? 1.0f : 0.0f, 4);
+
+    if (est.loss_rate > GAP_LOSS_TARGET) {
+        if (lost) {
+            est.backoff *= 1.5f;  // Multiplicative increase
+            if (est.backoff > GAP_BACKOFF_MAX) est.backoff = GAP_BACKOFF_MAX;
+        }
+    }
+    else {
+        est.backoff -= 0.01f;  // Additive decrease
+        if (est.backoff < 1.0f) est.backoff = 1.0f;
+    }
+}
+
+
+/**
+ * @brief Update the gaps, unless they are pinned by the user
+ */
+void gap_update(uint32_t *rxtx_ms, uint32_t *txtx_ms) {
+    // Until measured, the current values stay.
+    if (est.manual == false) {
+        if (est.inter_arival_ms > 0) {
+            *rxtx_ms = clamp((est.inter_arival_ms * GAP_RXTX_K + est.busy_ms) * est.backoff,
+                             GAP_RXTX_MIN_MS, GAP_RXTX_MAX_MS);
+        }
+        if (est.busy_ms > 0) {
+            *txtx_ms = clamp(est.busy_ms * est.backoff, GAP_TXTX_MIN_MS, GAP_TXTX_MAX_MS);
+        }
+    }
+
+    est.rxtx_ms = *rxtx_ms;
+    est.txtx_ms = *txtx_ms;
+}
+
+
+/**
+ * @brief RX-TX gap for the local queue head, that has waited 'head_wait_ms' under it
+ *     The gap waits for the far end's burst to end; a far end that sends at a steady pace never ends it, and a gap
+ *     of a few of its inter-arrival times would hold this end off the air for good. So a head that has waited
+ *     an inter-arrival time already goes after GAP_RXTX_MIN_MS of silence; each end gets its turn.
+ *     Pinned gaps are as set.
+ */
+uint32_t gap_rxtx_hold(uint32_t rxtx_ms, uint32_t head_wait_ms) {
+    if (est.manual  ||  est.inter_arival_ms <= 0  ||  head_wait_ms < est.inter_arival_ms) {
+        return rxtx_ms;
+    }
+    return (rxtx_ms < GAP_RXTX_MIN_MS)? rxtx_ms : GAP_RXTX_MIN_MS;
+}
+
+
+const gap_estimate_t *gap_get_estimate() {
+    return &est;
+}
@@ -0,0 +1,36 @@
+#ifndef __GAP_H__
+#define __GAP_H__
+
+
+#include <stdint.h>
+
+
+#define GAP_RXTX_MIN_MS     5
+#define GAP_RXTX_MAX_MS     2000
+#define GAP_TXTX_MIN_MS     0
+#define GAP_TXTX_MAX_MS     500
+#define GAP_BURST_MAX_MS    1000  // Longer inter-arrival time is a new burst, not a part of the current one.
+#define GAP_RXTX_K          2     // Wait this many inter-arrival times for the far end's burst to end.
+#define GAP_LOSS_TARGET     0.05  // Acceptable collision/loss rate
+#define GAP_BACKOFF_MAX     8.0
+
+typedef struct {
+    bool     manual;           // Pinned to the 'gap' values, no adaptation
+    float    inter_arival_ms;  // EWMA of intra-burst inter-arrival time
+    float    busy_ms;          // EWMA of AUX busy (on-air) duration
+    float    loss_rate;        // EWMA of loss/collision feedback
+    float    backoff;          // Multiplier on both gaps, grows on loss
+    uint32_t rxtx_ms;          // Current output
+    uint32_t txtx_ms;
+} gap_estimate_t;
+
+extern void gap_set_manual(bool manual);
+extern void gap_on_arrival(uint32_t now_ms);
+extern void gap_on_aux_busy(uint32_t busy_us);
+extern void gap_on_feedback(bool lost);
+extern void gap_update(uint32_t *rxtx_ms, uint32_t *txtx_ms);
+extern uint32_t gap_rxtx_hold(uint32_t rxtx_ms, uint32_t head_wait_ms);
+extern const gap_estimate_t *gap_get_estimate();
+
+
+#endif  // __GAP_H__
@@ -9,11 +9,16 @@
 #include "config.h"
 #include "Main.h"
 #include "helper.h"
+#include "termlog.h"
 #include "axp.h"
 #include "led.h"
 #include "cli.h"
 #include "ebyte.h"
 #include "mavlink.h"
+#include "packer.h"
+#include "gap.h"
+#include "spsc.h"
+#include "latency.h"
 #include "gps.h"
 #include "pref.h"
 
@@ -0,0 +1,52 @@
+#ifndef __HAL_H__
+#define __HAL_H__
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * @brief Hardware of the data path: serial port, GPIO pin, clock & yield
+ *
+ * The firmware takes the ESP32 one, inline, see hal_esp32.h; ISR-safe where Arduino's is.
+ * A host build links its own, e.g. tools/hal_linux.cpp: PTYs for the ports, and a virtual clock.
+ *
+ *   hal_serial_of()         -- the port of an Arduino HardwareSerial; where there is one, as tools/host/ has
+ *   hal_serial_available()  -- bytes ready to be read
+ *   hal_serial_read()       -- up to 'len' bytes, as many as come within the port's timeout
+ *   hal_serial_write()      -- all of them, or as many as the port takes
+ *   hal_serial_flush()      -- wait for the TX to complete
+ *   hal_pin_read/write()    -- HAL_LOW or HAL_HIGH
+ *   hal_millis/micros()     -- wrapping
+ *   hal_cycles()            -- CPU cycles, wrapping; hal_cpu_mhz() per us
+ *   hal_yield()             -- let other tasks run for 'ms', 0 is only a yield
+ */
+#if defined(ARDUINO)
+#include "hal_esp32.h"
+
+#else
+#define HAL_LOW     0
+#define HAL_HIGH    1
+
+typedef struct {
+    int fd;  // Non-blocking
+} hal_serial_t;
+
+extern size_t   hal_serial_available(hal_serial_t *s);
+extern size_t   hal_serial_read(hal_serial_t *s, uint8_t *buf, size_t len);
+extern size_t   hal_serial_write(hal_serial_t *s, const uint8_t *buf, size_t len);
+extern void     hal_serial_flush(hal_serial_t *s);
+
+extern uint8_t  hal_pin_read(uint8_t pin);
+extern void     hal_pin_write(uint8_t pin, uint8_t level);
+
+extern uint32_t hal_millis();
+extern uint32_t hal_micros();
+extern uint32_t hal_cycles();
+extern uint32_t hal_cpu_mhz();
+extern void     hal_yield(uint32_t ms);
+#endif
+
+
+#endif  // __HAL_H__
@@ -0,0 +1,76 @@
+#ifndef __HAL_ESP32_H__
+#define __HAL_ESP32_H__
+
+
+#include <Arduino.h>
+
+
+/**
+ * @brief ESP32 implementation of hal.h, over the Arduino core & FreeRTOS
+ *
+ * Always inlined: nothing over the direct calls, and safe in an IRAM ISR where the Arduino call is.
+ */
+#define HAL_INLINE  static inline __attribute__((always_inline))
+
+#define HAL_LOW     LOW
+#define HAL_HIGH    HIGH
+
+typedef struct {
+    HardwareSerial *hs;  // Begun & configured by the owner
+} hal_serial_t;
+
+
+HAL_INLINE hal_serial_t hal_serial_of(HardwareSerial *hs) {
+    hal_serial_t s = {hs};
+    return s;
+}
+
+HAL_INLINE size_t hal_serial_available(hal_serial_t *s) {
+    return s->hs->available();
+}
+
+HAL_INLINE size_t hal_serial_read(hal_serial_t *s, uint8_t *buf, size_t len) {
+    return s->hs->readBytes(buf, len);
+}
+
+HAL_INLINE size_t hal_serial_write(hal_serial_t *s, const uint8_t *buf, size_t len) {
+    return s->hs->write(buf, len);
+}
+
+HAL_INLINE void hal_serial_flush(hal_serial_t *s) {
+    s->hs->flush();
+}
+
+
+HAL_INLINE uint8_t hal_pin_read(uint8_t pin) {
+    return digitalRead(pin);
+}
+
+HAL_INLINE void hal_pin_write(uint8_t pin, uint8_t level) {
+    digitalWrite(pin, level);
+}
+
+
+HAL_INLINE uint32_t hal_millis() {
+    return millis();
+}
+
+HAL_INLINE uint32_t hal_micros() {
+    return micros();
+}
+
+HAL_INLINE uint32_t hal_cycles() {
+    return ESP.getCycleCount();
+}
+
+HAL_INLINE uint32_t hal_cpu_mhz() {
+    return ESP.getCpuFreqMHz();
+}
+
+HAL_INLINE void hal_yield(uint32_t ms) {
+    if (ms == 0) taskYIELD();
+    else vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+
+#endif  // __HAL_ESP32_H__
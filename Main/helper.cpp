@@ -6,7 +6,7 @@
  */
 void term_printf(const char *format, ...)
 {
-    static char buf[SIZE_DEBUG_BUF];
+    char buf[SIZE_DEBUG_BUF];  // On the stack, called from more than one task
     char *p = buf;
     va_list ap;
     va_start(ap, format);
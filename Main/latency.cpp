@@ -0,0 +1,64 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Latency histograms of the forwarding stages.
+ *
+ * Bucket of v >= 2^S, with e = floor(log2(v)): ((e - S + 1) << S) + the S bits of v after its leading one.
+ */
+#include <string.h>
+
+#include "latency.h"
+
+
+#define SUB_COUNT   (1u << LAT_SUB_BITS)
+
+
+static inline uint8_t lat_msb(uint32_t v) {
+    return 31 - __builtin_clz(v);
+}
+
+static inline uint16_t lat_bucket(uint32_t v) {
+    if (v < SUB_COUNT) return v;
+    uint8_t e = lat_msb(v);
+    return ((e - LAT_SUB_BITS + 1) << LAT_SUB_BITS) + ((v >> (e - LAT_SUB_BITS)) & (SUB_COUNT - 1));
+}
+
+static inline uint32_t lat_bucket_top(uint16_t b) {  // Largest value of the bucket
+    if (b < SUB_COUNT) return b;
+    uint8_t e = (b >> LAT_SUB_BITS) + LAT_SUB_BITS - 1;
+    uint32_t sub = b & (SUB_COUNT - 1);
+    uint64_t low = ((uint64_t)(SUB_COUNT + sub)) << (e - LAT_SUB_BITS);
+    uint64_t top = low + (1ull << (e - LAT_SUB_BITS)) - 1;
+    return (top > UINT32_MAX)? UINT32_MAX : (uint32_t)top;
+}
+
+
+void lat_reset(lat_hist_t *h) {
+    memset(h, 0, sizeof(lat_hist_t));
+}
+
+
+void lat_add(lat_hist_t *h, uint32_t us) {
+    h->buckets[lat_bucket(us)]++;
+    h->count++;
+    h->sum += us;
+    if (us > h->max) h->max = us;
+}
+
+
+uint32_t lat_percentile(const lat_hist_t *h, uint8_t pct) {
+    if (h->count == 0) return 0;
+
+    uint32_t rank = ((uint64_t)h->count * pct + 99) / 100;  // Ceiling, at least the first
+    if (rank == 0) rank = 1;
+
+    uint32_t seen = 0;
+    for (uint16_t b = 0; b < LAT_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            uint32_t top = lat_bucket_top(b);
+            return (top < h->max)? top : h->max;
+        }
+    }
+    return h->max;
+}
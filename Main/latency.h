@@ -0,0 +1,30 @@
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * @brief Log-bucketed latency histogram, in us
+ *
+ * Each power of two is split into 2^LAT_SUB_BITS buckets, so a percentile is within 1/2^LAT_SUB_BITS
+ *     of the true value, at any scale; values below 2^LAT_SUB_BITS have a bucket each.
+ */
+#define LAT_SUB_BITS    2
+#define LAT_BUCKETS     ((32 - LAT_SUB_BITS + 1) << LAT_SUB_BITS)
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[LAT_BUCKETS];
+} lat_hist_t;
+
+extern void     lat_reset(lat_hist_t *h);
+extern void     lat_add(lat_hist_t *h, uint32_t us);
+extern uint32_t lat_percentile(const lat_hist_t *h, uint8_t pct);  // Upper bound of the bucket, at most 'max'
+
+
+#endif  // __LATENCY_H__
@@ -1,153 +1,274 @@
 /**
  * @author Pasakorn Tiwatthanont (iPAS)
  *
- * The MIT License (MIT)
+ * Streaming MAVLink v1/v2 frame parser.
  *
- * Copyright (c) 2019 Renzo Mischianti www.mischianti.org All right reserved.
- *
- * You may copy, alter and reuse this code in any way you like, but please leave
- * reference to www.mischianti.org in your comments if you redistribute this code.
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software and associated documentation files (the "Software"), to deal
- * in the Software without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Software, and to permit persons to whom the Software is
- * furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in
- * all copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
- * THE SOFTWARE.
+ * Bytes are fed block by block, e.g. a radio packet or a UART read, and the exact boundaries of
+ *     CRC-valid frames are returned as pointers into the block. Only the head of a frame that is
+ *     split across two blocks is kept in the parser.
+ * On a CRC failure, scanning restarts just after the false STX, to resynchronize on a real frame.
+ * A frame of unknown msgid cannot be CRC-checked, so it is accepted only while in sync,
+ *     i.e. right after a verified frame; otherwise any STX in garbage would be taken.
  */
-#include "global.h"
+#include "mavlink.h"
+#include "crc16.h"
 
 
 /**
- * @brief
- *
+ * @brief CRC_EXTRA of the common & ardupilotmega dialects, sorted by msgid
  */
-char * mavlink_segmentor(char * data, size_t len, size_t *new_len) {
-    // *new_len = len;
-    // return data;  // XXX: bypass
-
-    const char MAV1_STX = 0xFE;
-    const char MAV2_STX = 0xFD;
-
-    static char buf[MAVLINK_BUFFER_SIZE];
-    static char buf2[MAVLINK_BUFFER_SIZE];
-    static size_t buf_len = 0;
-    char *p = data;
-    *new_len = len;
-
-    // Prepare & concatenate the buffer
-    if (buf_len > 0) {  // Concatenate with the old fregment.
-        // data = buf + data;
-        memcpy(buf, data, len);
-        *new_len = buf_len + len;
-        buf_len = 0;
-        p = buf;
-    }
-    char stx = p[0];
+typedef struct {
+    uint32_t msgid;
+    uint8_t  crc_extra;
+} mavlink_crc_entry_t;
 
-    // Something is wrong ?!
-    if (stx != MAV1_STX  &&  stx != MAV2_STX) {
-        if (system_verbose_level >= VERBOSE_ERROR) {
-            term_printf("[EBYTE] First message is not a Mavlink!" ENDL);
-        }
+static const mavlink_crc_entry_t crc_extras[] = {
+    {0, 50}, {1, 124}, {2, 137}, {4, 237}, {5, 217}, {6, 104}, {7, 119}, {8, 117}, {11, 89},
+    {20, 214}, {21, 159}, {22, 220}, {23, 168}, {24, 24}, {25, 23}, {26, 170}, {27, 144}, {28, 67}, {29, 115},
+    {30, 39}, {31, 246}, {32, 185}, {33, 104}, {34, 237}, {35, 244}, {36, 222}, {37, 212}, {38, 9}, {39, 254},
+    {40, 230}, {41, 28}, {42, 28}, {43, 132}, {44, 221}, {45, 232}, {46, 11}, {47, 153}, {48, 41}, {49, 39},
+    {50, 78}, {51, 196}, {54, 15}, {55, 3}, {61, 167}, {62, 183}, {63, 119}, {64, 191}, {65, 118}, {66, 148},
+    {67, 21}, {69, 243}, {70, 124}, {73, 38}, {74, 20}, {75, 158}, {76, 152}, {77, 143}, {81, 106}, {82, 49},
+    {83, 22}, {84, 143}, {85, 140}, {86, 5}, {87, 150}, {89, 231}, {90, 183}, {91, 63}, {92, 54}, {93, 47},
+    {100, 175}, {101, 102}, {102, 158}, {103, 208}, {104, 56}, {105, 93}, {106, 138}, {107, 108}, {108, 32}, {109, 185},
+    {110, 84}, {111, 34}, {112, 174}, {113, 124}, {114, 237}, {115, 4}, {116, 76}, {117, 128}, {118, 56}, {119, 116},
+    {120, 134}, {121, 237}, {122, 203}, {123, 250}, {124, 87}, {125, 203}, {126, 220}, {127, 25}, {128, 226}, {129, 46},
+    {130, 29}, {131, 223}, {132, 85}, {133, 6}, {134, 229}, {135, 203}, {136, 1}, {137, 195}, {138, 109}, {139, 168},
+    {140, 181}, {141, 47}, {142, 72}, {143, 131}, {144, 127}, {146, 103}, {147, 154}, {148, 178}, {149, 200},
+    {150, 134}, {152, 208}, {162, 189}, {163, 127}, {164, 154}, {165, 21}, {168, 1}, {173, 83}, {178, 47}, {182, 229},
+    {192, 36}, {193, 71}, {194, 98},
+    {230, 163}, {231, 105}, {232, 151}, {233, 35}, {234, 150}, {235, 179}, {241, 90}, {242, 104}, {243, 85}, {244, 95},
+    {245, 130}, {246, 184}, {247, 81}, {248, 8}, {249, 204}, {250, 49}, {251, 170}, {252, 44}, {253, 83}, {254, 46},
+    {256, 71}, {257, 131}, {258, 187},
+};
 
-        *new_len = len;
-        return data;  // Nothing changed
+
+/**
+ * @brief CRC_EXTRA of the msgid, or -1 if not known
+ */
+int mavlink_crc_extra(uint32_t msgid) {
+    size_t lo = 0, hi = sizeof(crc_extras) / sizeof(crc_extras[0]);
+    while (lo < hi) {  // Binary search
+        size_t mid = (lo + hi) / 2;
+        if (crc_extras[mid].msgid < msgid)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
+    return (lo < sizeof(crc_extras) / sizeof(crc_extras[0])  &&  crc_extras[lo].msgid == msgid)? crc_extras[lo].crc_extra : -1;
+}
 
-    // A Mavlink message has been found
-    else {
-        size_t last_index = strrchr(p, stx) - p;
-        size_t last_frame_len = p[last_index + 1];
-        switch (stx) {
-            case MAV1_STX:
-                last_frame_len += 2  // stx, payload_len
-                                + 3  // seq, sysid, compid
-                                + 1  // msgid
-                                + 2; // chksum
-                break;
-            case MAV2_STX:
-                last_frame_len += 2  // stx, payload_len
-                                + 2  // incomp_flags, comp_flags
-                                + 3  // seq, sysid, compid
-                                + 3  // msgid
-                                + 2  // chksum
-                                + 13;// signature
-                break;
+
+void mavlink_parser_init(mavlink_parser_t *p) {
+    memset(p, 0, sizeof(mavlink_parser_t));
+}
+
+
+/**
+ * @brief Feed a new block
+ */
+void mavlink_parse_begin(mavlink_parser_t *p, const uint8_t *data, size_t len) {
+    p->data = data;
+    p->len = len;
+    p->cursor = p->carry_len;  // The carried bytes have been parsed already.
+}
+
+
+/**
+ * @brief Parse the block until a frame is complete.
+ *
+ * @return true with 'frame' filled; false when the block runs out, the unfinished frame is kept for the next block.
+ */
+bool mavlink_parse_next(mavlink_parser_t *p, mavlink_frame_t *frame) {
+    size_t end = p->carry_len + p->len;
+    size_t i = p->cursor;
+
+    for (; i < end; i++) {
+        uint8_t c = (i < p->carry_len)? p->carry[i] : p->data[i - p->carry_len];
+
+        // Idle, looking for STX
+        if (p->pos == 0) {
+            if (c == MAVLINK_STX_V1  ||  c == MAVLINK_STX_V2) {
+                p->stx = c;
+                p->header_len = (c == MAVLINK_STX_V1)? MAVLINK_HEADER_LEN_V1 : MAVLINK_HEADER_LEN_V2;
+                p->crc = CRC16_INIT;
+                p->msgid = 0;
+                p->frame_start = i;
+                p->pos = 1;
+            }
+            else {
+                p->stat.skipped_bytes++;
+                p->synced = false;
+            }
+            continue;
+        }
+
+        // Payload in bulk, as far as this block goes; the hot path
+        if (p->pos >= p->header_len  &&  p->pos < p->header_len + p->payload_len) {
+            size_t seg_end = (i < p->carry_len)? p->carry_len : end;
+            size_t n = p->header_len + p->payload_len - p->pos;
+            if (n > seg_end - i) n = seg_end - i;
+            const uint8_t *src = (i < p->carry_len)? &p->carry[i] : &p->data[i - p->carry_len];
+            p->crc = crc16_update(src, n, p->crc);
+            p->pos += n;
+            i += n - 1;
+            continue;
         }
 
-        /////////////////////
-        // Complete frames //
-        /////////////////////
-        size_t complete_frames_len = last_index + last_frame_len;
+        uint16_t pos = p->pos++;
 
-        if (complete_frames_len == *new_len) {
-            if (system_verbose_level >= VERBOSE_DEBUG) {
-                term_printf("[EBYTE] Complete Mavlink messages received, "
-                    "STX:%2X len:%lu lst_idx:%lu lst_len:%lu" ENDL,
-                    stx, *new_len, last_index, last_frame_len);
+        // Header & payload, under CRC
+        if (pos < p->header_len + p->payload_len  ||  pos == 1) {
+            p->crc = crc16_accumulate(c, p->crc);
+
+            if (pos == 1) {
+                p->payload_len = c;
+                p->frame_len = p->header_len + c + MAVLINK_CHECKSUM_LEN;
+            }
+            else if (p->stx == MAVLINK_STX_V1) {
+                switch (pos) {
+                    case 3: p->sysid = c; break;
+                    case 4: p->compid = c; break;
+                    case 5: p->msgid = c; break;
+                }
+            }
+            else {
+                switch (pos) {
+                    case 2:
+                        if (c & ~MAVLINK_IFLAG_SIGNED) goto bad_frame;  // Unknown incompatibility, cannot be parsed.
+                        if (c & MAVLINK_IFLAG_SIGNED) p->frame_len += MAVLINK_SIGNATURE_LEN;
+                        break;
+                    case 5: p->sysid = c; break;
+                    case 6: p->compid = c; break;
+                    case 7: p->msgid = c; break;
+                    case 8: p->msgid |= (uint32_t)c << 8; break;
+                    case 9: p->msgid |= (uint32_t)c << 16; break;
+                }
+            }
+        }
+
+        // Checksum
+        else if (pos < p->header_len + p->payload_len + MAVLINK_CHECKSUM_LEN) {
+            bool low = (pos == p->header_len + p->payload_len);
+            if (low) {
+                p->crc_extra = mavlink_crc_extra(p->msgid);
+                if (p->crc_extra >= 0) p->crc = crc16_accumulate(p->crc_extra, p->crc);
             }
 
-        } else
-        /////////////////////////////////
-        // Data over on the last frame //
-        /////////////////////////////////
-        if (complete_frames_len < *new_len) {
-            if (system_verbose_level >= VERBOSE_DEBUG) {
-                term_printf("[EBYTE] Drop a fregment of Mavlink message, "
-                    "STX:%2X len:%lu lst_idx:%lu lst_len:%lu" ENDL,
-                    stx, *new_len, last_index, last_frame_len);
+            if (p->crc_extra >= 0) {
+                if (c != ((low)? (p->crc & 0xFF) : (p->crc >> 8))) {
+                    p->stat.crc_errors++;
+                    goto bad_frame;
+                }
             }
+        }
+
+        // Signature is just counted.
 
-            *new_len = complete_frames_len;  // Use only full frames. Drop the left
-
-        } else
-        ///////////////////////////////////////////////
-        // Lack of data, leave the last frame in buf //
-        ///////////////////////////////////////////////
-        if (complete_frames_len > *new_len) {
-            if (system_verbose_level >= VERBOSE_DEBUG) {
-                term_printf("[EBYTE] Leave a fregment of Mavlink message in buf, "
-                    "STX:%2X len:%lu lst_idx:%lu lst_len:%lu" ENDL,
-                    stx, *new_len, last_index, last_frame_len);
+        if (p->pos == p->frame_len) {  // Complete
+            if (p->crc_extra < 0) {
+                if (p->synced == false) goto bad_frame;
+                p->stat.unknown_msgids++;
+            }
+            else {
+                p->synced = true;
             }
 
-            memcpy(buf2, p, *new_len);
-            buf_len = *new_len - complete_frames_len;
-            memcpy(buf, &buf2[complete_frames_len], buf_len);
+            frame->stx = p->stx;
+            frame->sysid = p->sysid;
+            frame->compid = p->compid;
+            frame->msgid = p->msgid;
+            frame->verified = p->crc_extra >= 0;
 
-            *new_len = complete_frames_len;  // Use only full frames. Drop the left
-            p = buf2;
+            if (p->frame_start < p->carry_len) {  // Begun in the previous block
+                frame->head = &p->carry[p->frame_start];
+                frame->head_len = ((i + 1 < p->carry_len)? i + 1 : p->carry_len) - p->frame_start;
+                frame->body = p->data;
+                frame->body_len = (i + 1 > p->carry_len)? i + 1 - p->carry_len : 0;
+            }
+            else {
+                frame->head = NULL;
+                frame->head_len = 0;
+                frame->body = &p->data[p->frame_start - p->carry_len];
+                frame->body_len = i + 1 - p->frame_start;
+            }
+
+            p->stat.frames++;
+            p->pos = 0;
+            p->cursor = i + 1;
+            return true;
         }
+        continue;
+
+      bad_frame:
+        p->pos = 0;
+        p->synced = false;
+        p->stat.skipped_bytes++;  // The false STX
+        i = p->frame_start;  // Rescan just after it.
     }
 
-    return p;
+    // Keep the unfinished frame for the next block.
+    if (p->pos > 0) {
+        size_t n = end - p->frame_start;  // < MAVLINK_MAX_FRAME_LEN, as frame_len is bounded.
+        if (p->frame_start < p->carry_len) {
+            memmove(p->carry, &p->carry[p->frame_start], p->carry_len - p->frame_start);
+            memcpy(&p->carry[p->carry_len - p->frame_start], p->data, p->len);
+        }
+        else {
+            memcpy(p->carry, &p->data[p->frame_start - p->carry_len], n);
+        }
+        p->carry_len = n;
+        p->frame_start = 0;
+    }
+    else {
+        p->carry_len = 0;
+    }
+    p->cursor = p->carry_len;
+    return false;
 }
 
 
-#ifdef TEST_MAVLINK
 /**
- * @brief
+ * @brief Build an unsigned frame into 'buf', at least MAVLINK_MAX_FRAME_LEN bytes.
  *
+ * @return Frame length, 0 on unknown msgid
  */
-void mavlink_test_segmmentor() {
-    // char *p;
-    // size_t len;
+size_t mavlink_pack(uint8_t *buf, uint8_t stx, uint8_t seq, uint8_t sysid, uint8_t compid,
+                    uint32_t msgid, const uint8_t *payload, uint8_t len) {
+    int crc_extra = mavlink_crc_extra(msgid);
+    if (crc_extra < 0) return 0;
 
-    // String data = "";
+    size_t n = 0;
+    buf[n++] = stx;
+    buf[n++] = len;
+    if (stx == MAVLINK_STX_V2) {
+        buf[n++] = 0;  // incompat_flags
+        buf[n++] = 0;  // compat_flags
+    }
+    buf[n++] = seq;
+    buf[n++] = sysid;
+    buf[n++] = compid;
+    buf[n++] = msgid & 0xFF;
+    if (stx == MAVLINK_STX_V2) {
+        buf[n++] = (msgid >> 8) & 0xFF;
+        buf[n++] = (msgid >> 16) & 0xFF;
+    }
+    memcpy(&buf[n], payload, len);
+    n += len;
 
-    // p = mavlink_segmentor(data, &len);
+    uint16_t crc = crc16_update(&buf[1], n - 1, CRC16_INIT);
+    crc = crc16_accumulate(crc_extra, crc);
+    buf[n++] = crc & 0xFF;
+    buf[n++] = crc >> 8;
+    return n;
+}
 
+size_t mavlink_pack_radio_status(uint8_t *buf, uint8_t stx, uint8_t seq, uint8_t sysid, uint8_t compid,
+                                 const mavlink_radio_status_t *rs) {
+    uint8_t payload[MAVLINK_RADIO_STATUS_LEN] = {  // Wire order, little-endian
+        (uint8_t)(rs->rxerrors & 0xFF), (uint8_t)(rs->rxerrors >> 8),
+        (uint8_t)(rs->fixed & 0xFF), (uint8_t)(rs->fixed >> 8),
+        rs->rssi, rs->remrssi, rs->txbuf, rs->noise, rs->remnoise,
+    };
+    return mavlink_pack(buf, stx, seq, sysid, compid, MAVLINK_MSG_ID_RADIO_STATUS, payload, sizeof(payload));
 }
-#endif
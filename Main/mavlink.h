@@ -2,14 +2,93 @@
 #define __MAVLINK_H__
 
 
-#define TEST_MAVLINK
-#define MAVLINK_BUFFER_SIZE 1024
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
 
-extern char * mavlink_segmentor(char * data, size_t len, size_t *new_len);
 
-#ifdef TEST_MAVLINK
-extern void mavlink_test_segmmentor();
-#endif
+#define MAVLINK_STX_V1          0xFE
+#define MAVLINK_STX_V2          0xFD
+#define MAVLINK_HEADER_LEN_V1   6   // stx, len, seq, sysid, compid, msgid
+#define MAVLINK_HEADER_LEN_V2   10  // stx, len, incompat_flags, compat_flags, seq, sysid, compid, msgid[3]
+#define MAVLINK_CHECKSUM_LEN    2
+#define MAVLINK_SIGNATURE_LEN   13
+#define MAVLINK_IFLAG_SIGNED    0x01
+#define MAVLINK_MAX_FRAME_LEN   (MAVLINK_HEADER_LEN_V2 + 255 + MAVLINK_CHECKSUM_LEN + MAVLINK_SIGNATURE_LEN)  // 280
+
+#define MAVLINK_MSG_ID_RADIO_STATUS     109
+#define MAVLINK_RADIO_STATUS_LEN        9
+#define MAVLINK_COMP_ID_TELEMETRY_RADIO 68
+
+
+/**
+ * @brief A complete frame, possibly in two pieces:
+ *     'head' was carried over from the previous block, 'body' is in the current block.
+ * Both are valid until the block runs out, i.e. mavlink_parse_next() returns false.
+ */
+typedef struct {
+    const uint8_t *head;
+    size_t   head_len;
+    const uint8_t *body;
+    size_t   body_len;
+    uint32_t msgid;
+    uint8_t  sysid;
+    uint8_t  compid;
+    uint8_t  stx;
+    bool     verified;  // CRC checked; false on unknown msgid, no CRC_EXTRA to check with -- accepted only in sync.
+} mavlink_frame_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t crc_errors;
+    uint32_t unknown_msgids;
+    uint32_t skipped_bytes;  // Not in any frame, or dropped on resync
+} mavlink_parser_stat_t;
+
+typedef struct {
+    uint16_t pos;            // Bytes of the current frame seen so far, 0 is idle.
+    bool     synced;         // The last frame was verified, and nothing was skipped after it.
+    uint16_t frame_len;      // Total length, known after the header
+    uint16_t header_len;
+    uint16_t crc;
+    int16_t  crc_extra;      // -1 on unknown msgid
+    uint8_t  stx;
+    uint8_t  payload_len;
+    uint8_t  sysid;
+    uint8_t  compid;
+    uint32_t msgid;
+    // Input is virtually carry[0:carry_len] + data[0:len], so the carried bytes can be rescanned.
+    const uint8_t *data;
+    size_t   len;
+    size_t   cursor;         // Next virtual offset to be parsed
+    size_t   frame_start;    // Virtual offset of the current frame
+    uint16_t carry_len;
+    uint8_t  carry[MAVLINK_MAX_FRAME_LEN];  // Only the head of a frame split across blocks
+    mavlink_parser_stat_t stat;
+} mavlink_parser_t;
+
+/**
+ * @brief RADIO_STATUS, as SiK radios report; rssi & noise are 255 if unknown.
+ */
+typedef struct {
+    uint16_t rxerrors;
+    uint16_t fixed;
+    uint8_t  rssi;
+    uint8_t  remrssi;
+    uint8_t  txbuf;  // Remaining free transmit buffer space, %
+    uint8_t  noise;
+    uint8_t  remnoise;
+} mavlink_radio_status_t;
+
+extern void mavlink_parser_init(mavlink_parser_t *p);
+extern void mavlink_parse_begin(mavlink_parser_t *p, const uint8_t *data, size_t len);
+extern bool mavlink_parse_next(mavlink_parser_t *p, mavlink_frame_t *frame);
+extern int  mavlink_crc_extra(uint32_t msgid);
+
+extern size_t mavlink_pack(uint8_t *buf, uint8_t stx, uint8_t seq, uint8_t sysid, uint8_t compid,
+                           uint32_t msgid, const uint8_t *payload, uint8_t len);
+extern size_t mavlink_pack_radio_status(uint8_t *buf, uint8_t stx, uint8_t seq, uint8_t sysid, uint8_t compid,
+                                        const mavlink_radio_status_t *rs);
 
 
 #endif  // __MAVLINK_H__
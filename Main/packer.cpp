@@ -0,0 +1,93 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Packing whole MAVLink frames into radio packets.
+ *
+ * Every radio packet pays the preamble, header & turnaround, so small frames, e.g. HEARTBEAT,
+ *     are bin-packed in order, as many as fit the MTU.
+ * A frame that fits a packet is never split; it waits for the next packet instead.
+ * Only a frame larger than the MTU is split -- its head fills up the current packet.
+ */
+#include "packer.h"
+
+
+void packer_init(packer_t *pk, size_t mtu) {
+    memset(pk, 0, sizeof(packer_t));
+    pk->mtu = (mtu < PACKER_MTU_MAX)? mtu : PACKER_MTU_MAX;
+}
+
+
+/**
+ * @brief Stage a frame, in two pieces as of mavlink_frame_t
+ */
+bool packer_push(packer_t *pk, const uint8_t *head, size_t head_len, const uint8_t *body, size_t body_len,
+                 uint32_t tag) {
+    size_t len = head_len + body_len;
+    if (len == 0) return true;
+    if (pk->len + len > PACKER_STAGE_SIZE  ||  pk->frame_count >= PACKER_MAX_FRAMES) {
+        pk->stat.drops++;
+        return false;
+    }
+
+    if (head_len > 0) memcpy(&pk->stage[pk->len], head, head_len);
+    memcpy(&pk->stage[pk->len + head_len], body, body_len);
+    pk->len += len;
+    pk->frame_tags[pk->frame_count] = tag;
+    pk->frame_lens[pk->frame_count++] = len;
+    return true;
+}
+
+
+uint32_t packer_tag(const packer_t *pk) {
+    return (pk->frame_count > 0)? pk->frame_tags[0] : 0;
+}
+
+
+/**
+ * @brief The next packet, at the front of the stage
+ *
+ * @return Length of the packet, 0 if nothing is staged.
+ */
+size_t packer_peek(const packer_t *pk, const uint8_t **packet) {
+    size_t n = 0;
+    for (uint16_t i = 0; i < pk->frame_count; i++) {
+        size_t f = pk->frame_lens[i];
+        if (n + f <= pk->mtu) {
+            n += f;
+        }
+        else {
+            if (f > pk->mtu) n = pk->mtu;  // Cannot fit any packet, split here.
+            break;
+        }
+    }
+    *packet = pk->stage;
+    return n;
+}
+
+
+/**
+ * @brief Drop the packet that has been sent
+ */
+void packer_consume(packer_t *pk, size_t n) {
+    if (n > pk->len) n = pk->len;
+
+    size_t left = n;
+    uint16_t done = 0;
+    while (done < pk->frame_count  &&  pk->frame_lens[done] <= left) {
+        left -= pk->frame_lens[done++];
+    }
+    if (left > 0) {  // Split
+        pk->frame_lens[done] -= left;
+        pk->stat.splits++;
+    }
+
+    pk->frame_count -= done;
+    memmove(pk->frame_lens, &pk->frame_lens[done], pk->frame_count * sizeof(pk->frame_lens[0]));
+    memmove(pk->frame_tags, &pk->frame_tags[done], pk->frame_count * sizeof(pk->frame_tags[0]));
+    pk->len -= n;
+    memmove(pk->stage, &pk->stage[n], pk->len);
+
+    pk->stat.packets++;
+    pk->stat.frames += done;
+    pk->stat.bytes += n;
+}
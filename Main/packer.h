@@ -0,0 +1,45 @@
+#ifndef __PACKER_H__
+#define __PACKER_H__
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "mavlink.h"
+
+
+#define PACKER_MTU_MAX      256  // Radio packet
+#define PACKER_STAGE_SIZE   (PACKER_MTU_MAX + 2 * MAVLINK_MAX_FRAME_LEN)
+#define PACKER_MAX_FRAMES   (PACKER_STAGE_SIZE / (MAVLINK_HEADER_LEN_V1 + MAVLINK_CHECKSUM_LEN))  // Of the smallest frame
+
+typedef struct {
+    uint32_t packets;
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t splits;  // Frame pieces put at the end of a packet, as the frame cannot fit any packet
+    uint32_t drops;   // Frames pushed with no room
+} packer_stat_t;
+
+/**
+ * @brief Whole frames are staged back-to-back; a packet is always a prefix of the stage.
+ */
+typedef struct {
+    size_t   mtu;
+    size_t   len;                            // Staged bytes
+    uint16_t frame_count;
+    uint16_t frame_lens[PACKER_MAX_FRAMES];  // The first one may be partly sent already.
+    uint32_t frame_tags[PACKER_MAX_FRAMES];  // Of the caller, e.g. a timestamp
+    uint8_t  stage[PACKER_STAGE_SIZE];
+    packer_stat_t stat;
+} packer_t;
+
+extern void   packer_init(packer_t *pk, size_t mtu);
+extern bool   packer_push(packer_t *pk, const uint8_t *head, size_t head_len, const uint8_t *body, size_t body_len,
+                          uint32_t tag = 0);
+extern uint32_t packer_tag(const packer_t *pk);  // Of the first staged frame, 0 if none
+extern size_t packer_peek(const packer_t *pk, const uint8_t **packet);
+extern void   packer_consume(packer_t *pk, size_t n);
+
+
+#endif  // __PACKER_H__
@@ -13,6 +13,10 @@ typedef struct {
         PREF_CHANNEL,
         PREF_TIME_GAP,
         PREF_MSG_TYPE,
+        PREF_RADIO_STATUS,
+        PREF_FLOW_CTRL,
+        PREF_RELIABLE,
+        PREF_FEC,
     } code;
 
     String desc() {
@@ -23,6 +27,10 @@ typedef struct {
             case PREF_TXPOWER:  return F("TxPower pref.");
             case PREF_TIME_GAP:      return F("Inter-frame space pref.");
             case PREF_MSG_TYPE: return F("Msg type pref.");
+            case PREF_RADIO_STATUS: return F("RADIO_STATUS period pref.");
+            case PREF_FLOW_CTRL: return F("Flow control pref.");
+            case PREF_RELIABLE: return F("Reliable mode pref.");
+            case PREF_FEC:      return F("FEC ratio pref.");
             default:            return F("Not yet implemented!");
         }
     };
@@ -31,10 +31,24 @@ void pref_load(preference_topic_t topic) {
     if (topic.code == topic.PREF_ALL  ||  topic.code == topic.PREF_TIME_GAP) {
         ebyte_tbtw_rxtx_ms = pref.getULong(STR(PREF_TBTW_RXTX), ebyte_tbtw_rxtx_ms);
         ebyte_tbtw_txtx_ms = pref.getULong(STR(PREF_TBTW_TXTX), ebyte_tbtw_txtx_ms);
+        ebyte_tbtw_manual = pref.getBool(STR(PREF_TBTW_MAN), ebyte_tbtw_manual);
     }
     if (topic.code == topic.PREF_ALL  ||  topic.code == topic.PREF_MSG_TYPE) {
         ebyte_message_type = pref.getUChar(STR(PREF_MSG_TYPE), ebyte_message_type);
     }
+    if (topic.code == topic.PREF_ALL  ||  topic.code == topic.PREF_RADIO_STATUS) {
+        ebyte_radio_status_ms = pref.getULong(STR(PREF_RSTAT_MS), ebyte_radio_status_ms);
+    }
+    if (topic.code == topic.PREF_ALL  ||  topic.code == topic.PREF_FLOW_CTRL) {
+        ebyte_flow_control = pref.getUChar(STR(PREF_FLOW_CTRL), ebyte_flow_control);
+    }
+    if (topic.code == topic.PREF_ALL  ||  topic.code == topic.PREF_RELIABLE) {
+        ebyte_reliable = pref.getBool(STR(PREF_RELIABLE), ebyte_reliable);
+    }
+    if (topic.code == topic.PREF_ALL  ||  topic.code == topic.PREF_FEC) {
+        ebyte_fec_k = pref.getUChar(STR(PREF_FEC_K), ebyte_fec_k);
+        ebyte_fec_n = pref.getUChar(STR(PREF_FEC_N), ebyte_fec_n);
+    }
 
     pref.end();
 }
@@ -49,6 +63,10 @@ void pref_apply(preference_topic_t topic) {
         case topic.PREF_CHANNEL: ebyte_set_channel(ebyte_channel); break;
         case topic.PREF_TIME_GAP: break;
         case topic.PREF_MSG_TYPE: break;
+        case topic.PREF_RADIO_STATUS: break;
+        case topic.PREF_FLOW_CTRL: ebyte_set_flow_control(ebyte_flow_control); break;
+        case topic.PREF_RELIABLE: break;
+        case topic.PREF_FEC: break;
         default: break;
     }
 }
@@ -73,10 +91,24 @@ void pref_save(preference_topic_t topic) {
     if (topic.code == topic.PREF_ALL  ||  topic.code == topic.PREF_TIME_GAP) {
         pref.putULong(STR(PREF_TBTW_RXTX), ebyte_tbtw_rxtx_ms);
         pref.putULong(STR(PREF_TBTW_TXTX), ebyte_tbtw_txtx_ms);
+        pref.putBool(STR(PREF_TBTW_MAN), ebyte_tbtw_manual);
     }
     if (topic.code == topic.PREF_ALL  ||  topic.code == topic.PREF_MSG_TYPE) {
         pref.putUChar(STR(PREF_MSG_TYPE), ebyte_message_type);
     }
+    if (topic.code == topic.PREF_ALL  ||  topic.code == topic.PREF_RADIO_STATUS) {
+        pref.putULong(STR(PREF_RSTAT_MS), ebyte_radio_status_ms);
+    }
+    if (topic.code == topic.PREF_ALL  ||  topic.code == topic.PREF_FLOW_CTRL) {
+        pref.putUChar(STR(PREF_FLOW_CTRL), ebyte_flow_control);
+    }
+    if (topic.code == topic.PREF_ALL  ||  topic.code == topic.PREF_RELIABLE) {
+        pref.putBool(STR(PREF_RELIABLE), ebyte_reliable);
+    }
+    if (topic.code == topic.PREF_ALL  ||  topic.code == topic.PREF_FEC) {
+        pref.putUChar(STR(PREF_FEC_K), ebyte_fec_k);
+        pref.putUChar(STR(PREF_FEC_N), ebyte_fec_n);
+    }
 
     pref.end();
 }
@@ -90,3 +90,186 @@ linklist_t *q_item(queue_t *q, uint8_t index)
     }
     return spider;
 }
+
+
+void sq_init(slab_queue_t *q, void *storage, size_t slot_size, size_t slot_count)
+{
+    uint8_t *p = (uint8_t *)storage;
+
+    if (slot_count > SQ_MAX_SLOTS)
+    {
+        slot_count = SQ_MAX_SLOTS;
+    }
+
+    q->blocks = p;
+    p += SQ_ALIGN(slot_size) * slot_count;
+    q->lens = (uint16_t *)p;
+    p += SQ_ALIGN(sizeof(uint16_t) * slot_count);
+    q->refs = p;
+    p += SQ_ALIGN(slot_count);
+    q->ring = p;
+    p += SQ_ALIGN(slot_count);
+    q->free_list = p;
+
+    q->slot_size = slot_size;
+    q->slot_count = slot_count;
+    q->head = 0;
+    q->tail = 0;
+    q->len = 0;
+
+    // All blocks are free.
+    for (q->free_top = 0; q->free_top < slot_count; q->free_top++)
+    {
+        q->free_list[q->free_top] = q->free_top;
+        q->refs[q->free_top] = 0;
+    }
+}
+
+
+sq_status_t sq_enqueue(slab_queue_t *q, const void *data, size_t len)
+{
+    if (len > q->slot_size)
+    {
+        return SQ_TOO_BIG;
+    }
+
+    // Take a free block, then fill it.
+    int b = sq_alloc(q);
+    if (b < 0)
+    {
+        return SQ_FULL;
+    }
+    memcpy(sq_block(q, b), data, len);
+
+    sq_status_t status = sq_enqueue_block(q, b, len);
+    sq_release(q, b);  // The ring holds the only reference now.
+    return status;
+}
+
+
+size_t sq_dequeue(slab_queue_t *q, void *data, size_t maxlen)
+{
+    // Dequeue
+    if (q->len == 0)
+    {
+        return 0;
+    }
+    uint8_t b = q->ring[q->tail];
+    q->tail = (q->tail + 1 == q->slot_count)? 0 : q->tail + 1;
+    q->len--;
+
+    // Transfer data and drop the ring's reference.
+    size_t len = (q->lens[b] < maxlen)? q->lens[b] : maxlen;
+    if (data != NULL) {  // On NULL, no copying
+        memcpy(data, sq_block(q, b), len);
+    }
+    sq_release(q, b);
+
+    return len;
+}
+
+
+size_t sq_peek(slab_queue_t *q, const void **data)
+{
+    if (q->len == 0)
+    {
+        *data = NULL;
+        return 0;
+    }
+
+    uint8_t b = q->ring[q->tail];
+    *data = sq_block(q, b);
+    return q->lens[b];
+}
+
+
+size_t sq_length(slab_queue_t *q)
+{
+    return q->len;
+}
+
+
+size_t sq_available(slab_queue_t *q)
+{
+    return q->free_top;
+}
+
+
+int sq_alloc(slab_queue_t *q)
+{
+    if (q->free_top == 0)
+    {
+        return -1;
+    }
+
+    uint8_t b = q->free_list[--q->free_top];
+    q->lens[b] = 0;
+    q->refs[b] = 1;
+    return b;
+}
+
+
+uint8_t *sq_block(slab_queue_t *q, uint8_t b)
+{
+    return &q->blocks[SQ_ALIGN(q->slot_size) * b];
+}
+
+
+sq_status_t sq_enqueue_block(slab_queue_t *q, uint8_t b, size_t len)
+{
+    if (len > q->slot_size)
+    {
+        return SQ_TOO_BIG;
+    }
+    if (q->len == q->slot_count)
+    {
+        return SQ_FULL;
+    }
+
+    q->lens[b] = len;
+    q->refs[b]++;
+
+    // Enqueue
+    q->ring[q->head] = b;
+    q->head = (q->head + 1 == q->slot_count)? 0 : q->head + 1;
+    q->len++;
+
+    return SQ_OK;
+}
+
+
+void sq_release(slab_queue_t *q, uint8_t b)
+{
+    if (q->refs[b] > 0  &&  --q->refs[b] == 0)
+    {
+        q->free_list[q->free_top++] = b;
+    }
+}
+
+
+void sq_retain(slab_queue_t *q, uint8_t b)
+{
+    q->refs[b]++;
+}
+
+
+int sq_item(slab_queue_t *q, uint8_t index)
+{
+    if (index >= q->len)  // No item or out-of-scope
+        return -1;
+
+    uint16_t pos = q->tail + index;
+    if (pos >= q->slot_count) pos -= q->slot_count;
+    return q->ring[pos];
+}
+
+
+sq_status_t sq_set_length(slab_queue_t *q, uint8_t b, size_t len)
+{
+    if (len > q->slot_size)
+    {
+        return SQ_TOO_BIG;
+    }
+    q->lens[b] = len;
+    return SQ_OK;
+}
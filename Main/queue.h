@@ -28,4 +28,62 @@ extern size_t       q_length(queue_t *q);
 extern linklist_t  *q_item(queue_t *q, uint8_t index);
 
 
+/**
+ * @brief Slab-backed ring queue
+ *
+ * A fixed number of fixed-size blocks are carved out of a caller-provided storage (the slab).
+ * The ring keeps block indices in FIFO order, and a free-list stack keeps the unused ones.
+ * Every operation is O(1) and never touches the heap.
+ *
+ * Blocks are reference-counted, so the slab also serves as a packet pool:
+ *     sq_alloc() a block, fill it in place, sq_enqueue_block() it without copying, then sq_release() it.
+ */
+#define SQ_MAX_SLOTS 255
+#define SQ_ALIGN(n) (((n) + 3) & ~((size_t)3))
+#define SQ_STORAGE_SIZE(slot_size, slot_count)  \
+    (SQ_ALIGN((slot_size)) * (slot_count)       /* blocks */        \
+    + SQ_ALIGN(sizeof(uint16_t) * (slot_count)) /* lengths */       \
+    + SQ_ALIGN((slot_count))                    /* references */    \
+    + SQ_ALIGN((slot_count))                    /* ring */          \
+    + SQ_ALIGN((slot_count)))                   /* free-list */
+
+typedef enum
+{
+    SQ_OK = 0,
+    SQ_EMPTY,
+    SQ_FULL,
+    SQ_TOO_BIG,
+} sq_status_t;
+
+typedef struct
+{
+    uint8_t  *blocks;     // slot_count blocks of slot_size bytes
+    uint16_t *lens;       // Data length of each block
+    uint8_t  *refs;       // Reference count of each block
+    uint8_t  *ring;       // Block indices in FIFO order
+    uint8_t  *free_list;  // Stack of unused block indices
+    uint16_t slot_size;
+    uint8_t  slot_count;
+    uint8_t  head;        // Next ring position to be written.
+    uint8_t  tail;        // Ring position of the first data in queue.
+    uint8_t  len;
+    uint8_t  free_top;
+} slab_queue_t;
+
+extern void         sq_init(slab_queue_t *q, void *storage, size_t slot_size, size_t slot_count);
+extern sq_status_t  sq_enqueue(slab_queue_t *q, const void *data, size_t len);
+extern size_t       sq_dequeue(slab_queue_t *q, void *data, size_t maxlen);
+extern size_t       sq_peek(slab_queue_t *q, const void **data);
+extern size_t       sq_length(slab_queue_t *q);
+extern size_t       sq_available(slab_queue_t *q);
+
+extern int          sq_alloc(slab_queue_t *q);
+extern uint8_t     *sq_block(slab_queue_t *q, uint8_t b);
+extern sq_status_t  sq_enqueue_block(slab_queue_t *q, uint8_t b, size_t len);
+extern void         sq_release(slab_queue_t *q, uint8_t b);
+extern void         sq_retain(slab_queue_t *q, uint8_t b);  // Keep a block past its dequeue, until sq_release()
+extern int          sq_item(slab_queue_t *q, uint8_t index);  // Block of the index-th queued data, for in-place update
+extern sq_status_t  sq_set_length(slab_queue_t *q, uint8_t b, size_t len);
+
+
 #endif  // __QUEUE_H__
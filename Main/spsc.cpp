@@ -0,0 +1,122 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * SPSC ring between the uplink and the downlink tasks.
+ *
+ * The index a side owns is read relaxed; the other side's is read with acquire, and an index is
+ *     published with release after the record it covers is written, or read out.
+ * One byte is always left unused, so head == tail means empty.
+ */
+#include "spsc.h"
+
+
+#define LOAD_ACQUIRE(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+
+void spsc_init(spsc_ring_t *r, void *storage, size_t size) {
+    r->buf = (uint8_t *)storage;
+    r->size = size;
+    r->head = 0;
+    r->tail = 0;
+    r->drops = 0;
+}
+
+
+static inline void spsc_write_record(spsc_ring_t *r, size_t at, const void *head, size_t head_len,
+                                     const void *body, size_t body_len, const void *tail, size_t tail_len) {
+    uint16_t len = head_len + body_len + tail_len;
+    uint8_t *p = &r->buf[at + SPSC_RECORD_HEADER];
+    memcpy(&r->buf[at], &len, SPSC_RECORD_HEADER);
+    if (head_len > 0) memcpy(p, head, head_len);
+    if (body_len > 0) memcpy(&p[head_len], body, body_len);
+    if (tail_len > 0) memcpy(&p[head_len + body_len], tail, tail_len);
+}
+
+
+/**
+ * @brief One record of 'head' + 'body' + 'tail'
+ *
+ * @return false, and counted as a drop, if it does not fit
+ */
+bool spsc_push(spsc_ring_t *r, const void *head, size_t head_len, const void *body, size_t body_len,
+               const void *tail, size_t tail_len) {
+    size_t len = head_len + body_len + tail_len;
+    size_t total = SPSC_RECORD_HEADER + len;
+    size_t h = r->head;
+    size_t t = LOAD_ACQUIRE(&r->tail);
+
+    if (len == 0  ||  len >= SPSC_WRAP) {
+        r->drops++;
+        return false;
+    }
+
+    if (h >= t) {
+        if (r->size - h >= total + ((t == 0)? 1 : 0)) {  // At the end
+            spsc_write_record(r, h, head, head_len, body, body_len, tail, tail_len);
+            h += total;
+            if (h == r->size) h = 0;
+        }
+        else if (t > total) {  // From the start
+            if (r->size - h >= SPSC_RECORD_HEADER) {
+                uint16_t wrap = SPSC_WRAP;
+                memcpy(&r->buf[h], &wrap, SPSC_RECORD_HEADER);
+            }
+            spsc_write_record(r, 0, head, head_len, body, body_len, tail, tail_len);
+            h = total;
+        }
+        else {
+            r->drops++;
+            return false;
+        }
+    }
+    else if (t - h > total) {
+        spsc_write_record(r, h, head, head_len, body, body_len, tail, tail_len);
+        h += total;
+    }
+    else {
+        r->drops++;
+        return false;
+    }
+
+    STORE_RELEASE(&r->head, h);
+    return true;
+}
+
+
+/**
+ * @return Length of the oldest record, pointed by 'data' in the ring; 0 when empty
+ */
+size_t spsc_peek(spsc_ring_t *r, const uint8_t **data) {
+    size_t t = r->tail;
+    size_t h = LOAD_ACQUIRE(&r->head);
+    if (t == h) return 0;
+
+    uint16_t len = SPSC_WRAP;
+    if (r->size - t >= SPSC_RECORD_HEADER) memcpy(&len, &r->buf[t], SPSC_RECORD_HEADER);
+    if (len == SPSC_WRAP) {  // The producer went on from the start.
+        t = 0;
+        STORE_RELEASE(&r->tail, t);
+        if (t == h) return 0;
+        memcpy(&len, &r->buf[t], SPSC_RECORD_HEADER);
+    }
+
+    *data = &r->buf[t + SPSC_RECORD_HEADER];
+    return len;
+}
+
+
+void spsc_pop(spsc_ring_t *r) {
+    const uint8_t *data;
+    size_t len = spsc_peek(r, &data);
+    if (len == 0) return;
+
+    size_t t = (data - r->buf) + len;
+    if (t == r->size) t = 0;
+    STORE_RELEASE(&r->tail, t);
+}
+
+
+bool spsc_empty(spsc_ring_t *r) {
+    return r->tail == LOAD_ACQUIRE(&r->head);
+}
@@ -0,0 +1,35 @@
+#ifndef __SPSC_H__
+#define __SPSC_H__
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+
+/**
+ * @brief Lock-free single-producer single-consumer ring of variable-length records
+ *
+ * One task pushes, another peeks & pops; 'head' is written by the producer only, 'tail' by the consumer only.
+ * A record is kept contiguous, so the consumer reads it in place.
+ */
+#define SPSC_RECORD_HEADER  2
+#define SPSC_WRAP           0xFFFF  // Record length: the rest of the ring is unused, go on from the start.
+
+typedef struct {
+    uint8_t *buf;
+    size_t   size;
+    size_t   head;   // Producer
+    size_t   tail;   // Consumer
+    uint32_t drops;  // Producer, records that did not fit
+} spsc_ring_t;
+
+extern void   spsc_init(spsc_ring_t *r, void *storage, size_t size);
+extern bool   spsc_push(spsc_ring_t *r, const void *head, size_t head_len, const void *body = NULL, size_t body_len = 0,
+                        const void *tail = NULL, size_t tail_len = 0);
+extern size_t spsc_peek(spsc_ring_t *r, const uint8_t **data);  // 0: empty
+extern void   spsc_pop(spsc_ring_t *r);
+extern bool   spsc_empty(spsc_ring_t *r);
+
+
+#endif  // __SPSC_H__
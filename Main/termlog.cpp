@@ -0,0 +1,125 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Asynchronous terminal log.
+ *
+ * Bounded MPMC ring after D. Vyukov, used with a single consumer: every slot carries a turn 'seq'.
+ *     A producer claims position 'pos' by CAS on 'head' when the slot's seq == pos, fills it,
+ *     then publishes seq = pos + 1. The consumer takes it when seq == pos + 1, and hands it back
+ *     to the next lap with seq = pos + TERMLOG_SLOTS.
+ */
+#include <Arduino.h>
+#include "helper.h"
+#include "termlog.h"
+
+
+#define LOAD_ACQUIRE(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+static termlog_record_t termlog_slots[TERMLOG_SLOTS];
+static uint32_t termlog_head = 0;  // Producers
+static uint32_t termlog_tail = 0;  // Consumer
+static termlog_stat_t termlog_counts = {};
+static bool termlog_ready = false;
+
+
+static void termlog_init() {
+    for (uint32_t i = 0; i < TERMLOG_SLOTS; i++) {
+        termlog_slots[i].seq = i;
+    }
+    termlog_head = 0;
+    termlog_tail = 0;
+    termlog_ready = true;
+}
+
+
+bool termlog_post(const char *fmt, const uintptr_t *args, uint8_t nargs,
+                  const void *head, size_t head_len, const void *body, size_t body_len) {
+    if (!termlog_ready) return false;
+
+    // Claim a slot
+    termlog_record_t *r;
+    uint32_t pos = __atomic_load_n(&termlog_head, __ATOMIC_RELAXED);
+    for (;;) {
+        r = &termlog_slots[pos & (TERMLOG_SLOTS - 1)];
+        int32_t diff = (int32_t)(LOAD_ACQUIRE(&r->seq) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&termlog_head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        }
+        else if (diff < 0) {  // A lap behind, full
+            __atomic_add_fetch(&termlog_counts.dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        else {
+            pos = __atomic_load_n(&termlog_head, __ATOMIC_RELAXED);
+        }
+    }
+
+    // Fill
+    r->fmt = fmt;
+    r->nargs = (nargs <= TERMLOG_MAX_ARGS)? nargs : TERMLOG_MAX_ARGS;
+    memcpy(r->args, args, r->nargs * sizeof(uintptr_t));
+
+    size_t n = (head_len < TERMLOG_MAX_HEX)? head_len : TERMLOG_MAX_HEX;
+    if (n > 0) memcpy(r->hex, head, n);
+    size_t m = (body_len < TERMLOG_MAX_HEX - n)? body_len : TERMLOG_MAX_HEX - n;
+    if (m > 0) memcpy(&r->hex[n], body, m);
+    r->hex_len = n + m;
+    r->hex_more = head_len + body_len - r->hex_len;
+
+    STORE_RELEASE(&r->seq, pos + 1);
+    __atomic_add_fetch(&termlog_counts.posted, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+
+bool termlog_flush_one() {
+    uint32_t pos = termlog_tail;
+    termlog_record_t *r = &termlog_slots[pos & (TERMLOG_SLOTS - 1)];
+    if (LOAD_ACQUIRE(&r->seq) != pos + 1) return false;
+
+    const uintptr_t *a = r->args;  // Unused ones are ignored by the format.
+    char line[TERMLOG_LINE_SIZE];
+    int len = snprintf(line, sizeof(line), r->fmt, a[0], a[1], a[2], a[3], a[4], a[5]);
+    if (len < 0) len = 0;
+    if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+
+    bool dump = (r->hex_len > 0  ||  r->hex_more > 0);
+    for (uint8_t i = 0; i < r->hex_len  &&  len < (int)sizeof(line) - 4; i++) {
+        len += snprintf(&line[len], sizeof(line) - len, "%x ", r->hex[i]);
+    }
+    if (r->hex_more > 0  &&  len < (int)sizeof(line) - 8) {
+        len += snprintf(&line[len], sizeof(line) - len, "+%u", r->hex_more);
+    }
+
+    STORE_RELEASE(&r->seq, pos + TERMLOG_SLOTS);  // Slot free, formatted out of it already
+    termlog_tail = pos + 1;
+
+    term_print(line);
+    if (dump) term_print(ENDL);
+    termlog_counts.written++;
+    return true;
+}
+
+
+termlog_stat_t termlog_stat() {
+    termlog_stat_t s;
+    s.posted = __atomic_load_n(&termlog_counts.posted, __ATOMIC_RELAXED);
+    s.dropped = __atomic_load_n(&termlog_counts.dropped, __ATOMIC_RELAXED);
+    s.written = termlog_counts.written;
+    return s;
+}
+
+
+static void termlog_task(void *) {
+    for (;;) {
+        while (termlog_flush_one());
+        vTaskDelay(pdMS_TO_TICKS(TERMLOG_FLUSH_MS));
+    }
+}
+
+void termlog_setup() {
+    termlog_init();
+    xTaskCreatePinnedToCore(termlog_task, "termlog", TERMLOG_TASK_STACK_SIZE, NULL,
+                            TERMLOG_TASK_PRIORITY, NULL, TERMLOG_TASK_CORE);
+}
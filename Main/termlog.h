@@ -0,0 +1,81 @@
+#ifndef __TERMLOG_H__
+#define __TERMLOG_H__
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
+
+
+/**
+ * @brief Asynchronous terminal log, for the radio tasks
+ *
+ * Posting copies the format pointer, a few argument words and an optional hex dump into a slot of a
+ *     multi-producer lock-free ring; nothing is formatted, nothing waits for the console.
+ * A low-priority task formats the records and writes them out. A full ring drops the record, counted.
+ *
+ * Arguments are words: integers, and pointers to strings that live forever, e.g. literals or
+ *     ResponseStatus::descStr(). No floating point.
+ */
+#define TERMLOG_SLOTS       64   // Power of 2
+#define TERMLOG_MAX_ARGS    6
+#define TERMLOG_MAX_HEX     48   // Bytes of a dump kept, the rest is only counted
+#define TERMLOG_LINE_SIZE   255  // As of SIZE_DEBUG_BUF
+#define TERMLOG_FLUSH_MS    10
+#define TERMLOG_TASK_CORE   1    // With loop(), away from the radio tasks
+#define TERMLOG_TASK_PRIORITY   1
+#define TERMLOG_TASK_STACK_SIZE 4096
+
+typedef struct {
+    uint32_t  seq;       // Slot turn, see termlog.cpp
+    const char *fmt;
+    uint8_t   nargs;
+    uint8_t   hex_len;
+    uint16_t  hex_more;  // Bytes of the dump not kept
+    uintptr_t args[TERMLOG_MAX_ARGS];
+    uint8_t   hex[TERMLOG_MAX_HEX];
+} termlog_record_t;
+
+typedef struct {
+    uint32_t posted;
+    uint32_t dropped;  // Ring full
+    uint32_t written;
+} termlog_stat_t;
+
+extern void termlog_setup();
+extern bool termlog_post(const char *fmt, const uintptr_t *args, uint8_t nargs,
+                         const void *head = NULL, size_t head_len = 0, const void *body = NULL, size_t body_len = 0);
+extern bool termlog_flush_one();  // Format & write the oldest record; false if none
+extern termlog_stat_t termlog_stat();
+
+
+template <typename T>
+static inline uintptr_t termlog_word(T v) {
+    static_assert(std::is_integral<T>::value  ||  std::is_enum<T>::value  ||  std::is_pointer<T>::value,
+                  "termlog: integers & static strings only");
+    return (uintptr_t)v;
+}
+
+/**
+ * @brief Like term_printf(), but posted to the ring.
+ */
+template <typename... A>
+static inline bool termlog_printf(const char *fmt, A... args) {
+    static_assert(sizeof...(A) <= TERMLOG_MAX_ARGS, "termlog: too many arguments");
+    const uintptr_t words[] = {termlog_word(args)..., 0};
+    return termlog_post(fmt, words, sizeof...(A));
+}
+
+/**
+ * @brief As termlog_printf(), followed by a hex dump of 'head' + 'body', and a new line
+ */
+template <typename... A>
+static inline bool termlog_hex(const void *head, size_t head_len, const void *body, size_t body_len,
+                               const char *fmt, A... args) {
+    static_assert(sizeof...(A) <= TERMLOG_MAX_ARGS, "termlog: too many arguments");
+    const uintptr_t words[] = {termlog_word(args)..., 0};
+    return termlog_post(fmt, words, sizeof...(A), head, head_len, body, body_len);
+}
+
+
+#endif  // __TERMLOG_H__
@@ -0,0 +1,141 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Host simulation of the reliable mode: two ends of Main/arq.cpp over a lossy channel,
+ *     40 ms one way, one frame on air at a time each way; on a virtual millisecond clock.
+ * Data goes A to B; B answers with ACK-only frames, as it has nothing to send back.
+ * Checks that what B delivers is in order with no duplicate, for a range of loss rates.
+ *
+ * $ g++ -O2 -I../Main bench_arq.cpp ../Main/arq.cpp -o bench_arq && ./bench_arq
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+
+#include "arq.h"
+
+
+#define MESSAGES        500
+#define DELAY_MS        40    // One way
+#define AIR_MS          5     // A frame on air, so a direction sends no more than one at a time
+#define PAYLOAD_LEN     32
+#define RUN_MAX_MS      600000
+
+typedef struct {
+    uint32_t at_ms;  // Arrival
+    uint16_t len;
+    uint8_t  data[ARQ_HEADER_LEN + PAYLOAD_LEN];
+} frame_t;
+
+typedef struct {
+    std::deque<frame_t> air;
+    uint32_t free_ms;  // Next time a frame may go on air
+    double   loss;
+    uint32_t sent;
+    uint32_t lost;
+} channel_t;
+
+
+static double rand01() {
+    return (double)rand() / RAND_MAX;
+}
+
+static bool channel_send(channel_t *c, const uint8_t *hdr, const uint8_t *payload, size_t len, uint32_t now) {
+    if ((int32_t)(now - c->free_ms) < 0) return false;
+    c->free_ms = now + AIR_MS;
+    c->sent++;
+    if (rand01() < c->loss) {
+        c->lost++;
+        return true;  // Gone, as far as the sender can tell
+    }
+
+    frame_t f;
+    f.at_ms = now + AIR_MS + DELAY_MS;
+    f.len = ARQ_HEADER_LEN + len;
+    memcpy(f.data, hdr, ARQ_HEADER_LEN);
+    memcpy(&f.data[ARQ_HEADER_LEN], payload, len);
+    c->air.push_back(f);
+    return true;
+}
+
+static void payload_of(int index, uint8_t *payload) {
+    memset(payload, 0, PAYLOAD_LEN);
+    memcpy(payload, &index, sizeof(index));
+}
+
+
+static void run(double loss) {
+    arq_t a, b;
+    arq_init(&a);
+    arq_init(&b);
+    channel_t ab = {}, ba = {};
+    ab.loss = ba.loss = loss;
+
+    uint8_t hdr[ARQ_HEADER_LEN], payload[PAYLOAD_LEN];
+    int next_msg = 0, last_delivered = -1, done = 0;
+    uint32_t delivered = 0, out_of_order = 0, now = 0;
+
+    for (; now < RUN_MAX_MS; now++) {
+        // A: retransmissions first, then new messages
+        uint8_t seq;
+        int handle = arq_due(&a, now, &seq);
+        if (handle >= 0) {
+            payload_of(handle, payload);
+            arq_header(&a, hdr, true, seq);
+            if (channel_send(&ab, hdr, payload, PAYLOAD_LEN, now)) arq_resent(&a, seq, now);
+        }
+        else if (next_msg < MESSAGES  &&  arq_can_send(&a)  &&  (int32_t)(now - ab.free_ms) >= 0) {
+            payload_of(next_msg, payload);
+            seq = arq_sent(&a, next_msg, PAYLOAD_LEN, now);
+            arq_header(&a, hdr, true, seq);
+            channel_send(&ab, hdr, payload, PAYLOAD_LEN, now);
+            next_msg++;
+        }
+        while (arq_pop_done(&a) >= 0) done++;  // Acked or given up
+
+        // B: deliver in order, ACK when due
+        while (!ab.air.empty()  &&  (int32_t)(now - ab.air.front().at_ms) >= 0) {
+            const frame_t &f = ab.air.front();
+            const uint8_t *p;
+            size_t len;
+            arq_rx_begin(&b, f.data, f.len, now);
+            while (arq_rx_next(&b, &p, &len)) {
+                int index;
+                memcpy(&index, p, sizeof(index));
+                if (index <= last_delivered) out_of_order++;
+                last_delivered = index;
+                delivered++;
+            }
+            ab.air.pop_front();
+        }
+        if (arq_ack_due(&b, now)) {
+            arq_header(&b, hdr, false, 0);
+            if (!channel_send(&ba, hdr, NULL, 0, now)) b.ack_pending = true;  // On air already; the next ms
+        }
+
+        // A: ACKs
+        while (!ba.air.empty()  &&  (int32_t)(now - ba.air.front().at_ms) >= 0) {
+            const frame_t &f = ba.air.front();
+            arq_rx_begin(&a, f.data, f.len, now);
+            ba.air.pop_front();
+        }
+
+        if (done == MESSAGES) break;
+    }
+
+    printf("loss %3.0f%% : delivered %3u/%d out_of_order %u skipped %u gave_up %u retransmits %4u"
+           " acks %4u srtt %ums rto %ums time %.1fs\n",
+        loss * 100, delivered, MESSAGES, out_of_order, b.stat.skipped, a.stat.gave_up, a.stat.retransmits,
+        b.stat.acks_sent, a.srtt_ms, a.rto_ms, now / 1000.0);
+}
+
+
+int main() {
+    srand(1);
+    const double losses[] = {0.0, 0.1, 0.2, 0.3, 0.5};
+    for (size_t i = 0; i < sizeof(losses) / sizeof(losses[0]); i++) {
+        run(losses[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Host benchmark & cross-check of the CRC-16/MCRF4XX kernels in Main/crc16.cpp.
+ *
+ * Every kernel must match the bit-by-bit reference on random data of random lengths and offsets,
+ *     fed whole and in random pieces, as a streaming parser would.
+ *
+ * $ g++ -O2 -I../Main bench_crc.cpp ../Main/crc16.cpp -o bench_crc && ./bench_crc
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "crc16.h"
+
+
+#define BUF_SIZE    4096
+#define TRIALS      20000
+#define BENCH_LEN   263  // A full MAVLink v2 frame under CRC
+#define ROUNDS      200000
+
+typedef uint16_t (*crc16_fn_t)(const void *, size_t, uint16_t);
+
+static const struct {
+    const char *name;
+    crc16_fn_t fn;
+} kernels[] = {
+    {"bitwise ", crc16_bitwise},
+    {"bytewise", crc16_bytewise},
+    {"slice4  ", crc16_slice4},
+    {"slice8  ", crc16_slice8},
+    {"update  ", crc16_update},
+};
+#define KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+
+static double now_sec() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+int main() {
+    std::vector<uint8_t> buf(BUF_SIZE);
+    srand(1);
+    for (auto &b : buf) b = rand();
+
+    // Check value & the zero residue
+    size_t bad = 0;
+    for (size_t k = 0; k < KERNELS; k++) {
+        if (kernels[k].fn("123456789", 9, CRC16_INIT) != CRC16_CHECK) {
+            fprintf(stderr, "%s: check value mismatched\n", kernels[k].name);
+            bad++;
+        }
+    }
+    uint16_t crc = crc16_update(buf.data(), 100, CRC16_INIT);
+    uint8_t trailer[] = {(uint8_t)crc, (uint8_t)(crc >> 8)};
+    if (crc16_update(trailer, 2, crc) != 0) {
+        fprintf(stderr, "residue is not zero\n");
+        bad++;
+    }
+
+    // Random cross-check, whole & in pieces
+    for (int n = 0; n < TRIALS; n++) {
+        size_t off = rand() % 64, len = rand() % (BUF_SIZE - 64);
+        uint16_t init = (n & 1)? CRC16_INIT : rand();
+        uint16_t ref = crc16_bitwise(&buf[off], len, init);
+
+        for (size_t k = 1; k < KERNELS; k++) {
+            uint16_t whole = kernels[k].fn(&buf[off], len, init);
+            uint16_t piece = init;
+            for (size_t i = 0; i < len; ) {
+                size_t m = 1 + rand() % 37;
+                if (i + m > len) m = len - i;
+                piece = kernels[k].fn(&buf[off + i], m, piece);
+                i += m;
+            }
+            uint16_t bytes = init;
+            for (size_t i = 0; i < len; i++) bytes = crc16_accumulate(buf[off + i], bytes);
+
+            if (whole != ref  ||  piece != ref  ||  bytes != ref) {
+                if (bad == 0) fprintf(stderr, "%s: mismatched at trial %d, len %zu\n", kernels[k].name, n, len);
+                bad++;
+            }
+        }
+    }
+    printf("check    : %d random buffers, %zu mismatched\n", TRIALS, bad);
+
+    // Speed
+    for (size_t k = 0; k < KERNELS; k++) {
+        int rounds = (k == 0)? ROUNDS / 10 : ROUNDS;
+        volatile uint16_t sink = 0;
+        double t = now_sec();
+        for (int r = 0; r < rounds; r++) {
+            sink = sink ^ kernels[k].fn(&buf[r & 63], BENCH_LEN, CRC16_INIT);
+        }
+        t = now_sec() - t;
+        printf("%s : %7.1f MB/s\n", kernels[k].name, (double)BENCH_LEN * rounds / t / 1e6);
+    }
+
+    return (bad == 0)? 0 : 1;
+}
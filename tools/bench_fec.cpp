@@ -0,0 +1,102 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Host benchmark & erasure check of the Reed-Solomon code in Main/fec.cpp.
+ *
+ * Groups of k data fragments get p parity fragments; up to p random fragments, data or parity, are erased,
+ *     and the data must be rebuilt byte-exact from the rest.
+ *
+ * $ g++ -O2 -I../Main bench_fec.cpp ../Main/fec.cpp -o bench_fec && ./bench_fec
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "fec.h"
+
+
+#define FRAG_LEN    211  // Of a raw-mode fragment, framed, with the FEC header
+#define TRIALS      20000
+#define ROUNDS      2000
+
+typedef std::vector<uint8_t> bytes_t;
+
+
+static double now_sec() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+int main() {
+    fec_init();
+    srand(1);
+
+    // Correctness, random groups & erasures
+    size_t bad = 0, rebuilt = 0;
+    for (int n = 0; n < TRIALS; n++) {
+        uint8_t k = 1 + rand() % 12;
+        uint8_t p = 1 + rand() % FEC_MAX_PARITY;
+
+        std::vector<bytes_t> data(k, bytes_t(FRAG_LEN)), parity(p, bytes_t(FRAG_LEN));
+        for (auto &d : data) for (auto &b : d) b = rand();
+        std::vector<const uint8_t *> dp;
+        for (auto &d : data) dp.push_back(d.data());
+        for (uint8_t j = 0; j < p; j++) fec_encode(dp.data(), k, FRAG_LEN, j, parity[j].data());
+
+        // Erase up to p of the k + p fragments.
+        std::vector<bool> lost(k + p, false);
+        for (int e = rand() % (p + 1); e > 0; e--) lost[rand() % (k + p)] = true;
+
+        std::vector<bytes_t> got = data;
+        std::vector<uint8_t *> gp;
+        uint16_t present = 0;
+        for (uint8_t i = 0; i < k; i++) {
+            gp.push_back(got[i].data());
+            if (lost[i]) memset(got[i].data(), 0xEE, FRAG_LEN);
+            else present |= 1 << i;
+        }
+        std::vector<const uint8_t *> pp;
+        std::vector<uint8_t> rows;
+        for (uint8_t j = 0; j < p; j++) {
+            if (!lost[k + j]) { pp.push_back(parity[j].data()); rows.push_back(j); }
+        }
+
+        if (!fec_decode(gp.data(), present, k, pp.data(), rows.data(), pp.size(), FRAG_LEN)  ||  got != data) {
+            if (bad == 0) fprintf(stderr, "first failure at trial %d: k %u p %u\n", n, k, p);
+            bad++;
+        }
+        else if (present != (1 << k) - 1) {
+            rebuilt++;
+        }
+    }
+    printf("erasures : %d groups, %zu rebuilt, %zu failed\n", TRIALS, rebuilt, bad);
+
+    // Speed, a group of 3 data + 2 parity, e.g. a 600-byte message at 2/3
+    const uint8_t k = 3, p = 2;
+    std::vector<bytes_t> data(k, bytes_t(FRAG_LEN)), parity(p, bytes_t(FRAG_LEN));
+    for (auto &d : data) for (auto &b : d) b = rand();
+    std::vector<const uint8_t *> dp;
+    for (auto &d : data) dp.push_back(d.data());
+
+    double t = now_sec();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (uint8_t j = 0; j < p; j++) fec_encode(dp.data(), k, FRAG_LEN, j, parity[j].data());
+    }
+    t = now_sec() - t;
+    printf("encode   : k %u p %u, %.1f MB/s of data\n", k, p, (double)k * FRAG_LEN * ROUNDS / t / 1e6);
+
+    std::vector<uint8_t *> gp;
+    for (auto &d : data) gp.push_back(d.data());
+    const uint8_t *pp[] = {parity[0].data(), parity[1].data()};
+    const uint8_t rows[] = {0, 1};
+    t = now_sec();
+    for (int r = 0; r < ROUNDS; r++) {
+        fec_decode(gp.data(), 0x1, k, pp, rows, p, FRAG_LEN);  // Two of three lost
+    }
+    t = now_sec() - t;
+    printf("decode   : k %u, 2 lost, %.1f MB/s of data\n", k, (double)k * FRAG_LEN * ROUNDS / t / 1e6);
+
+    return (bad == 0)? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Host benchmark & corpus check of the streaming MAVLink parser in Main/mavlink.cpp.
+ *
+ * The corpus mixes v1, v2 and signed v2 frames, frames of unknown msgid, corrupted frames and
+ *     garbage with false STX bytes; it is fed in random blocks of 1..220 bytes, like radio packets.
+ * Every good frame must come out byte-exact, and nothing else.
+ *
+ * $ g++ -O2 -I../Main bench_mavlink.cpp ../Main/mavlink.cpp ../Main/crc16.cpp -o bench_mavlink && ./bench_mavlink
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "mavlink.h"
+
+
+#define FRAME_COUNT 20000
+#define BLOCK_MAX   220  // EBYTE_MODULE_BUFFER_SIZE
+#define ROUNDS      50
+
+static const uint32_t known_ids[] = {0, 1, 24, 30, 33, 74, 76, 77, 109, 147, 253};
+
+typedef std::vector<uint8_t> bytes_t;
+
+
+static uint16_t crc_x25(const uint8_t *p, size_t n, uint16_t crc = 0xFFFF) {
+    while (n--) {
+        uint8_t tmp = *p++ ^ (uint8_t)(crc & 0xFF);
+        tmp ^= (tmp << 4);
+        crc = (crc >> 8) ^ ((uint16_t)tmp << 8) ^ ((uint16_t)tmp << 3) ^ (tmp >> 4);
+    }
+    return crc;
+}
+
+static bytes_t make_frame(bool v2, bool sign, uint32_t msgid, uint8_t len, uint8_t seq) {
+    bytes_t f;
+    if (v2) {
+        f = {MAVLINK_STX_V2, len, (uint8_t)(sign? MAVLINK_IFLAG_SIGNED : 0), 0, seq, 1, 1,
+             (uint8_t)msgid, (uint8_t)(msgid >> 8), (uint8_t)(msgid >> 16)};
+    } else {
+        f = {MAVLINK_STX_V1, len, seq, 1, 1, (uint8_t)msgid};
+    }
+    for (int i = 0; i < len; i++) f.push_back(rand());
+
+    uint16_t crc = crc_x25(&f[1], f.size() - 1);
+    int extra = mavlink_crc_extra(msgid);
+    uint8_t e = (extra >= 0)? extra : rand();
+    crc = crc_x25(&e, 1, crc);
+    f.push_back(crc & 0xFF);
+    f.push_back(crc >> 8);
+
+    if (sign) for (int i = 0; i < MAVLINK_SIGNATURE_LEN; i++) f.push_back(rand());
+    return f;
+}
+
+static double now_sec() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+int main() {
+    bytes_t stream;
+    std::vector<bytes_t> expected;
+    bool synced = false;
+    srand(1);
+
+    for (int n = 0; n < FRAME_COUNT; n++) {
+        int kind = rand() % 100;
+        bool v2 = rand() % 4;
+        uint32_t msgid = known_ids[rand() % (sizeof(known_ids) / sizeof(known_ids[0]))];
+        bytes_t f;
+
+        if (kind < 3) {  // Garbage, full of false STX
+            for (int i = rand() % 40; i > 0; i--) stream.push_back((rand() % 3)? rand() : MAVLINK_STX_V2);
+            synced = false;
+            continue;
+        }
+        else if (kind < 6) {  // Corrupted payload; a corrupted msgid may turn unknown, thus unverifiable.
+            uint8_t len = 10 + rand() % 40;
+            f = make_frame(v2, false, msgid, len, n);
+            f[((v2)? MAVLINK_HEADER_LEN_V2 : MAVLINK_HEADER_LEN_V1) + rand() % len] ^= 0x5A;
+            stream.insert(stream.end(), f.begin(), f.end());
+            synced = false;
+            continue;
+        }
+        else if (kind < 10) {  // Unknown msgid, only passes in sync
+            f = make_frame(true, false, 42000 + rand() % 100, rand() % 60, n);
+            if (synced) expected.push_back(f);
+        }
+        else {
+            f = make_frame(v2, v2 && (rand() % 5 == 0), msgid, (v2)? rand() % 256 : 1 + rand() % 60, n);
+            expected.push_back(f);
+            synced = true;
+        }
+        stream.insert(stream.end(), f.begin(), f.end());
+    }
+
+    // Random block cuts, the same for every round
+    std::vector<size_t> cuts;
+    for (size_t off = 0; off < stream.size(); ) {
+        size_t n = 1 + rand() % BLOCK_MAX;
+        if (off + n > stream.size()) n = stream.size() - off;
+        cuts.push_back(n);
+        off += n;
+    }
+
+    // Correctness
+    mavlink_parser_t parser;
+    mavlink_parser_init(&parser);
+    size_t got = 0, bad = 0, off = 0;
+    for (size_t n : cuts) {
+        mavlink_frame_t f;
+        mavlink_parse_begin(&parser, &stream[off], n);
+        while (mavlink_parse_next(&parser, &f)) {
+            bytes_t b(f.head, f.head + f.head_len);
+            b.insert(b.end(), f.body, f.body + f.body_len);
+            if (got >= expected.size()  ||  b != expected[got]) {
+                if (bad == 0) fprintf(stderr, "first mismatch at %zu: len %zu exp %zu msgid %u\n", got, b.size(), (got < expected.size())? expected[got].size() : 0, f.msgid);
+                bad++;
+            }
+            got++;
+        }
+        off += n;
+    }
+    printf("corpus   : %zu bytes, %zu good frames, %zu emitted, %zu mismatched\n", stream.size(), expected.size(), got, bad);
+    printf("stat     : frames %u crc_errors %u unknown_msgids %u skipped_bytes %u\n",
+        parser.stat.frames, parser.stat.crc_errors, parser.stat.unknown_msgids, parser.stat.skipped_bytes);
+
+    // Speed
+    double t = now_sec();
+    size_t frames = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        mavlink_parser_init(&parser);
+        off = 0;
+        for (size_t n : cuts) {
+            mavlink_frame_t f;
+            mavlink_parse_begin(&parser, &stream[off], n);
+            while (mavlink_parse_next(&parser, &f)) frames++;
+            off += n;
+        }
+    }
+    t = now_sec() - t;
+    printf("speed    : %.0f frames/s, %.1f MB/s\n", frames / t, stream.size() * ROUNDS / t / 1e6);
+
+    return (got == expected.size()  &&  bad == 0)? 0 : 1;
+}
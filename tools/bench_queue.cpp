@@ -0,0 +1,74 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Host micro-benchmark: malloc-based queue_t vs. slab-backed slab_queue_t,
+ *     on the same fragment pattern as EbyteModule::fragmentMessageQueueTx().
+ *
+ * $ g++ -O2 -I../Main bench_queue.cpp ../Main/queue.cpp -o bench_queue && ./bench_queue
+ */
+#include <stdio.h>
+#include <chrono>
+
+#include "queue.h"
+
+
+#define SLOT_SIZE   220  // EBYTE_MODULE_BUFFER_SIZE
+#define SLOT_COUNT  16   // EBYTE_QUEUE_TX_SLOTS
+#define ROUNDS      2000000
+
+static uint8_t payload[279];  // MAVLink v2 max frame -- 2 fragments
+static uint8_t out[SLOT_SIZE];
+static uint8_t slab[SQ_STORAGE_SIZE(SLOT_SIZE, SLOT_COUNT)];
+
+
+static double now_sec() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t run_queue_t() {
+    queue_t q;
+    size_t sum = 0;
+    q_init(&q);
+    for (int r = 0; r < ROUNDS; r++) {
+        q_enqueue(&q, payload, SLOT_SIZE);
+        q_enqueue(&q, payload + SLOT_SIZE, sizeof(payload) - SLOT_SIZE);
+        sum += q_item(&q, 0)->len;
+        sum += q_dequeue(&q, out, sizeof(out));
+        sum += q_dequeue(&q, out, sizeof(out));
+    }
+    return sum;
+}
+
+static size_t run_slab_queue_t() {
+    slab_queue_t q;
+    size_t sum = 0;
+    const void *p;
+    sq_init(&q, slab, SLOT_SIZE, SLOT_COUNT);
+    for (int r = 0; r < ROUNDS; r++) {
+        sq_enqueue(&q, payload, SLOT_SIZE);
+        sq_enqueue(&q, payload + SLOT_SIZE, sizeof(payload) - SLOT_SIZE);
+        sum += sq_peek(&q, &p);
+        sum += sq_dequeue(&q, out, sizeof(out));
+        sum += sq_dequeue(&q, out, sizeof(out));
+    }
+    return sum;
+}
+
+int main() {
+    for (size_t i = 0; i < sizeof(payload); i++)
+        payload[i] = i;
+
+    double t = now_sec();
+    size_t a = run_queue_t();
+    double t_a = now_sec() - t;
+
+    t = now_sec();
+    size_t b = run_slab_queue_t();
+    double t_b = now_sec() - t;
+
+    printf("queue_t      : %.3fs  %.1f ns/fragment  (chk %zu)\n", t_a, t_a * 1e9 / (ROUNDS * 2), a);
+    printf("slab_queue_t : %.3fs  %.1f ns/fragment  (chk %zu)\n", t_b, t_b * 1e9 / (ROUNDS * 2), b);
+    printf("speed-up     : %.2fx\n", t_a / t_b);
+    return (a == b)? 0 : 1;
+}
@@ -0,0 +1,234 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Software Ebyte module, see ebyte_sim.h.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ebyte_sim.h"
+
+
+// By the bits of Speed, as Main/ebyte_e34.h & Main/ebyte_e28.h
+static const uint32_t e34_uart_bps[8] = {1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200};
+static const uint32_t e34_air_bps[8]  = {250000, 1000000, 2000000, 2000000, 2000000, 2000000, 2000000, 2000000};
+static const uint32_t e28_uart_bps[8] = {1200, 4800, 9600, 19200, 57600, 115200, 460800, 921600};
+static const uint32_t e28_air_bps[8]  = {1000000 /* auto, taken as 1M */, 1000, 5000, 10000, 50000, 100000, 1000000, 2000000};
+
+static const uint8_t e34_version[] = {0xC3, 0x34, 0x10, 0x00};
+static const uint8_t e28_version[] = {0xC3, 0x28, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+
+static inline bool sim_due(uint32_t now, uint32_t t) {
+    return (int32_t)(now - t) >= 0;
+}
+
+static inline double sim_rand() {
+    return (double)rand() / RAND_MAX;
+}
+
+
+uint32_t sim_uart_bps(const sim_module_t *m) {
+    uint8_t code = (m->config[3] >> 3) & 0x7;
+    return (m->model == SIM_E34)? e34_uart_bps[code] : e28_uart_bps[code];
+}
+
+uint32_t sim_air_bps(const sim_module_t *m) {
+    uint8_t code = m->config[3] & 0x7;
+    return (m->model == SIM_E34)? e34_air_bps[code] : e28_air_bps[code];
+}
+
+static uint8_t sim_config_mode(const sim_module_t *m) {  // As EbyteMode::setModeConfig()
+    return (m->model == SIM_E34)? 3 : 3 + 4;
+}
+
+static double sim_byte_us(const sim_module_t *m) {  // 8N1, 10 bits a byte
+    return 1e7 / ((m->mode == sim_config_mode(m))? SIM_SETTING_BPS : sim_uart_bps(m));
+}
+
+
+void sim_init(sim_module_t *m, sim_model_t model, uint8_t aux_pin, const uint8_t *m_pins) {
+    memset(m, 0, sizeof(sim_module_t));
+    m->model = model;
+    m->uart.fd = -1;
+    m->aux_pin = aux_pin;
+    m->m_count = (model == SIM_E34)? 2 : 3;
+    memcpy(m->m_pins, m_pins, m->m_count);
+
+    // Defaults: 115200 8N1, 2Mbps, channel 6, push-pull AUX
+    m->fifo_size = (model == SIM_E34)? 256 : 220;  // E34_FIFO_SIZE, E28_FIFO_SIZE
+    m->packet_max = m->fifo_size;
+    const uint8_t e34_config[SIM_CONFIG_LEN] = {0xC0, 0x00, 0x00, (7 << 3) | 2, 6, 0x40};
+    const uint8_t e28_config[SIM_CONFIG_LEN] = {0xC0, 0x00, 0x00, (5 << 3) | 7, 6, 0x40};
+    memcpy(m->config, (model == SIM_E34)? e34_config : e28_config, SIM_CONFIG_LEN);
+    m->mode = 0xFF;  // Read on the first step
+}
+
+void sim_connect(sim_module_t *a, sim_module_t *b, sim_channel_t *channel) {
+    a->peer = b;
+    b->peer = a;
+    a->channel = channel;
+    b->channel = channel;
+}
+
+
+/**
+ * @brief Bytes the UART has had time to take in, up to 'len'
+ */
+static size_t sim_uart_in(sim_module_t *m, uint8_t *buf, size_t len, uint32_t now) {
+    size_t avail = hal_serial_available(&m->uart);
+    if (avail == 0) return 0;
+
+    double byte_us = sim_byte_us(m);
+    if (now - m->uart_in_us > 2 * byte_us) m->uart_in_us = now - byte_us;  // Line was idle; the first byte is in.
+    size_t n = (size_t)((now - m->uart_in_us) / byte_us);
+    if (n > avail) n = avail;
+    if (n > len) n = len;
+    n = hal_serial_read(&m->uart, buf, n);
+    m->uart_in_us += n * byte_us;
+    return n;
+}
+
+/**
+ * @brief Setting mode: C0/C2 + parameters, C1 C1 C1, C3 C3 C3, C4 C4 C4
+ */
+static void sim_command(sim_module_t *m, uint8_t b) {
+    if (m->cmd_len == 0  &&  (b < 0xC0  ||  b > 0xC4)) return;  // Not a command
+    m->cmd[m->cmd_len++] = b;
+
+    uint8_t head = m->cmd[0];
+    if (head == 0xC0  ||  head == 0xC2) {
+        if (m->cmd_len < SIM_CONFIG_LEN) return;
+        memcpy(&m->config[1], &m->cmd[1], SIM_CONFIG_LEN - 1);
+        m->config[0] = 0xC0;
+        hal_serial_write(&m->uart, m->cmd, SIM_CONFIG_LEN);  // Echoed
+    }
+    else {
+        if (m->cmd_len < 3) return;
+        if (m->cmd[1] == head  &&  m->cmd[2] == head) {
+            if (head == 0xC1) {
+                hal_serial_write(&m->uart, m->config, SIM_CONFIG_LEN);
+            }
+            else if (head == 0xC3) {
+                if (m->model == SIM_E34) hal_serial_write(&m->uart, e34_version, sizeof(e34_version));
+                else hal_serial_write(&m->uart, e28_version, sizeof(e28_version));
+            }
+            else if (head == 0xC4) {
+                m->mode_switch_us = hal_micros();  // Reset, busy as on a mode switch
+            }
+        }
+    }
+    m->stat.commands++;
+    m->cmd_len = 0;
+}
+
+/**
+ * @brief A packet ended on air; to the peer's UART, unless it is lost.
+ */
+static void sim_air_end(sim_module_t *m, uint32_t now) {
+    m->on_air = false;
+    m->stat.packets++;
+    m->stat.bytes += m->air_len;
+
+    if (m->collided) {
+        m->stat.collisions++;
+        return;
+    }
+
+    sim_channel_t *ch = m->channel;
+    if (ch != NULL) {
+        if (m->burst) m->burst = sim_rand() >= ch->burst_leave;
+        else m->burst = sim_rand() < ch->burst_enter;
+        if (sim_rand() < ((m->burst)? ch->burst_loss : ch->loss)) {
+            m->stat.losses++;
+            return;
+        }
+    }
+
+    sim_module_t *p = m->peer;
+    if (p->out_count >= SIM_OUT_SLOTS) {
+        p->stat.out_overflows++;
+        return;
+    }
+    uint32_t start = now;
+    if (p->out_count > 0) {
+        uint32_t last = p->out[(p->out_head + p->out_count - 1) % SIM_OUT_SLOTS].ready_us;
+        if (!sim_due(start, last)) start = last;  // After the one before, on the UART
+    }
+    sim_out_t *o = &p->out[(p->out_head + p->out_count) % SIM_OUT_SLOTS];
+    o->len = m->air_len;
+    memcpy(o->data, m->air, m->air_len);
+    o->ready_us = start + (uint32_t)(m->air_len * sim_byte_us(p));
+    p->out_count++;
+    m->stat.delivered++;
+}
+
+void sim_step(sim_module_t *m) {
+    uint32_t now = hal_micros();
+
+    // Mode, by M* pins
+    uint8_t mode = 0;
+    for (uint8_t i = 0; i < m->m_count; i++) {
+        mode |= (hal_pin_read(m->m_pins[i]) == HAL_HIGH) << i;
+    }
+    if (mode != m->mode) {
+        m->mode = mode;
+        m->mode_switch_us = now;
+        m->cmd_len = 0;
+    }
+    bool setting = (mode == sim_config_mode(m));
+
+    // UART in
+    uint8_t buf[SIM_FIFO_MAX];
+    size_t n = sim_uart_in(m, buf, sizeof(buf), now);
+    if (setting) {
+        for (size_t i = 0; i < n; i++) sim_command(m, buf[i]);
+    }
+    else {
+        size_t room = m->fifo_size - m->fifo_len;
+        size_t take = (n < room)? n : room;
+        memcpy(&m->fifo[m->fifo_len], buf, take);
+        m->fifo_len += take;
+        m->stat.fifo_overflows += n - take;
+    }
+
+    // On air
+    if (m->on_air  &&  sim_due(now, m->air_end_us)) {
+        sim_air_end(m, now);
+    }
+    bool idle = hal_serial_available(&m->uart) == 0  &&  now - m->uart_in_us >= SIM_IDLE_BYTES * sim_byte_us(m);
+    if (!setting  &&  !m->on_air  &&  m->fifo_len > 0  &&  (m->fifo_len >= m->packet_max  ||  idle)) {
+        m->air_len = (m->fifo_len < m->packet_max)? m->fifo_len : m->packet_max;
+        memcpy(m->air, m->fifo, m->air_len);
+        m->fifo_len -= m->air_len;
+        memmove(m->fifo, &m->fifo[m->air_len], m->fifo_len);
+
+        uint32_t air_us = SIM_PREAMBLE_US + (uint32_t)((uint64_t)m->air_len * 8000000 / sim_air_bps(m));
+        m->air_end_us = now + air_us;
+        m->stat.air_us += air_us;
+        m->on_air = true;
+        m->collided = m->peer->on_air;  // Half-duplex: neither gets through.
+        if (m->peer->on_air) m->peer->collided = true;
+    }
+
+    // UART out
+    while (m->out_count > 0  &&  sim_due(now, m->out[m->out_head].ready_us)) {
+        sim_out_t *o = &m->out[m->out_head];
+        hal_serial_write(&m->uart, o->data, o->len);
+        m->out_head = (m->out_head + 1) % SIM_OUT_SLOTS;
+        m->out_count--;
+    }
+
+    bool busy = m->fifo_len > 0  ||  m->on_air  ||  m->out_count > 0  ||  !sim_due(now, m->mode_switch_us + SIM_MODE_SWITCH_US);
+    hal_pin_write(m->aux_pin, (busy)? HAL_LOW : HAL_HIGH);
+}
+
+
+void sim_print(const sim_module_t *m, const char *name) {
+    printf("%-9s: %s air %ubps uart %ubps packets %u bytes %u delivered %u collisions %u losses %u"
+           " fifo_overflows %uB out_overflows %u commands %u airtime %.3fs\n", name,
+        (m->model == SIM_E34)? "E34" : "E28", sim_air_bps(m), sim_uart_bps(m),
+        m->stat.packets, m->stat.bytes, m->stat.delivered, m->stat.collisions, m->stat.losses,
+        m->stat.fifo_overflows, m->stat.out_overflows, m->stat.commands, m->stat.air_us / 1e6);
+}
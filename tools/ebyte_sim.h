@@ -0,0 +1,102 @@
+#ifndef __EBYTE_SIM_H__
+#define __EBYTE_SIM_H__
+
+
+#include "hal.h"
+
+
+/**
+ * @brief Software Ebyte module, E34 or E28, for host runs on the virtual clock of hal_linux.cpp
+ *
+ * One end of its UART is the host's radio port, e.g. the other side of a PTY; AUX & M* are HAL pins.
+ *
+ * Transparent mode: UART bytes, paced at the configured baud rate, fill the FIFO; a packet goes on air
+ *     when the FIFO holds 'packet_max' bytes, or the UART has been idle for SIM_IDLE_BYTES bytes.
+ *     Air time is the preamble plus the bytes at the air rate. The peer gets the packet at its end,
+ *     and outputs it to its UART at its baud rate -- unless it was lost:
+ *       - collision: both ends on air at the same time, half-duplex; both packets are lost.
+ *       - loss: Gilbert-Elliott, 'loss' in the good state, 'burst_loss' in the bad one.
+ *     AUX is LOW while anything is in the FIFO, on air, or to be output; and for a while on a mode switch.
+ *
+ * Setting mode (M* as EbyteMode::setModeConfig()), at 9600bps: C0/C2 + 5 bytes set the configuration, echoed;
+ *     C1 C1 C1 reads it, C3 C3 C3 reads the version, C4 C4 C4 resets. Air & baud rates follow the configuration.
+ */
+#define SIM_FIFO_MAX        512
+#define SIM_OUT_SLOTS       8     // Received packets waiting for the UART
+#define SIM_IDLE_BYTES      3     // UART idle time, in bytes, that starts a TX
+#define SIM_MODE_SWITCH_US  2000  // AUX LOW after a mode switch
+#define SIM_PREAMBLE_US     100   // On air per packet, besides the bytes
+#define SIM_CONFIG_LEN      6     // As Configuration
+#define SIM_SETTING_BPS     9600  // UART in setting mode, EBYTE_CONFIG_BAUD
+
+typedef enum {
+    SIM_E34 = 0,
+    SIM_E28,
+} sim_model_t;
+
+typedef struct {
+    double loss;         // Per packet, in the good state
+    double burst_enter;  // Per packet, good to bad
+    double burst_leave;  // Per packet, bad to good
+    double burst_loss;   // Per packet, in the bad state
+} sim_channel_t;
+
+typedef struct {
+    uint32_t packets;         // Sent on air
+    uint32_t bytes;
+    uint32_t delivered;       // To the peer's UART
+    uint32_t collisions;
+    uint32_t losses;          // By the channel
+    uint32_t fifo_overflows;  // Bytes dropped
+    uint32_t out_overflows;   // Received packets dropped, no slot to the UART
+    uint32_t commands;        // In setting mode
+    uint32_t air_us;
+} sim_stat_t;
+
+typedef struct {
+    uint32_t ready_us;        // All out on the UART by then
+    uint16_t len;
+    uint8_t  data[SIM_FIFO_MAX];
+} sim_out_t;
+
+typedef struct sim_module {
+    sim_model_t model;
+    hal_serial_t uart;
+    uint8_t  aux_pin;
+    uint8_t  m_pins[3];
+    uint8_t  m_count;
+    size_t   fifo_size;
+    size_t   packet_max;
+    uint8_t  config[SIM_CONFIG_LEN];
+    struct sim_module *peer;
+    sim_channel_t *channel;   // Shared by both ends
+
+    // State
+    uint8_t  mode;
+    uint32_t mode_switch_us;
+    double   uart_in_us;      // Time the last UART byte was fully in
+    uint8_t  fifo[SIM_FIFO_MAX];
+    size_t   fifo_len;
+    uint8_t  cmd[SIM_CONFIG_LEN];
+    size_t   cmd_len;
+    bool     on_air;
+    bool     collided;
+    uint32_t air_end_us;
+    uint8_t  air[SIM_FIFO_MAX];
+    size_t   air_len;
+    sim_out_t out[SIM_OUT_SLOTS];
+    uint8_t  out_head;
+    uint8_t  out_count;
+    bool     burst;           // Channel in the bad state
+    sim_stat_t stat;
+} sim_module_t;
+
+extern void     sim_init(sim_module_t *m, sim_model_t model, uint8_t aux_pin, const uint8_t *m_pins);
+extern void     sim_connect(sim_module_t *a, sim_module_t *b, sim_channel_t *channel);
+extern void     sim_step(sim_module_t *m);  // Often, e.g. every few tens of us of the virtual clock
+extern uint32_t sim_air_bps(const sim_module_t *m);
+extern uint32_t sim_uart_bps(const sim_module_t *m);
+extern void     sim_print(const sim_module_t *m, const char *name);
+
+
+#endif  // __EBYTE_SIM_H__
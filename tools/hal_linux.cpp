@@ -0,0 +1,179 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Linux implementation of Main/hal.h, see hal_linux.h.
+ */
+#define _GNU_SOURCE 1
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include "hal_linux.h"
+
+
+static bool     hal_virtual = false;
+static uint64_t hal_virtual_us = 0;
+static uint8_t  hal_pins[HAL_LINUX_PINS];
+static void   (*hal_yield_fn)(uint32_t ms) = NULL;
+
+typedef struct {
+    void (*isr)(void *arg);
+    void *arg;
+} hal_pin_isr_t;
+
+static hal_pin_isr_t hal_pin_isrs[HAL_LINUX_PINS];
+
+
+static bool hal_linux_raw(int fd) {
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) return false;
+    cfmakeraw(&tio);
+    return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+bool hal_linux_open_pty(hal_serial_t *s, char *name, size_t name_len) {
+    s->fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (s->fd < 0) return false;
+
+    const char *slave = (grantpt(s->fd) == 0  &&  unlockpt(s->fd) == 0)? ptsname(s->fd) : NULL;
+    if (slave == NULL  ||  strlen(slave) >= name_len  ||  !hal_linux_raw(s->fd)) {  // Raw for both sides
+        hal_linux_close(s);
+        return false;
+    }
+    strcpy(name, slave);
+    return true;
+}
+
+bool hal_linux_open_path(hal_serial_t *s, const char *path) {
+    s->fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (s->fd < 0) return false;
+    if (isatty(s->fd)) hal_linux_raw(s->fd);
+    return true;
+}
+
+bool hal_linux_open_pair(hal_serial_t *a, hal_serial_t *b) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) != 0) return false;
+    a->fd = fds[0];
+    b->fd = fds[1];
+    return true;
+}
+
+void hal_linux_close(hal_serial_t *s) {
+    if (s->fd >= 0) close(s->fd);
+    s->fd = -1;
+}
+
+
+size_t hal_serial_available(hal_serial_t *s) {
+    int n = 0;
+    if (ioctl(s->fd, FIONREAD, &n) != 0  ||  n < 0) return 0;
+    return n;
+}
+
+size_t hal_serial_read(hal_serial_t *s, uint8_t *buf, size_t len) {
+    ssize_t n = read(s->fd, buf, len);  // No timeout; what is there already
+    return (n > 0)? n : 0;
+}
+
+size_t hal_serial_write(hal_serial_t *s, const uint8_t *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(s->fd, &buf[done], len - done);
+        if (n > 0) {
+            done += n;
+            continue;
+        }
+        if (n < 0  &&  errno != EAGAIN  &&  errno != EINTR) break;
+
+        struct pollfd pfd = {s->fd, POLLOUT, 0};  // Full, like a UART TX buffer
+        if (poll(&pfd, 1, 100) <= 0) break;
+    }
+    return done;
+}
+
+void hal_serial_flush(hal_serial_t *s) {
+    if (isatty(s->fd)) tcdrain(s->fd);  // A pair has nothing in flight.
+}
+
+
+uint8_t hal_pin_read(uint8_t pin) {
+    return (pin < HAL_LINUX_PINS)? hal_pins[pin] : HAL_LOW;
+}
+
+void hal_pin_write(uint8_t pin, uint8_t level) {
+    if (pin >= HAL_LINUX_PINS  ||  hal_pins[pin] == level) return;
+    hal_pins[pin] = level;
+    if (hal_pin_isrs[pin].isr != NULL) hal_pin_isrs[pin].isr(hal_pin_isrs[pin].arg);  // On CHANGE
+}
+
+void hal_linux_pin_isr(uint8_t pin, void (*isr)(void *arg), void *arg) {
+    if (pin >= HAL_LINUX_PINS) return;
+    hal_pin_isrs[pin].isr = isr;
+    hal_pin_isrs[pin].arg = arg;
+}
+
+
+static uint64_t hal_now_ns() {
+    if (hal_virtual) return hal_virtual_us * 1000;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+uint32_t hal_millis() {
+    return hal_now_ns() / 1000000;
+}
+
+uint32_t hal_micros() {
+    return hal_now_ns() / 1000;
+}
+
+uint32_t hal_cycles() {
+    return (hal_virtual)? hal_virtual_us * HAL_LINUX_VIRTUAL_MHZ : hal_now_ns();
+}
+
+uint32_t hal_cpu_mhz() {
+    return (hal_virtual)? HAL_LINUX_VIRTUAL_MHZ : 1000;
+}
+
+void hal_yield(uint32_t ms) {
+    if (hal_virtual  &&  hal_yield_fn != NULL) {
+        hal_yield_fn(ms);
+        return;
+    }
+    if (hal_virtual) {
+        hal_virtual_us += (uint64_t)ms * 1000;
+        sched_yield();  // The other end of a PTY may be another process.
+        return;
+    }
+    if (ms == 0) {
+        sched_yield();
+        return;
+    }
+    struct timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000};
+    nanosleep(&ts, NULL);
+}
+
+
+void hal_linux_virtual_clock(bool on) {
+    hal_virtual = on;
+    hal_virtual_us = 0;
+}
+
+void hal_linux_advance_us(uint32_t us) {
+    hal_virtual_us += us;
+}
+
+void hal_linux_yield_hook(void (*hook)(uint32_t ms)) {
+    hal_yield_fn = hook;
+}
@@ -0,0 +1,35 @@
+#ifndef __HAL_LINUX_H__
+#define __HAL_LINUX_H__
+
+
+#include "hal.h"
+
+
+/**
+ * @brief Linux implementation of Main/hal.h, for the host builds in tools/
+ *
+ * Ports are PTYs, or any tty by path, raw & non-blocking.
+ *     Connecting two ends in one process, take a pair: a PTY hands its bytes over in a kernel worker,
+ *     on the wall clock, so on the virtual clock they would arrive late, by a varying amount.
+ * The clock is CLOCK_MONOTONIC, or a virtual one that moves only by hal_yield() & hal_linux_advance_us();
+ *     runs are then repeatable, whatever the host load. Cycles are ns on the real clock.
+ * Pins are levels in memory, for a harness to drive, e.g. AUX; a handler may follow the changes of one,
+ *     as a GPIO interrupt on CHANGE, run from hal_pin_write().
+ * On the virtual clock, a yield hook may take over hal_yield(), e.g. to run the tasks of tools/host/.
+ */
+#define HAL_LINUX_PINS          64
+#define HAL_LINUX_VIRTUAL_MHZ   240  // As of the ESP32, for hal_cycles() on the virtual clock
+
+extern bool hal_linux_open_pty(hal_serial_t *s, char *name, size_t name_len);  // 'name' is the slave side
+extern bool hal_linux_open_path(hal_serial_t *s, const char *path);
+extern bool hal_linux_open_pair(hal_serial_t *a, hal_serial_t *b);  // In-process, e.g. to ebyte_sim.h; see above
+extern void hal_linux_close(hal_serial_t *s);
+
+extern void hal_linux_virtual_clock(bool on);  // Starts from zero
+extern void hal_linux_advance_us(uint32_t us);
+extern void hal_linux_yield_hook(void (*hook)(uint32_t ms));  // NULL is the default, see hal_yield()
+
+extern void hal_linux_pin_isr(uint8_t pin, void (*isr)(void *arg), void *arg);  // NULL detaches
+
+
+#endif  // __HAL_LINUX_H__
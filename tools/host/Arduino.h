@@ -0,0 +1,301 @@
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <math.h>
+#include <functional>
+#include <string>
+
+#include "hal.h"
+
+
+/**
+ * @brief Arduino core & FreeRTOS of the ESP32, as much as Main/ uses, for the host builds in tools/
+ *
+ * Over the Linux HAL, see tools/hal_linux.h; the firmware sources compile unchanged with -Ihost.
+ *     ARDUINO is not defined, so Main/hal.h takes the Linux HAL.
+ *
+ * Tasks are coroutines, run in turn by host_run_us() on the virtual clock, a tick at a time; a task runs
+ *     until it blocks: hal_yield(), vTaskDelay(), a semaphore or a notification. Nothing preempts, so
+ *     the critical sections are empty. Called from outside a task, e.g. by a test, a blocking call
+ *     runs the tasks itself until it returns.
+ * Each tick: the due tasks, the UART receive events, then the tick hook, e.g. ebyte_sim.h's sim_step().
+ *
+ * A HardwareSerial is one end of a socket pair of its own, made on construction, so the firmware's globals built
+ *     with it, e.g. the module of ebyte.ino, have their port; the harness takes the other end, host_peer().
+ *     Serial, the console, is on stdout. The RX buffer is the socket's, so there is no overflow event.
+ * Pins are the HAL's; an interrupt is a handler of hal_linux_pin_isr(), on CHANGE whatever the mode.
+ */
+#define HOST_TICK_US            10
+#define HOST_TASKS_MAX          16
+#define HOST_TASK_STACK_MIN     65536  // The host's libc takes more than the ESP32's, e.g. printf()
+
+
+// ----------------------------------------------------------------------------
+// Arduino core
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define LOW         HAL_LOW
+#define HIGH        HAL_HIGH
+#define INPUT       0x01
+#define OUTPUT      0x03
+#define INPUT_PULLUP 0x05
+#define CHANGE      0x03
+#define RISING      0x01
+#define FALLING     0x02
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define F(s)        (s)
+#define IRAM_ATTR
+#define isDigit(c)  (isdigit((unsigned char)(c)) != 0)
+
+#define digitalPinToInterrupt(p) (p)
+
+extern void     pinMode(uint8_t pin, uint8_t mode);
+extern void     digitalWrite(uint8_t pin, uint8_t level);
+extern int      digitalRead(uint8_t pin);
+extern void     attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode);
+extern void     detachInterrupt(uint8_t pin);
+
+extern unsigned long millis();
+extern unsigned long micros();
+extern void     delay(uint32_t ms);
+
+class EspClass {
+  public:
+    uint32_t getCycleCount() { return hal_cycles(); }
+    uint32_t getCpuFreqMHz() { return hal_cpu_mhz(); }
+};
+
+extern EspClass ESP;
+
+
+/**
+ * @brief String, over std::string
+ */
+class String {
+
+  public:
+    String() {}
+    String(const char * s) : s((s != NULL)? s : "") {}
+    String(const std::string & s) : s(s) {}
+    explicit String(char c) : s(1, c) {}
+    String(int value, unsigned char base = DEC)           { this->s = String::number((long)value, base); }
+    String(unsigned int value, unsigned char base = DEC)  { this->s = String::number((unsigned long)value, base); }
+    String(long value, unsigned char base = DEC)          { this->s = String::number(value, base); }
+    String(unsigned long value, unsigned char base = DEC) { this->s = String::number(value, base); }
+    String(double value, unsigned char decimals = 2);
+
+    unsigned int length() const { return this->s.length(); }
+    const char * c_str() const { return this->s.c_str(); }
+    char   charAt(unsigned int i) const { return (i < this->s.length())? this->s[i] : 0; }
+    char   operator [] (unsigned int i) const { return this->charAt(i); }
+    long   toInt() const { return strtol(this->s.c_str(), NULL, 10); }
+    float  toFloat() const { return strtof(this->s.c_str(), NULL); }
+    int    indexOf(char c, unsigned int from = 0) const;
+    int    indexOf(const String & str, unsigned int from = 0) const;
+    String substring(unsigned int from, unsigned int to = (unsigned int)-1) const;
+    void   toUpperCase();
+    void   toLowerCase();
+    void   trim();
+    bool   startsWith(const String & prefix) const { return this->s.compare(0, prefix.s.length(), prefix.s) == 0; }
+    bool   equals(const String & str) const { return this->s == str.s; }
+    bool   equalsIgnoreCase(const String & str) const { return strcasecmp(this->c_str(), str.c_str()) == 0; }
+
+    String & concat(const String & str) { this->s += str.s; return *this; }
+    String & operator += (const String & str) { this->s += str.s; return *this; }
+    String & operator += (const char * str) { this->s += str; return *this; }
+    String & operator += (char c) { this->s += c; return *this; }
+    bool operator == (const String & str) const { return this->s == str.s; }
+    bool operator == (const char * str) const { return this->s == str; }
+    bool operator != (const String & str) const { return this->s != str.s; }
+    bool operator != (const char * str) const { return this->s != str; }
+
+    friend String operator + (const String & a, const String & b) { return String(a.s + b.s); }
+    friend String operator + (const String & a, const char * b) { return String(a.s + b); }
+    friend String operator + (const char * a, const String & b) { return String(a + b.s); }
+
+  private:
+    std::string s;
+    static std::string number(long value, unsigned char base);
+    static std::string number(unsigned long value, unsigned char base);
+};
+
+
+/**
+ * @brief Print & Stream, of the console and the UARTs
+ */
+class Print {
+
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) { return this->write(&b, 1); }
+    virtual size_t write(const uint8_t * buf, size_t len) = 0;
+    size_t write(const char * s) { return this->write((const uint8_t *)s, strlen(s)); }
+
+    size_t print(const char * s) { return this->write(s); }
+    size_t print(const String & s) { return this->write(s.c_str()); }
+    size_t print(char c) { return this->write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return this->print((unsigned long)n, base); }
+    size_t print(int n, int base = DEC) { return this->print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return this->print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC) { return this->print(String(n, base)); }
+    size_t print(unsigned long n, int base = DEC) { return this->print(String(n, base)); }
+    size_t print(double n, int digits = 2) { return this->print(String(n, digits)); }
+
+    size_t println() { return this->write("\r\n"); }
+    template<typename T> size_t println(T v) { size_t n = this->print(v); return n + this->println(); }
+    template<typename T> size_t println(T v, int f) { size_t n = this->print(v, f); return n + this->println(); }
+
+    size_t printf(const char * format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    void setTimeout(unsigned long ms) { this->timeout_ms = ms; }
+
+  protected:
+    unsigned long timeout_ms = 1000;
+};
+
+
+/**
+ * @brief UART, as the ESP32's HardwareSerial
+ */
+#define SERIAL_8N1 0x800001c
+
+typedef enum {
+    UART_NO_ERROR,
+    UART_BREAK_ERROR,
+    UART_BUFFER_FULL_ERROR,
+    UART_FIFO_OVF_ERROR,
+    UART_FRAME_ERROR,
+    UART_PARITY_ERROR,
+} hardwareSerial_error_t;
+
+enum {
+    HW_FLOWCTRL_DISABLE = 0x0,
+    HW_FLOWCTRL_RTS     = 0x1,
+    HW_FLOWCTRL_CTS     = 0x2,
+    HW_FLOWCTRL_CTS_RTS = 0x3,
+};
+
+typedef std::function<void(void)> OnReceiveCb;
+typedef std::function<void(hardwareSerial_error_t)> OnReceiveErrorCb;
+
+class HardwareSerial : public Stream {
+
+  public:
+    HardwareSerial(int uart_nr);
+
+    void   begin(unsigned long baud, uint32_t /* config */ = SERIAL_8N1, int8_t /* rxPin */ = -1, int8_t /* txPin */ = -1) {
+        this->baud = baud;
+    }
+    void   end() {}
+    size_t setRxBufferSize(size_t size) { this->rx_buffer_size = size; return size; }
+    bool   setPins(int8_t /* rxPin */, int8_t /* txPin */, int8_t /* ctsPin */ = -1, int8_t /* rtsPin */ = -1) { return true; }
+    bool   setHwFlowCtrlMode(uint8_t mode = HW_FLOWCTRL_CTS_RTS, uint8_t /* threshold */ = 64) { this->flow_ctrl = mode; return true; }
+    void   onReceive(OnReceiveCb function, bool onlyOnTimeout = false);
+    void   onReceiveError(OnReceiveErrorCb function) { this->on_receive_error = function; }
+
+    int    available() override;
+    int    read() override;
+    size_t readBytes(uint8_t * buf, size_t len);  // Up to 'len', as many as come within the timeout
+    size_t readBytes(char * buf, size_t len) { return this->readBytes((uint8_t *)buf, len); }
+    size_t write(uint8_t b) override { return this->write(&b, 1); }
+    size_t write(const uint8_t * buf, size_t len) override;
+    using Print::write;
+    void   flush() { hal_serial_flush(&this->port); }
+    operator bool() const { return true; }
+
+    // Host side
+    hal_serial_t host_port() const { return this->port; }
+    hal_serial_t host_peer() const { return this->peer; }  // The other end: the computer, or the module
+    void         host_events();  // From the tick, as the event task of the UART driver
+
+  private:
+    hal_serial_t port;
+    hal_serial_t peer;
+    unsigned long baud = 0;
+    size_t   rx_buffer_size = 256;
+    uint8_t  flow_ctrl = HW_FLOWCTRL_DISABLE;
+    size_t   rx_seen = 0;  // available() at the last receive event
+    OnReceiveCb      on_receive = NULL;
+    OnReceiveErrorCb on_receive_error = NULL;
+};
+
+extern HardwareSerial Serial;  // The console, on stdout
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+inline hal_serial_t hal_serial_of(HardwareSerial * hs) {
+    return hs->host_port();
+}
+
+
+// ----------------------------------------------------------------------------
+// FreeRTOS
+
+typedef int32_t  BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef struct host_task * TaskHandle_t;
+typedef struct host_sem * SemaphoreHandle_t;
+typedef int      portMUX_TYPE;
+
+#define pdTRUE      1
+#define pdFALSE     0
+#define pdPASS      pdTRUE
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS      1
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms) / portTICK_PERIOD_MS)
+#define portMUX_INITIALIZER_UNLOCKED 0
+
+#define portENTER_CRITICAL(m)       ((void)(m))
+#define portEXIT_CRITICAL(m)        ((void)(m))
+#define portENTER_CRITICAL_ISR(m)   ((void)(m))
+#define portEXIT_CRITICAL_ISR(m)    ((void)(m))
+#define portYIELD_FROM_ISR()
+#define taskYIELD()                 hal_yield(0)
+
+extern BaseType_t   xTaskCreatePinnedToCore(void (*fn)(void *), const char * name, uint32_t stack_size, void * arg,
+                                            UBaseType_t priority, TaskHandle_t * handle, BaseType_t core);
+extern void         vTaskDelete(TaskHandle_t task);  // NULL is the calling one
+extern void         vTaskDelay(TickType_t ticks);
+extern TaskHandle_t xTaskGetCurrentTaskHandle();  // Outside the tasks too, e.g. main(); one for all of it
+extern UBaseType_t  uxTaskGetStackHighWaterMark(TaskHandle_t task);  // Not measured on the host, 0
+extern uint32_t     ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+extern void         vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t * woken);
+extern void         xTaskNotifyGive(TaskHandle_t task);
+
+extern SemaphoreHandle_t xSemaphoreCreateBinary();
+extern BaseType_t   xSemaphoreGive(SemaphoreHandle_t sem);
+extern BaseType_t   xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t * woken);
+extern BaseType_t   xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+
+
+// ----------------------------------------------------------------------------
+// Host side, for the harness; on the virtual clock only, see hal_linux_virtual_clock()
+
+extern void host_tick_hook(void (*hook)(void * arg), void * arg);  // Every tick, after the tasks
+extern void host_run_us(uint32_t us);  // Tasks & ticks, up to 'us' later
+extern void host_console(bool on);     // Serial to stdout, or dropped
+
+
+#endif  // __HOST_ARDUINO_H__
@@ -0,0 +1,8 @@
+#ifndef __HOST_TINYGPSPP_H__
+#define __HOST_TINYGPSPP_H__
+
+
+// Stand-in of the library: Main/global.h includes it, but nothing of it is used by the host builds in tools/.
+
+
+#endif  // __HOST_TINYGPSPP_H__
@@ -0,0 +1,379 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Arduino core & FreeRTOS of the ESP32 on the host, see Arduino.h.
+ */
+#include <ucontext.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Arduino.h"
+#include "hal_linux.h"
+
+
+EspClass ESP;
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+
+
+// ----------------------------------------------------------------------------
+// Pins & time
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (mode == INPUT_PULLUP  &&  hal_pin_read(pin) == LOW) hal_pin_write(pin, HIGH);
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+    hal_pin_write(pin, level);
+}
+
+int digitalRead(uint8_t pin) {
+    return hal_pin_read(pin);
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int /* mode */) {
+    hal_linux_pin_isr(pin, isr, arg);
+}
+
+void detachInterrupt(uint8_t pin) {
+    hal_linux_pin_isr(pin, NULL, NULL);
+}
+
+unsigned long millis() {
+    return hal_millis();
+}
+
+unsigned long micros() {
+    return hal_micros();
+}
+
+void delay(uint32_t ms) {
+    hal_yield(ms);
+}
+
+
+// ----------------------------------------------------------------------------
+// String
+
+String::String(double value, unsigned char decimals) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    this->s = buf;
+}
+
+std::string String::number(unsigned long value, unsigned char base) {
+    if (base < 2  ||  base > 36) base = DEC;
+    char buf[8 * sizeof(value) + 1];
+    char *p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+    do {
+        uint8_t d = value % base;
+        *--p = (d < 10)? '0' + d : 'A' + d - 10;
+        value /= base;
+    } while (value > 0);
+    return p;
+}
+
+std::string String::number(long value, unsigned char base) {
+    if (base == DEC  &&  value < 0) return "-" + String::number((unsigned long)-value, base);
+    return String::number((unsigned long)value, base);  // Two's complement in the other bases, as Arduino
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t i = this->s.find(c, from);
+    return (i == std::string::npos)? -1 : (int)i;
+}
+
+int String::indexOf(const String & str, unsigned int from) const {
+    size_t i = this->s.find(str.s, from);
+    return (i == std::string::npos)? -1 : (int)i;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (to > this->s.length()) to = this->s.length();
+    if (from >= to) return String();
+    return String(this->s.substr(from, to - from));
+}
+
+void String::toUpperCase() {
+    for (size_t i = 0; i < this->s.length(); i++) this->s[i] = toupper((unsigned char)this->s[i]);
+}
+
+void String::toLowerCase() {
+    for (size_t i = 0; i < this->s.length(); i++) this->s[i] = tolower((unsigned char)this->s[i]);
+}
+
+void String::trim() {
+    size_t b = this->s.find_first_not_of(" \t\r\n");
+    size_t e = this->s.find_last_not_of(" \t\r\n");
+    this->s = (b == std::string::npos)? "" : this->s.substr(b, e - b + 1);
+}
+
+
+size_t Print::printf(const char * format, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(buf, sizeof(buf), format, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    return this->write((const uint8_t *)buf, ((size_t)n < sizeof(buf))? n : sizeof(buf) - 1);
+}
+
+
+// ----------------------------------------------------------------------------
+// Tasks, see Arduino.h
+
+struct host_task {
+    ucontext_t  ctx;
+    std::vector<uint8_t> stack;
+    void      (*fn)(void *);
+    void *      arg;
+    const char * name;
+    uint64_t    wake_us;    // Runs on the first tick at or after
+    const void * waiting;   // Woken early when given, see host_wake()
+    uint32_t    notified;
+    bool        done;
+};
+
+struct host_sem {
+    bool given;
+};
+
+static host_task *host_tasks[HOST_TASKS_MAX];
+static size_t     host_task_count = 0;
+static host_task *host_current = NULL;  // NULL: outside the tasks, e.g. main()
+static host_task  host_outside;         // Notifications of the code outside the tasks
+static ucontext_t host_scheduler;       // Where a blocking task goes back to
+static uint64_t   host_now_us = 0;      // Not wrapping, as hal_micros()
+static void     (*host_tick_fn)(void *) = NULL;
+static void *     host_tick_arg = NULL;
+static std::vector<HardwareSerial *> host_uarts;  // With receive events
+
+
+/**
+ * @brief Until 'wake_us', or woken by 'waiting'; outside the tasks, a tick only
+ */
+static void host_block(uint64_t wake_us, const void *waiting) {
+    host_task *t = host_current;
+    if (t == NULL) {
+        host_run_us(HOST_TICK_US);
+        return;
+    }
+    t->wake_us = wake_us;
+    t->waiting = waiting;
+    swapcontext(&t->ctx, &host_scheduler);
+    t->waiting = NULL;
+}
+
+static void host_wake(const void *waiting) {
+    for (size_t i = 0; i < host_task_count; i++) {
+        if (host_tasks[i]->waiting == waiting) host_tasks[i]->wake_us = host_now_us;
+    }
+}
+
+static void host_tick() {
+    for (size_t i = 0; i < host_task_count; i++) {
+        host_task *t = host_tasks[i];
+        if (t->done  ||  t->wake_us > host_now_us) continue;
+        host_current = t;
+        swapcontext(&host_scheduler, &t->ctx);
+        host_current = NULL;
+    }
+    for (size_t i = 0; i < host_uarts.size(); i++) host_uarts[i]->host_events();
+    if (host_tick_fn != NULL) host_tick_fn(host_tick_arg);
+
+    hal_linux_advance_us(HOST_TICK_US);
+    host_now_us += HOST_TICK_US;
+}
+
+/**
+ * @brief hal_yield(): a task blocks until 'ms' later, at least to the next tick; outside, the tasks run meanwhile.
+ */
+static void host_yield(uint32_t ms) {
+    uint32_t us = (ms > 0)? ms * 1000 : HOST_TICK_US;
+    if (host_current != NULL) host_block(host_now_us + us, NULL);
+    else host_run_us(us);
+}
+
+static void host_task_entry(unsigned int hi, unsigned int lo) {
+    host_task *t = (host_task *)(((uintptr_t)hi << 32) | lo);
+    t->fn(t->arg);
+    t->done = true;  // A FreeRTOS task must not return; this one is simply over.
+    setcontext(&host_scheduler);
+}
+
+static void host_setup() {
+    static bool done = false;
+    if (done) return;
+    done = true;
+    hal_linux_yield_hook(host_yield);
+}
+
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char * name, uint32_t stack_size, void * arg,
+                                   UBaseType_t /* priority */, TaskHandle_t * handle, BaseType_t /* core */) {
+    if (host_task_count >= HOST_TASKS_MAX) return pdFALSE;
+    host_setup();
+
+    host_task *t = new host_task();
+    t->stack.resize((stack_size > HOST_TASK_STACK_MIN)? stack_size : HOST_TASK_STACK_MIN);
+    t->fn = fn;
+    t->arg = arg;
+    t->name = name;
+    t->wake_us = host_now_us;
+    getcontext(&t->ctx);
+    t->ctx.uc_stack.ss_sp = t->stack.data();
+    t->ctx.uc_stack.ss_size = t->stack.size();
+    t->ctx.uc_link = NULL;
+    uintptr_t p = (uintptr_t)t;
+    makecontext(&t->ctx, (void (*)())host_task_entry, 2, (unsigned int)(p >> 32), (unsigned int)p);
+
+    host_tasks[host_task_count++] = t;
+    if (handle != NULL) *handle = t;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == NULL) task = host_current;
+    if (task == NULL) return;
+    task->done = true;
+    if (task == host_current) swapcontext(&task->ctx, &host_scheduler);  // Never resumed
+}
+
+void vTaskDelay(TickType_t ticks) {
+    hal_yield(ticks * portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return (host_current != NULL)? host_current : &host_outside;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t /* task */) {
+    return 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    host_task *t = xTaskGetCurrentTaskHandle();
+    uint64_t until = (ticks == portMAX_DELAY)? UINT64_MAX : host_now_us + (uint64_t)ticks * portTICK_PERIOD_MS * 1000;
+    while (t->notified == 0  &&  host_now_us < until) host_block(until, t);
+
+    uint32_t n = t->notified;
+    t->notified = (clear == pdTRUE  ||  n == 0)? 0 : n - 1;
+    return n;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t * woken) {
+    xTaskNotifyGive(task);
+    if (woken != NULL) *woken = pdFALSE;
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    if (task == NULL) return;
+    task->notified++;
+    host_wake(task);
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return new host_sem();
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (sem->given) return pdFALSE;
+    sem->given = true;
+    host_wake(sem);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t * woken) {
+    if (woken != NULL) *woken = pdFALSE;
+    return xSemaphoreGive(sem);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    uint64_t until = (ticks == portMAX_DELAY)? UINT64_MAX : host_now_us + (uint64_t)ticks * portTICK_PERIOD_MS * 1000;
+    while (!sem->given) {
+        if (host_now_us >= until) return pdFALSE;
+        host_block(until, sem);
+    }
+    sem->given = false;
+    return pdTRUE;
+}
+
+
+void host_tick_hook(void (*hook)(void * arg), void * arg) {
+    host_setup();
+    host_tick_fn = hook;
+    host_tick_arg = arg;
+}
+
+void host_run_us(uint32_t us) {
+    host_setup();
+    uint64_t until = host_now_us + us;
+    while (host_now_us < until) host_tick();
+}
+
+
+// ----------------------------------------------------------------------------
+// UART
+
+static bool host_console_on = true;
+
+void host_console(bool on) {
+    host_console_on = on;
+}
+
+HardwareSerial::HardwareSerial(int uart_nr) {
+    this->port.fd = this->peer.fd = -1;
+    if (uart_nr == 0) this->port.fd = STDOUT_FILENO;  // The console
+    else hal_linux_open_pair(&this->port, &this->peer);
+}
+
+void HardwareSerial::onReceive(OnReceiveCb function, bool /* onlyOnTimeout */) {
+    this->on_receive = function;
+    for (size_t i = 0; i < host_uarts.size(); i++) {
+        if (host_uarts[i] == this) return;
+    }
+    host_uarts.push_back(this);
+}
+
+void HardwareSerial::host_events() {
+    size_t n = this->available();
+    if (n > 0  &&  n != this->rx_seen  &&  this->on_receive) this->on_receive();
+    this->rx_seen = n;
+}
+
+int HardwareSerial::available() {
+    if (this->port.fd < 0  ||  this->port.fd == STDOUT_FILENO) return 0;
+    return hal_serial_available(&this->port);
+}
+
+int HardwareSerial::read() {
+    uint8_t b;
+    return (this->available() > 0  &&  hal_serial_read(&this->port, &b, 1) == 1)? b : -1;
+}
+
+size_t HardwareSerial::readBytes(uint8_t * buf, size_t len) {
+    size_t got = 0;
+    uint32_t start = hal_millis();
+    while (got < len) {
+        if (this->available() > 0) {
+            got += hal_serial_read(&this->port, &buf[got], len - got);
+            continue;
+        }
+        if (hal_millis() - start >= this->timeout_ms) break;
+        hal_yield(0);
+    }
+    return got;
+}
+
+size_t HardwareSerial::write(const uint8_t * buf, size_t len) {
+    if (this->port.fd < 0) return len;
+    if (this->port.fd == STDOUT_FILENO) {
+        if (host_console_on) fwrite(buf, 1, len, stdout);
+        return len;
+    }
+    return hal_serial_write(&this->port, buf, len);
+}
@@ -0,0 +1,358 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * End-to-end link on the host: the firmware's own radio path at both ends, each with its software Ebyte module
+ *     (ebyte_sim.h), over a lossy half-duplex channel; all on the virtual clock, so any setting can be
+ *     measured without the hardware, and repeated.
+ *
+ *   computer A <--> ebyte.ino A <--> module A ~~ air ~~ module B <--> ebyte.ino B <--> computer B
+ *
+ * Main/ebyte.ino & gap.cpp are built twice, in the namespaces end_a & end_b, see sim_link_end.h; so each end
+ *     has its tasks, TX lanes, FIFO credit, gap controller, and in the raw type its framing, FEC & ARQ.
+ *     The tasks run over tools/host/, the Arduino & FreeRTOS shim; the ports are socket pairs, see hal_linux.h.
+ *     ebyte_setup() configures each module through its setting mode, as on the board.
+ * The computer ports are not paced; the module ports are, by the modules, at their baud rate.
+ *
+ * Computer A sends MAVLink frames carrying a sequence number & a timestamp, at a rate; so does B with --bidir.
+ * Reported per direction: goodput, loss, reordering & one-way latency percentiles; then the module stats,
+ *     the gaps each end settled on, and the firmware's own report of each end.
+ *
+ * $ g++ -O2 -Ihost -I../Main -I. sim_link.cpp ebyte_sim.cpp hal_linux.cpp host/arduino_host.cpp ../Main/helper.cpp \
+ *       ../Main/termlog.cpp ../Main/ebyte_module.cpp ../Main/ebyte_e34.cpp ../Main/queue.cpp ../Main/framing.cpp \
+ *       ../Main/fragment.cpp ../Main/fec.cpp ../Main/arq.cpp ../Main/mavlink.cpp ../Main/packer.cpp \
+ *       ../Main/spsc.cpp ../Main/latency.cpp ../Main/crc16.cpp -o sim_link
+ * Or with the other host tools, under ctest, see CMakeLists.txt at the top.
+ * $ ./sim_link --air 1 --rate 50 --size 40 --seconds 10 --loss 0.01
+ *     One way: ~1% lost, that of the channel; ~15ms one-way.
+ * $ ./sim_link --air 1 --rate 50 --size 40 --seconds 10 --bidir --rxtx 20 --txtx 10 --loss 0.01
+ *     Both ways, the gaps pinned: ~9% lost, mostly to collisions, as both ends wait the same gaps.
+ *
+ * $ ./sim_link --air 1 --rate 10 --size 40 --seconds 10 --bidir --min-delivery 90
+ *     Both ways, adaptive: ~4% lost each way; neither end starves, see gap_rxtx_hold().
+ *
+ * Pinning --rxtx alone leaves TX-TX at its default, EBYTE_TBTW_TXTX_MS; e.g. at --rate 200 --bidir --rxtx 20,
+ *     each end sends ~10 packets a second, the rest is dropped at the full TX lane: ~80% lost, no collision.
+ * Left adaptive, both ways at a steady rate, the RX-TX gap, a few times the peer's inter-arrival, outlasts
+ *     the peer's own pace; so it is cut short for a head that has waited an inter-arrival, and the ends take turns.
+ *     At --rate 50 both ways, the turns are too few for the frames: ~40% lost each way, at the full TX lanes.
+ * With --min-delivery, the run fails, exit 1, if a direction delivers less; as the ctest runs do.
+ */
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "global.h"
+#include "hal_linux.h"
+#include "ebyte_sim.h"
+
+
+#define LINK_AUX_A      10  // M0 & M1 follow, then RTS & CTS of the computer.
+#define LINK_AUX_B      20
+
+#define EBYTE_PIN_AUX       LINK_AUX_A
+#define EBYTE_PIN_M0        (LINK_AUX_A + 1)
+#define EBYTE_PIN_M1        (LINK_AUX_A + 2)
+#define EBYTE_FC_PIN_RTS    (LINK_AUX_A + 3)
+#define EBYTE_FC_PIN_CTS    (LINK_AUX_A + 4)
+namespace end_a {
+#include "sim_link_end.h"
+}
+#undef EBYTE_PIN_AUX
+#undef EBYTE_PIN_M0
+#undef EBYTE_PIN_M1
+#undef EBYTE_FC_PIN_RTS
+#undef EBYTE_FC_PIN_CTS
+
+#define EBYTE_PIN_AUX       LINK_AUX_B
+#define EBYTE_PIN_M0        (LINK_AUX_B + 1)
+#define EBYTE_PIN_M1        (LINK_AUX_B + 2)
+#define EBYTE_FC_PIN_RTS    (LINK_AUX_B + 3)
+#define EBYTE_FC_PIN_CTS    (LINK_AUX_B + 4)
+namespace end_b {
+#include "sim_link_end.h"
+}
+
+
+#define LINK_MSGID      0     // HEARTBEAT, any length goes in v2; the control lane.
+#define LINK_SYSID      1     // Not of RADIO_STATUS, which the firmware sends the computer too
+#define LINK_STAMP_LEN  12    // Sequence number & send time, at the head of the payload
+#define LINK_DRAIN_SEC  2     // After the traffic stops, for the last frames to arrive
+#define LINK_STEP_US    100   // Of the computers, between runs of the firmware
+
+verbose_level_t system_verbose_level = VERBOSE_NONE;
+
+typedef struct {
+    int      air_level;     // As the 'airrate' command, -1 keeps the firmware's
+    uint32_t rate;          // Frames per second, per direction
+    uint8_t  size;          // Payload bytes
+    uint32_t seconds;
+    bool     bidir;
+    int32_t  rxtx_ms;       // Gaps, as the 'gap' command; -1 is adaptive
+    int32_t  txtx_ms;
+    uint8_t  message_type;
+    bool     reliable;
+    uint8_t  fec_k, fec_n;
+    size_t   packet;        // Module packet, 0 is the FIFO size
+    sim_channel_t channel;
+    double   min_delivery;  // %, per direction; below it, the run fails
+} link_opts_t;
+
+/**
+ * @brief A computer & its module; the firmware in between is the namespace of the end.
+ */
+typedef struct {
+    const char *name;
+    sim_module_t sim;
+    hal_serial_t app;       // Computer end
+    mavlink_parser_t app_parser;
+
+    // Sending
+    uint32_t next_seq;
+    double   next_send_us;
+
+    // Receiving, from the other side
+    uint32_t received;
+    uint32_t expected_seq;
+    uint32_t reordered;     // Older than one seen already
+    uint64_t bytes;
+    lat_hist_t one_way;     // us
+} link_end_t;
+
+
+static void put_u32(uint8_t *p, uint32_t v) { memcpy(p, &v, sizeof(v)); }
+static uint32_t get_u32(const uint8_t *p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+
+/**
+ * @brief An end on the ports of its firmware: the computer on the peer of 'computer', the module on that of 'radio'
+ */
+static bool link_open(link_end_t *e, const link_opts_t *o, const char *name, uint8_t aux_pin,
+                      HardwareSerial *computer, HardwareSerial *radio) {
+    e->name = name;
+    e->app = computer->host_peer();
+    if (e->app.fd < 0  ||  radio->host_peer().fd < 0) return false;
+
+    const uint8_t m_pins[3] = {(uint8_t)(aux_pin + 1), (uint8_t)(aux_pin + 2), (uint8_t)(aux_pin + 3)};
+    sim_init(&e->sim, (EBYTE_MODULE == EBYTE_E28)? SIM_E28 : SIM_E34, aux_pin, m_pins);
+    e->sim.uart = radio->host_peer();
+    if (o->packet > 0) e->sim.packet_max = (o->packet < e->sim.fifo_size)? o->packet : e->sim.fifo_size;
+
+    mavlink_parser_init(&e->app_parser);
+    lat_reset(&e->one_way);
+    return true;
+}
+
+static void link_tick(void *arg) {
+    link_end_t *ends = (link_end_t *)arg;
+    for (int i = 0; i < 2; i++) sim_step(&ends[i].sim);
+}
+
+/**
+ * @brief The firmware settings of an end, as the CLI would set them, before ebyte_setup()
+ */
+#define LINK_CONFIGURE(ns, o) do {                                                  \
+    if ((o)->air_level >= 0) ns::ebyte_airrate_level = (o)->air_level;              \
+    ns::ebyte_message_type = (o)->message_type;                                     \
+    ns::ebyte_reliable = (o)->reliable;                                             \
+    ns::ebyte_fec_k = (o)->fec_k;                                                   \
+    ns::ebyte_fec_n = (o)->fec_n;                                                   \
+    ns::ebyte_tbtw_manual = ((o)->rxtx_ms >= 0  ||  (o)->txtx_ms >= 0);             \
+    if ((o)->rxtx_ms >= 0) ns::ebyte_tbtw_rxtx_ms = (o)->rxtx_ms;                   \
+    if ((o)->txtx_ms >= 0) ns::ebyte_tbtw_txtx_ms = (o)->txtx_ms;                   \
+} while (0)
+
+static void link_send(link_end_t *e, const link_opts_t *o) {
+    if (o->rate == 0) return;
+    while (e->next_send_us <= micros()) {
+        uint8_t payload[255], frame[MAVLINK_MAX_FRAME_LEN];
+        memset(payload, 0x55, sizeof(payload));
+        put_u32(payload, e->next_seq);
+        put_u32(&payload[4], micros());
+        size_t len = mavlink_pack(frame, MAVLINK_STX_V2, e->next_seq, LINK_SYSID, 1, LINK_MSGID, payload, o->size);
+        hal_serial_write(&e->app, frame, len);
+        e->next_seq++;
+        e->next_send_us += 1e6 / o->rate * (0.5 + (double)rand() / RAND_MAX);  // Jitter, so both ends are not in lockstep
+    }
+}
+
+static void link_receive(link_end_t *e) {
+    uint8_t buf[1024];
+    size_t n;
+    while ((n = hal_serial_read(&e->app, buf, sizeof(buf))) > 0) {
+        mavlink_frame_t frame;
+        mavlink_parse_begin(&e->app_parser, buf, n);
+        while (mavlink_parse_next(&e->app_parser, &frame)) {
+            if (frame.msgid != LINK_MSGID  ||  frame.sysid != LINK_SYSID) continue;  // e.g. RADIO_STATUS
+            uint8_t f[MAVLINK_MAX_FRAME_LEN];
+            memcpy(f, frame.head, frame.head_len);
+            memcpy(&f[frame.head_len], frame.body, frame.body_len);
+            const uint8_t *payload = &f[MAVLINK_HEADER_LEN_V2];
+
+            uint32_t seq = get_u32(payload);
+            lat_add(&e->one_way, micros() - get_u32(&payload[4]));
+            if (seq < e->expected_seq) e->reordered++;
+            else e->expected_seq = seq + 1;
+            e->received++;
+            e->bytes += frame.head_len + frame.body_len;
+        }
+    }
+}
+
+/**
+ * @return the delivery, in % of those sent
+ */
+static double link_report(const link_end_t *from, const link_end_t *to, double seconds) {
+    uint32_t sent = from->next_seq;
+    printf("%s->%s     : sent %u received %u loss %.2f%% reordered %u goodput %.0fB/s"
+           " one-way p50 %.1fms p90 %.1fms p99 %.1fms max %.1fms\n", from->name, to->name,
+        sent, to->received, (sent > 0)? 100.0 * (sent - to->received) / sent : 0.0, to->reordered,
+        to->bytes / seconds,
+        lat_percentile(&to->one_way, 50) / 1e3, lat_percentile(&to->one_way, 90) / 1e3,
+        lat_percentile(&to->one_way, 99) / 1e3, to->one_way.max / 1e3);
+    return (sent > 0)? 100.0 * to->received / sent : 100.0;
+}
+
+#define LINK_REPORT_END(ns, name) do {                                                              \
+    const ns::gap_estimate_t *g = ns::gap_get_estimate();                                          \
+    printf("gaps %s   : rxtx %ums txtx %ums %s backoff %.2f loss %.3f inter-arrival %.1fms busy %.2fms\n", \
+        name, ns::ebyte_tbtw_rxtx_ms, ns::ebyte_tbtw_txtx_ms, (g->manual)? "manual" : "adaptive",   \
+        g->backoff, g->loss_rate, g->inter_arival_ms, g->busy_ms);                                  \
+    printf("firmware %s:\n", name);                                                                 \
+    fflush(stdout);                                                                                 \
+    ns::ebyte_show_report_count = 1;                                                                \
+    ns::ebyte_report_process();                                                                     \
+    fflush(stdout);                                                                                 \
+} while (0)
+
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options]\n"
+           "  --air level         air rate, as the 'airrate' command [firmware's]\n"
+           "  --rate fps          frames per second, per direction [50]\n"
+           "  --size bytes        MAVLink payload, >= %d [40]\n"
+           "  --seconds s         of traffic [10]\n"
+           "  --bidir             both directions\n"
+           "  --rxtx ms, --txtx ms  gaps pinned, as the 'gap' command [adaptive]\n"
+           "  --raw               raw message type: framed, fragmented [MAVLink]\n"
+           "  --reliable          ARQ, raw type only\n"
+           "  --fec k,n           parity of k data fragments in n, raw type only [off]\n"
+           "  --packet bytes      of the module on air [FIFO size]\n"
+           "  --loss p            per packet [0]\n"
+           "  --burst in,out,p    Gilbert-Elliott: enter & leave probabilities, loss in the burst [0,0,0]\n"
+           "  --seed n            [1]\n"
+           "  --min-delivery pct  per direction, or exit 1 [0]\n"
+           "  --verbose level     of the firmware's log, 0 to 4 [0]\n",
+           prog, LINK_STAMP_LEN);
+}
+
+int main(int argc, char **argv) {
+    link_opts_t o = {};
+    o.air_level = -1;
+    o.rate = 50;
+    o.size = 40;
+    o.seconds = 10;
+    o.rxtx_ms = o.txtx_ms = -1;
+    o.message_type = MSG_TYPE_MAVLINK;
+    unsigned seed = 1;
+
+    static const struct option long_opts[] = {
+        {"air", required_argument, 0, 'a'}, {"rate", required_argument, 0, 'r'},
+        {"size", required_argument, 0, 's'}, {"seconds", required_argument, 0, 't'},
+        {"bidir", no_argument, 0, 'b'}, {"rxtx", required_argument, 0, 'x'},
+        {"txtx", required_argument, 0, 'y'}, {"raw", no_argument, 0, 'R'},
+        {"reliable", no_argument, 0, 'A'}, {"fec", required_argument, 0, 'F'},
+        {"packet", required_argument, 0, 'p'}, {"loss", required_argument, 0, 'l'},
+        {"burst", required_argument, 0, 'B'}, {"seed", required_argument, 0, 'S'},
+        {"min-delivery", required_argument, 0, 'm'},
+        {"verbose", required_argument, 0, 'v'}, {"help", no_argument, 0, 'h'}, {0, 0, 0, 0},
+    };
+    int c;
+    unsigned k = 0, n = 0;
+    while ((c = getopt_long(argc, argv, "h", long_opts, NULL)) != -1) {
+        switch (c) {
+            case 'a': o.air_level = atoi(optarg); break;
+            case 'r': o.rate = strtoul(optarg, NULL, 0); break;
+            case 's': o.size = atoi(optarg); break;
+            case 't': o.seconds = strtoul(optarg, NULL, 0); break;
+            case 'b': o.bidir = true; break;
+            case 'x': o.rxtx_ms = atoi(optarg); break;
+            case 'y': o.txtx_ms = atoi(optarg); break;
+            case 'R': o.message_type = MSG_TYPE_RAW; break;
+            case 'A': o.reliable = true; break;
+            case 'F': sscanf(optarg, "%u,%u", &k, &n); o.fec_k = k; o.fec_n = n; break;
+            case 'p': o.packet = strtoul(optarg, NULL, 0); break;
+            case 'l': o.channel.loss = atof(optarg); break;
+            case 'B': sscanf(optarg, "%lf,%lf,%lf", &o.channel.burst_enter, &o.channel.burst_leave, &o.channel.burst_loss); break;
+            case 'S': seed = strtoul(optarg, NULL, 0); break;
+            case 'm': o.min_delivery = atof(optarg); break;
+            case 'v': system_verbose_level = (verbose_level_t)atoi(optarg); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (o.size < LINK_STAMP_LEN) {
+        usage(argv[0]);
+        return 1;
+    }
+    srand(seed);
+    hal_linux_virtual_clock(true);
+
+    static link_end_t ends[2];  // Big, off the stack
+    if (!link_open(&ends[0], &o, "A", LINK_AUX_A, &end_a::Serial1, &end_a::Serial2)
+    ||  !link_open(&ends[1], &o, "B", LINK_AUX_B, &end_b::Serial1, &end_b::Serial2)) {
+        perror("socketpair");
+        return 1;
+    }
+    sim_connect(&ends[0].sim, &ends[1].sim, &o.channel);
+    host_tick_hook(link_tick, ends);
+
+    // As the board boots, but quietly: the configuration printing is of no use here.
+    host_console(false);
+    termlog_setup();
+    LINK_CONFIGURE(end_a, &o);
+    LINK_CONFIGURE(end_b, &o);
+    end_a::ebyte_setup(false);
+    end_b::ebyte_setup(false);
+    host_console(true);
+    if (end_a::ebyte_downlink_task_stat.handle == NULL  ||  end_b::ebyte_downlink_task_stat.handle == NULL) {
+        fprintf(stderr, "setup failed, see --verbose\n");
+        return 1;
+    }
+
+    printf("setup    : %s air %ubps uart %ubps fifo %zu packet %zu %s%s fec %u/%u rate %u/s size %u %s"
+           " loss %.3f burst %.3f,%.3f,%.3f\n",
+        (EBYTE_MODULE == EBYTE_E28)? "E28" : "E34", sim_air_bps(&ends[0].sim), sim_uart_bps(&ends[0].sim),
+        ends[0].sim.fifo_size, ends[0].sim.packet_max, (o.message_type == MSG_TYPE_RAW)? "raw" : "mavlink",
+        (o.reliable)? " reliable" : "", o.fec_k, o.fec_n, o.rate, o.size, (o.bidir)? "bidir" : "A->B",
+        o.channel.loss, o.channel.burst_enter, o.channel.burst_leave, o.channel.burst_loss);
+    fflush(stdout);
+
+    uint32_t start_us = micros();
+    ends[0].next_send_us = ends[1].next_send_us = start_us;
+    uint32_t traffic_us = o.seconds * 1000000;
+    uint32_t drain_us = traffic_us + LINK_DRAIN_SEC * 1000000;
+    while (micros() - start_us < drain_us) {
+        if (micros() - start_us < traffic_us) {
+            link_send(&ends[0], &o);
+            if (o.bidir) link_send(&ends[1], &o);
+        }
+        host_run_us(LINK_STEP_US);
+        for (int i = 0; i < 2; i++) link_receive(&ends[i]);
+    }
+
+    double delivery = link_report(&ends[0], &ends[1], o.seconds);
+    if (o.bidir) {
+        double back = link_report(&ends[1], &ends[0], o.seconds);
+        if (back < delivery) delivery = back;
+    }
+    for (int i = 0; i < 2; i++) sim_print(&ends[i].sim, (i == 0)? "module A" : "module B");
+    LINK_REPORT_END(end_a, "A");
+    LINK_REPORT_END(end_b, "B");
+
+    if (delivery < o.min_delivery) {
+        printf("FAIL     : delivery %.2f%% < %.2f%%, of a direction\n", delivery, o.min_delivery);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * One end of sim_link.cpp: the radio path of the firmware, Main/ebyte.ino with gap.cpp, as built for the ESP32.
+ * Included inside a namespace, once per end; no include guard, on purpose.
+ *
+ * Main/global.h is included at the global scope first, so the includes of the firmware sources are no-ops here,
+ *     but for ebyte.h & gap.h, the state of an end, whose guards are dropped to have them again in this namespace.
+ * EBYTE_PIN_* & EBYTE_FC_PIN_RTS/CTS are defined by the includer, a set per end.
+ */
+
+HardwareSerial Serial1(1);  // The computer & the module ports of this end, over the globals
+HardwareSerial Serial2(2);
+
+#undef __EBYTE_H__
+#undef __GAP_H__
+#include "ebyte.h"
+#include "gap.cpp"
+
+// Used ahead of their definitions; the Arduino builder makes these prototypes for the sketch.
+static void ebyte_computer_on_receive();
+static void ebyte_computer_on_receive_error(hardwareSerial_error_t err);
+static void ebyte_uplink_task(void *arg);
+static void ebyte_downlink_task(void *arg);
+
+#include "ebyte.ino"
@@ -0,0 +1,523 @@
+/**
+ * @author Pasakorn Tiwatthanont (iPAS)
+ *
+ * Unit tests of the data path of the firmware, on the host: Main/ebyte_module.cpp & ebyte_e34.cpp, the TX lanes,
+ *     queue.cpp, the framing, fragment, FEC & ARQ layers, and the MAVLink parser; the sources of the ESP32 build,
+ *     over tools/host/ & the Linux HAL, with two software modules (ebyte_sim.h) for the radios.
+ * On the virtual clock, so a run is repeatable; exits non-zero if a check fails.
+ *
+ * $ g++ -O2 -Ihost -I../Main -I. test_ebyte_module.cpp host/arduino_host.cpp hal_linux.cpp ebyte_sim.cpp \
+ *       ../Main/ebyte_module.cpp ../Main/ebyte_e34.cpp ../Main/queue.cpp ../Main/framing.cpp ../Main/fragment.cpp \
+ *       ../Main/fec.cpp ../Main/arq.cpp ../Main/mavlink.cpp ../Main/crc16.cpp -o test_ebyte_module && ./test_ebyte_module
+ * Or with the other host tools, under ctest, see CMakeLists.txt at the top.
+ */
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+#include "hal_linux.h"
+#include "ebyte_sim.h"
+#include "ebyte_e34.h"
+#include "framing.h"
+#include "fragment.h"
+#include "mavlink.h"
+#include "queue.h"
+
+
+#define TEST_AUX_A      10  // M0 & M1 follow.
+#define TEST_AUX_B      20
+#define TEST_DATA_BAUD  115200
+#define TEST_ARQ_MESSAGES 30
+#define TEST_ARQ_LOSS   0.2
+#define TEST_RUN_MAX_MS 20000
+
+static int test_checks = 0;
+static int test_failures = 0;
+
+#define CHECK(cond) do {                                                    \
+    test_checks++;                                                          \
+    if (!(cond)) {                                                          \
+        test_failures++;                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);              \
+    }                                                                       \
+} while (0)
+
+
+/**
+ * @brief Two ends, A & B, each a real EbyteE34 on a software module
+ */
+typedef struct {
+    sim_module_t  sim;
+    HardwareSerial *radio;
+    EbyteE34      *ebyte;
+    framing_decoder_t decoder;
+    frag_table_t  reasm;
+    std::vector<std::string> messages;  // Reassembled, in order of arrival
+    std::string   raw;                  // Bytes received, unframed
+} test_end_t;
+
+static test_end_t end_a, end_b;
+static sim_channel_t test_channel;
+
+
+static void test_tick(void *) {
+    sim_step(&end_a.sim);
+    sim_step(&end_b.sim);
+}
+
+static void test_open(test_end_t *e, uint8_t aux) {
+    const uint8_t m_pins[2] = {(uint8_t)(aux + 1), (uint8_t)(aux + 2)};
+    sim_init(&e->sim, SIM_E34, aux, m_pins);
+
+    e->radio = new HardwareSerial(2);
+    e->sim.uart = e->radio->host_peer();
+    e->ebyte = new EbyteE34(e->radio, aux, m_pins[0], m_pins[1]);
+}
+
+/**
+ * @brief Reads what came on the radio; framed: decoded, through the ARQ if on, then reassembled
+ *     'skip' drops the n-th frame from now, 1 is the next one, as if it were lost on air.
+ */
+static void test_pump(test_end_t *e, int *skip = NULL) {
+    uint8_t buf[EBYTE_MODULE_BUFFER_SIZE];
+    size_t size;
+    while (e->ebyte->available() > 0) {
+        if (e->ebyte->receiveMessage(buf, sizeof(buf), size).code != ResponseStatus::SUCCESS) break;
+        if (!e->ebyte->isFraming()) {
+            e->raw.append((const char *)buf, size);
+            continue;
+        }
+
+        if (e->reasm.chunk != e->ebyte->maxMessageSize()) {
+            frag_table_init(&e->reasm, e->ebyte->maxMessageSize(), FRAG_TIMEOUT_MS);
+        }
+        const uint8_t *frame, *frag, *msg;
+        size_t frame_len, frag_len, msg_len;
+        framing_decode_begin(&e->decoder, buf, size);
+        while (framing_decode_next(&e->decoder, &frame, &frame_len)) {
+            if (skip != NULL  &&  *skip > 0  &&  --*skip == 0) continue;
+            if (!e->ebyte->isReliable()) {
+                if (frag_table_push(&e->reasm, frame, frame_len, millis(), &msg, &msg_len)) {
+                    e->messages.push_back(std::string((const char *)msg, msg_len));
+                }
+                continue;
+            }
+            e->ebyte->beginReliableRx(frame, frame_len);
+            while (e->ebyte->nextReliableRx(&frag, &frag_len)) {
+                if (frag_table_push(&e->reasm, frag, frag_len, millis(), &msg, &msg_len)) {
+                    e->messages.push_back(std::string((const char *)msg, msg_len));
+                }
+            }
+        }
+    }
+}
+
+static std::string test_pattern(size_t len, uint8_t seed) {
+    std::string s(len, '\0');
+    for (size_t i = 0; i < len; i++) s[i] = (char)(seed + i * 7);
+    return s;
+}
+
+/**
+ * @brief Until both modules are idle, all taken in & put out, reading at both ends; 'skip' is of B, see test_pump()
+ */
+static void test_settle(int *skip = NULL) {
+    for (uint32_t t = 0; t < TEST_RUN_MAX_MS; t++) {
+        host_run_us(1000);
+        test_pump(&end_a);
+        test_pump(&end_b, skip);
+        if (hal_pin_read(end_a.sim.aux_pin) == HAL_HIGH  &&  hal_serial_available(&end_a.sim.uart) == 0
+        &&  hal_pin_read(end_b.sim.aux_pin) == HAL_HIGH  &&  hal_serial_available(&end_b.sim.uart) == 0) break;
+    }
+}
+
+static void test_drain_aux_edges(test_end_t *e) {
+    EbyteAuxEdge edge;
+    while (e->ebyte->popAuxEdge(edge));
+}
+
+
+// ----------------------------------------------------------------------------
+/**
+ * @brief As ebyte_setup(): begin, read the configuration, set it, read it back & the version
+ */
+static void test_config(test_end_t *e) {
+    CHECK(e->ebyte->begin());
+
+    ResponseStructContainer rc = e->ebyte->getConfiguration();
+    CHECK(rc.status.code == ResponseStatus::SUCCESS);
+    CHECK(rc.size == sizeof(Configuration));
+    Configuration cfg = *(Configuration *)rc.data;
+    rc.close();
+    CHECK(cfg.getHead() == 0xC0);
+    CHECK(e->ebyte->compareAddrChan(cfg, -1, 6));  // Defaults of the module
+    CHECK(e->ebyte->getAirBps() == 2000000);
+
+    e->ebyte->setAddrChanIntoConfig(cfg, 0x0FFF, 9);
+    e->ebyte->setSpeedIntoConfig(cfg, E34::AIR_RATE_1M, E34::UART_BPS_115200, E34::UART_PARITY_8N1);
+    e->ebyte->setOptionIntoConfig(cfg, E34::TXPOWER_20, E34::TXMODE_TRANS, E34::IO_PUSH_PULL);
+    CHECK(e->ebyte->setConfiguration(cfg, WRITE_CFG_PWR_DWN_LOSE).code == ResponseStatus::SUCCESS);
+    CHECK(e->ebyte->getAirBps() == 1000000);
+
+    rc = e->ebyte->getConfiguration();
+    CHECK(rc.status.code == ResponseStatus::SUCCESS);
+    Configuration back = *(Configuration *)rc.data;
+    rc.close();
+    CHECK(e->ebyte->compareAddrChan(back, 0x0FFF, 9));
+    CHECK(e->ebyte->compareSpeed(back, E34::AIR_RATE_1M, E34::UART_BPS_115200, E34::UART_PARITY_8N1));
+    CHECK(e->ebyte->compareOption(back, E34::TXPOWER_20, E34::TXMODE_TRANS, E34::IO_PUSH_PULL));
+
+    String info;
+    rc = e->ebyte->getVersionInfo(info);
+    CHECK(rc.status.code == ResponseStatus::SUCCESS);
+    CHECK(info.indexOf("series(34)") == 0);
+    rc.close();
+
+    // Wrong baud rate for the setting mode
+    e->ebyte->setBpsRate(TEST_DATA_BAUD);
+    rc = e->ebyte->getConfiguration();
+    CHECK(rc.status.code == ResponseStatus::ERR_WRONG_UART_CONFIG);
+}
+
+/**
+ * @brief AUX followed by its interrupt: edges & busy time of a message through the module
+ */
+static void test_aux() {
+    test_drain_aux_edges(&end_a);
+    EbyteAuxStat before = end_a.ebyte->getAuxStat();
+    end_b.raw.clear();
+
+    std::string msg = test_pattern(100, 1);
+    CHECK(end_a.ebyte->sendMessage(msg.data(), msg.size()).code == ResponseStatus::SUCCESS);
+    test_settle();
+
+    EbyteAuxStat after = end_a.ebyte->getAuxStat();
+    CHECK(after.busy_count == before.busy_count + 1);
+    CHECK(after.busy_last_us >= 100 * 10 * 1000000ull / TEST_DATA_BAUD);  // At least the UART time of the message
+    CHECK(after.edge_drops == before.edge_drops);
+
+    EbyteAuxEdge fall, rise;
+    CHECK(end_a.ebyte->popAuxEdge(fall)  &&  fall.level == HAL_LOW);
+    CHECK(end_a.ebyte->popAuxEdge(rise)  &&  rise.level == HAL_HIGH);
+    CHECK(rise.micros - fall.micros == after.busy_last_us);
+    CHECK(!end_a.ebyte->popAuxEdge(rise));
+    CHECK(end_a.ebyte->isAuxReady());
+
+    CHECK(end_b.raw == msg);
+}
+
+/**
+ * @brief FIFO credit: spent on a write, back once the module is idle; writes are pipelined without overflow.
+ */
+static void test_credit() {
+    CHECK(end_a.ebyte->txCredit() == E34_FIFO_SIZE);
+
+    std::string msg = test_pattern(200, 2);
+    CHECK(end_a.ebyte->sendMessage(msg.data(), msg.size()).code == ResponseStatus::SUCCESS);
+    CHECK(end_a.ebyte->txCredit() <= E34_FIFO_SIZE - 200);
+    test_settle();
+    CHECK(end_a.ebyte->txCredit() == E34_FIFO_SIZE);
+
+    // Back to back: each write waits for credit, not for the module to go idle.
+    end_b.raw.clear();
+    uint32_t overflows = end_a.sim.stat.fifo_overflows;
+    std::string all;
+    for (uint8_t i = 0; i < 10; i++) {
+        std::string m = test_pattern(200, 10 + i);
+        uint32_t t = micros();
+        CHECK(end_a.ebyte->sendMessage(m.data(), m.size()).code == ResponseStatus::SUCCESS);
+        CHECK(micros() - t < EBYTE_NO_AUX_WAIT * 1000);
+        all += m;
+        test_pump(&end_b);
+    }
+    test_settle();
+    CHECK(end_a.sim.stat.fifo_overflows == overflows);
+    CHECK(end_b.raw == all);
+    CHECK(end_b.ebyte->getAuxStat().edge_drops == 0);  // Receive-only so far, its edges are nobody's
+}
+
+/**
+ * @brief A message larger than a packet: framed fragments through queueTx, reassembled at the other end
+ */
+static void test_fragments() {
+    end_a.ebyte->setFraming(true);
+    end_b.ebyte->setFraming(true);
+    end_b.messages.clear();
+
+    std::string msg = test_pattern(500, 3);
+    CHECK(end_a.ebyte->fragmentMessageQueueTx(msg.data(), msg.size()).code == ResponseStatus::SUCCESS);
+    CHECK(end_a.ebyte->lengthMessageQueueTx() == (500 + end_a.ebyte->maxMessageSize() - 1) / end_a.ebyte->maxMessageSize());
+    while (end_a.ebyte->hasMessageQueueTx()) {
+        CHECK(end_a.ebyte->processMessageQueueTx() > 0);
+    }
+    test_settle();
+    CHECK(end_b.messages.size() == 1  &&  end_b.messages[0] == msg);
+
+    // All fragments or nothing
+    std::string big(FRAG_MAX_MESSAGE + 1, 'x');
+    CHECK(end_a.ebyte->fragmentMessageQueueTx(big.data(), big.size()).code == ResponseStatus::ERR_PACKET_TOO_BIG);
+    CHECK(end_a.ebyte->lengthMessageQueueTx() == 0);
+}
+
+/**
+ * @brief FEC: a data fragment lost on air is rebuilt from the parity.
+ */
+static void test_fec() {
+    end_a.ebyte->setFec(3, 4);
+    end_b.ebyte->setFec(3, 4);
+    end_b.messages.clear();
+    uint32_t recovered = end_b.reasm.stat.recovered;
+
+    std::string msg = test_pattern(2 * end_a.ebyte->maxMessageSize() + 10, 4);  // 3 data fragments, within FRAG_MAX_MESSAGE
+    CHECK(end_a.ebyte->fragmentMessageQueueTx(msg.data(), msg.size()).code == ResponseStatus::SUCCESS);
+    CHECK(end_a.ebyte->lengthMessageQueueTx() == 3 + 1);
+    while (end_a.ebyte->hasMessageQueueTx()) end_a.ebyte->processMessageQueueTx();
+    int skip = 2;  // The second data fragment
+    test_settle(&skip);
+    CHECK(end_b.messages.size() == 1  &&  end_b.messages[0] == msg);
+    CHECK(end_b.reasm.stat.recovered == recovered + 1);
+
+    end_a.ebyte->setFec(0, 0);
+    end_b.ebyte->setFec(0, 0);
+}
+
+/**
+ * @brief Selective-repeat ARQ over a lossy channel: everything, in order, once
+ */
+static void test_arq() {
+    end_a.ebyte->setReliable(true);
+    end_b.ebyte->setReliable(true);
+    end_b.messages.clear();
+    test_channel.loss = TEST_ARQ_LOSS;
+    srand(1);
+
+    std::vector<std::string> sent;
+    uint32_t start = millis();
+    while (millis() - start < TEST_RUN_MAX_MS) {
+        if (sent.size() < TEST_ARQ_MESSAGES  &&  end_a.ebyte->availableMessageQueueTx() > 0) {
+            sent.push_back(test_pattern(100, 50 + sent.size()));
+            CHECK(end_a.ebyte->fragmentMessageQueueTx(sent.back().data(), sent.back().size()).code == ResponseStatus::SUCCESS);
+        }
+        if (end_a.ebyte->hasMessageQueueTx()) end_a.ebyte->processMessageQueueTx();
+        if (end_b.ebyte->hasMessageQueueTx()) end_b.ebyte->processMessageQueueTx();  // ACKs
+        host_run_us(1000);
+        test_pump(&end_a);
+        test_pump(&end_b);
+        if (end_b.messages.size() == TEST_ARQ_MESSAGES  &&  !end_a.ebyte->hasMessageQueueTx()) break;
+    }
+
+    CHECK(end_b.messages == sent);
+    CHECK(end_a.ebyte->getArq().stat.retransmits > 0);
+    CHECK(end_a.ebyte->getArq().stat.gave_up == 0);
+    CHECK(end_a.sim.stat.losses + end_b.sim.stat.losses > 0);
+
+    test_channel.loss = 0;
+    end_a.ebyte->setReliable(false);
+    end_b.ebyte->setReliable(false);
+    end_a.ebyte->setFraming(false);
+    end_b.ebyte->setFraming(false);
+}
+
+/**
+ * @brief TX lanes: strict priority, weighted-fair share, latest-value coalescing & a full lane
+ */
+static void test_lanes() {
+    EbyteModule *e = end_a.ebyte;
+    uint8_t buf[EBYTE_LANE_MESSAGE_SIZE];
+    size_t len;
+    uint8_t lane;
+
+    // Strict lane first, whatever came before it
+    CHECK(e->enqueueLaneTx(EBYTE_LANE_BULK, "b", 1).code == ResponseStatus::SUCCESS);
+    CHECK(e->enqueueLaneTx(EBYTE_LANE_TELEMETRY, "t", 1).code == ResponseStatus::SUCCESS);
+    CHECK(e->enqueueLaneTx(EBYTE_LANE_CONTROL, "c", 1).code == ResponseStatus::SUCCESS);
+    CHECK(e->lengthLanesTx() == 3);
+    CHECK(e->dequeueLaneTx(buf, sizeof(buf), len, &lane).code == ResponseStatus::SUCCESS);
+    CHECK(lane == EBYTE_LANE_CONTROL  &&  len == 1  &&  buf[0] == 'c');
+    while (e->dequeueLaneTx(buf, sizeof(buf), len).code == ResponseStatus::SUCCESS);
+    CHECK(e->lengthLanesTx() == 0);
+
+    // 3 to 1, by EBYTE_LANE_WEIGHTS, of a quantum each; the round may start at either lane.
+    std::string m(EBYTE_LANE_QUANTUM, 'm');
+    for (int i = 0; i < 6; i++) {
+        e->enqueueLaneTx(EBYTE_LANE_TELEMETRY, m.data(), m.size());
+        e->enqueueLaneTx(EBYTE_LANE_BULK, m.data(), m.size());
+    }
+    int telemetry = 0;
+    for (int i = 0; i < 8; i++) {
+        CHECK(e->dequeueLaneTx(buf, sizeof(buf), len, &lane).code == ResponseStatus::SUCCESS);
+        if (lane == EBYTE_LANE_TELEMETRY) telemetry++;
+    }
+    CHECK(telemetry == 6);
+    while (e->dequeueLaneTx(buf, sizeof(buf), len).code == ResponseStatus::SUCCESS);
+
+    // The newer value replaces the queued one, in its place.
+    uint32_t coalesced = e->getLaneStat(EBYTE_LANE_TELEMETRY).coalesced;
+    e->enqueueLaneTx(EBYTE_LANE_TELEMETRY, "old", 3, NULL, 0, 42);
+    e->enqueueLaneTx(EBYTE_LANE_TELEMETRY, "other", 5, NULL, 0, 43);
+    e->enqueueLaneTx(EBYTE_LANE_TELEMETRY, "new", 3, NULL, 0, 42);
+    CHECK(e->lengthLaneTx(EBYTE_LANE_TELEMETRY) == 2);
+    CHECK(e->getLaneStat(EBYTE_LANE_TELEMETRY).coalesced == coalesced + 1);
+    CHECK(e->dequeueLaneTx(buf, sizeof(buf), len).code == ResponseStatus::SUCCESS);
+    CHECK(len == 3  &&  memcmp(buf, "new", 3) == 0);
+    while (e->dequeueLaneTx(buf, sizeof(buf), len).code == ResponseStatus::SUCCESS);
+
+    // Full lane: dropped & counted; head & body are joined.
+    uint32_t drops = e->getLaneStat(EBYTE_LANE_BULK).drops;
+    for (int i = 0; i < EBYTE_LANE_SLOTS; i++) {
+        CHECK(e->enqueueLaneTx(EBYTE_LANE_BULK, "he", 2, "ad", 2).code == ResponseStatus::SUCCESS);
+    }
+    CHECK(e->enqueueLaneTx(EBYTE_LANE_BULK, "x", 1).code == ResponseStatus::ERR_QUEUE_FULL);
+    CHECK(e->getLaneStat(EBYTE_LANE_BULK).drops == drops + 1);
+    CHECK(e->dequeueLaneTx(buf, sizeof(buf), len).code == ResponseStatus::SUCCESS);
+    CHECK(len == 4  &&  memcmp(buf, "head", 4) == 0);
+    while (e->dequeueLaneTx(buf, sizeof(buf), len).code == ResponseStatus::SUCCESS);
+    CHECK(e->dequeueLaneTx(buf, sizeof(buf), len).code == ResponseStatus::ERR_QUEUE_EMPTY);
+
+    std::string big(EBYTE_LANE_MESSAGE_SIZE + 1, 'x');
+    CHECK(e->enqueueLaneTx(EBYTE_LANE_BULK, big.data(), big.size()).code == ResponseStatus::ERR_PACKET_TOO_BIG);
+}
+
+/**
+ * @brief Pooled receive: into a queueTx block, sent back in place, and a miss without a block
+ */
+static void test_pool() {
+    EbyteModule *e = end_b.ebyte;
+    EbytePacket none;
+    uint32_t misses = e->getBufferStat().pool_misses;
+    CHECK(e->receivePacket(none).code == ResponseStatus::ERR_QUEUE_FULL);
+    CHECK(e->getBufferStat().pool_misses == misses + 1);
+
+    size_t free = e->availableMessageQueueTx();
+    EbytePacket pkt;
+    CHECK(e->allocPacket(pkt)  &&  e->availableMessageQueueTx() == free - 1);
+
+    std::string msg = test_pattern(40, 9);
+    CHECK(end_a.ebyte->fragmentMessageQueueTx(msg.data(), msg.size()).code == ResponseStatus::SUCCESS);
+    while (end_a.ebyte->hasMessageQueueTx()) end_a.ebyte->processMessageQueueTx();
+    for (uint32_t t = 0; t < TEST_RUN_MAX_MS  &&  e->available() == 0; t++) host_run_us(1000);
+    host_run_us(10000);  // The rest of the packet
+    CHECK(e->receivePacket(pkt).code == ResponseStatus::SUCCESS);
+    CHECK(std::string((const char *)pkt.data, pkt.size) == msg);
+
+    // The queue keeps the block past its release, with no copy.
+    uint32_t copied = e->getBufferStat().copy_bytes;
+    CHECK(e->enqueuePacketTx(pkt, pkt.size).code == ResponseStatus::SUCCESS);
+    e->releasePacket(pkt);
+    CHECK(pkt.block < 0  &&  e->lengthMessageQueueTx() == 1  &&  e->availableMessageQueueTx() == free - 1);
+    CHECK(e->getBufferStat().copy_bytes == copied);
+
+    end_a.raw.clear();
+    while (e->hasMessageQueueTx()) e->processMessageQueueTx();
+    test_settle();
+    CHECK(end_a.raw == msg);
+    CHECK(e->availableMessageQueueTx() == free);
+}
+
+/**
+ * @brief Slab queue: FIFO order, full, and a block kept past its dequeue
+ */
+static void test_queue() {
+    static uint8_t storage[SQ_STORAGE_SIZE(16, 4)];
+    slab_queue_t q;
+    sq_init(&q, storage, 16, 4);
+
+    CHECK(sq_enqueue(&q, "0123456789abcdefX", 17) == SQ_TOO_BIG);
+    for (char c = 'a'; c < 'e'; c++) CHECK(sq_enqueue(&q, &c, 1) == SQ_OK);
+    char c = 'e';
+    CHECK(sq_enqueue(&q, &c, 1) == SQ_FULL);
+    CHECK(sq_length(&q) == 4  &&  sq_available(&q) == 0);
+
+    char out;
+    CHECK(sq_dequeue(&q, &out, 1) == 1  &&  out == 'a');
+    int b = sq_item(&q, 0);  // 'b', kept
+    sq_retain(&q, b);
+    CHECK(sq_dequeue(&q, &out, 1) == 1  &&  out == 'b');
+    CHECK(sq_available(&q) == 1);  // Not back until released
+    CHECK(sq_block(&q, b)[0] == 'b');
+    sq_release(&q, b);
+    CHECK(sq_available(&q) == 2);
+    while (sq_dequeue(&q, &out, 1) > 0);
+    CHECK(sq_length(&q) == 0  &&  sq_dequeue(&q, &out, 1) == 0);
+}
+
+/**
+ * @brief MAVLink parser: frames split anywhere, a bad CRC dropped, the stream resynced after it
+ */
+static void test_mavlink() {
+    uint8_t stream[3 * MAVLINK_MAX_FRAME_LEN];
+    uint8_t payload[40];
+    for (size_t i = 0; i < sizeof(payload); i++) payload[i] = i;
+    size_t len = 0, lens[3];
+    lens[0] = mavlink_pack(&stream[len], MAVLINK_STX_V1, 1, 1, 1, 0, payload, 9);  // HEARTBEAT
+    len += lens[0];
+    lens[1] = mavlink_pack(&stream[len], MAVLINK_STX_V2, 2, 1, 1, 33, payload, 28);  // GLOBAL_POSITION_INT
+    len += lens[1];
+    lens[2] = mavlink_pack(&stream[len], MAVLINK_STX_V2, 3, 1, 1, 30, payload, 28);  // ATTITUDE
+    len += lens[2];
+
+    for (size_t chunk = 1; chunk <= len; chunk += 7) {
+        mavlink_parser_t p;
+        mavlink_parser_init(&p);
+        std::string got;
+        for (size_t off = 0; off < len; off += chunk) {
+            size_t n = (len - off < chunk)? len - off : chunk;
+            mavlink_frame_t f;
+            mavlink_parse_begin(&p, &stream[off], n);
+            while (mavlink_parse_next(&p, &f)) {
+                CHECK(f.verified);
+                got.append((const char *)f.head, f.head_len);
+                got.append((const char *)f.body, f.body_len);
+            }
+        }
+        CHECK(p.stat.frames == 3  &&  p.stat.crc_errors == 0);
+        CHECK(got == std::string((const char *)stream, len));
+    }
+
+    stream[lens[0] + 12] ^= 0xFF;  // In the payload of the second
+    mavlink_parser_t p;
+    mavlink_parser_init(&p);
+    mavlink_frame_t f;
+    std::vector<uint32_t> ids;
+    mavlink_parse_begin(&p, stream, len);
+    while (mavlink_parse_next(&p, &f)) ids.push_back(f.msgid);
+    CHECK(p.stat.crc_errors == 1);
+    CHECK(ids.size() == 2  &&  ids[0] == 0  &&  ids[1] == 30);
+}
+
+
+int main() {
+    hal_linux_virtual_clock(true);
+    host_console(false);  // No debug printing from the module
+
+    test_open(&end_a, TEST_AUX_A);
+    test_open(&end_b, TEST_AUX_B);
+    sim_connect(&end_a.sim, &end_b.sim, &test_channel);
+    framing_decoder_init(&end_a.decoder);
+    framing_decoder_init(&end_b.decoder);
+    host_tick_hook(test_tick, NULL);
+
+    struct {
+        const char *name;
+        void (*fn)();
+    } tests[] = {
+        {"config", [] { test_config(&end_a); test_config(&end_b); }},
+        {"aux", test_aux},
+        {"credit", test_credit},
+        {"fragments", test_fragments},
+        {"fec", test_fec},
+        {"arq", test_arq},
+        {"lanes", test_lanes},
+        {"pool", test_pool},
+        {"queue", test_queue},
+        {"mavlink", test_mavlink},
+    };
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        int failures = test_failures;
+        tests[i].fn();
+        printf("%-10s: %s\n", tests[i].name, (test_failures == failures)? "ok" : "FAILED");
+    }
+
+    printf("%d checks, %d failed; %.1fs on the virtual clock\n", test_checks, test_failures, micros() / 1e6);
+    return (test_failures == 0)? 0 : 1;
+}
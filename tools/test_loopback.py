@@ -3,6 +3,15 @@
 Tool for test sending from E34 on /dev/ttyUSB?, and receive on another E34 on /dev/ttyUSB?.
 
 I have got this code from Berdy.
+
+Benchmark mode, 'bench': pipelined messages, each with its stream, sequence number & send timestamp,
+swept over payload sizes & send rates. Per direction: goodput, loss, duplicates, reordering, and
+the latency percentiles -- RTT on a single port looped back at the far end, or one-way with '--peer',
+both ports being on this host's clock. Results go to CSV and/or JSON, to compare firmware versions
+and gap settings across runs, labelled by '--tag'.
+
+Ex.> test_loopback.py bench /dev/ttyUSB0 115200 --sizes 32,128,255 --rates 10,50,0 --csv e34.csv
+Ex.> test_loopback.py bench /dev/ttyUSB0 115200 --peer /dev/ttyUSB1 --bidir --mavlink --json e34.json
 '''
 __author__ = "Berdy"
 # __copyright__ = "Copyright 2007, The Cogent Project"
@@ -15,6 +24,7 @@ __maintainer__ = "Pasakorn Tiwatthanont"
 # __status__ = "Production"
 
 
+import os
 import sys
 import serial
 import time
@@ -24,12 +34,34 @@ import random
 
 import difflib
 
+import argparse
+import csv
+import json
+import math
+import struct
+import threading
+import zlib
+
 
 TMO_PERIOD_SEC = 5.
 DELAY_CHECK_SEC = .01
 DELAY_INTER_FRAME_SEC = 0.
 DEFAULT_PAYLOAD_LEN = 279  # MAVLink v2 max length -- https://mavlink.io/en/guide/serialization.html
 
+BENCH_SIZES = '16,64,128,255'  # Payload bytes, the header below included
+BENCH_RATES = '10,50,100'      # Messages per second; 0 is as fast as the port takes them
+BENCH_SECONDS = 10.            # Sending, per trial
+DELAY_INTER_TRIAL_SEC = 1.     # For the link to drain, before the input is cleared
+BENCH_HEADER = struct.Struct('<BBIQ')  # stream, trial, seq, send time in ns
+BENCH_RAW_MAGIC = b'\xA5\x5A'  # Raw framing: magic, length (LE16), payload, CRC32 (LE32)
+BENCH_RAW_MAX = 4096
+MAVLINK_STX_V2 = 0xFD          # MAVLink framing: v2, msgid 0, for the firmware in the MAVLink message type
+MAVLINK_CRC_EXTRA = 50         # Of msgid 0, as Main/mavlink.cpp
+MAVLINK_MAX_PAYLOAD = 255
+CSV_FIELDS = ['tag', 'framing', 'latency', 'direction', 'size', 'rate', 'seconds',
+              'sent', 'received', 'lost', 'loss_pct', 'duplicates', 'reordered', 'stale', 'bad_bytes',
+              'offered_Bps', 'goodput_Bps', 'p50_ms', 'p90_ms', 'p99_ms', 'max_ms']
+
 
 # -----------------------------------------------------------------------------
 def print_info(str):
@@ -67,10 +99,307 @@ def compare_send_recv_bytes(sent_bytes : bytes, recv_bytes : bytes):
     return 1 if (temp.ratio() < 1.) else 0
 
 
+# -----------------------------------------------------------------------------
+def crc_x25(data : bytes, crc : int = 0xFFFF) -> int:
+    for b in data:
+        tmp = (b ^ crc) & 0xFF
+        tmp = (tmp ^ (tmp << 4)) & 0xFF
+        crc = ((crc >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4)) & 0xFFFF
+    return crc
+
+
+# -----------------------------------------------------------------------------
+def bench_pack(mavlink : bool, stream : int, trial : int, seq : int, size : int) -> bytes:
+    payload = BENCH_HEADER.pack(stream, trial, seq, time.monotonic_ns())
+    payload += generate_deterministic_string(seq, size - BENCH_HEADER.size)
+    if not mavlink:
+        return BENCH_RAW_MAGIC + struct.pack('<H', size) + payload + struct.pack('<I', zlib.crc32(payload))
+
+    header = struct.pack('<BBBBBBB', size, 0, 0, seq % 256, 1, 1, 0) + b'\x00\x00'  # msgid 0, as 3 bytes
+    crc = crc_x25(bytes([MAVLINK_CRC_EXTRA]), crc_x25(header + payload))
+    return bytes([MAVLINK_STX_V2]) + header + payload + struct.pack('<H', crc)
+
+
+# -----------------------------------------------------------------------------
+class BenchParser:
+    '''
+    Bench messages out of a byte stream, either framing; anything else is skipped a byte at a time,
+    e.g. RADIO_STATUS the firmware adds in the MAVLink message type.
+    '''
+    def __init__(self, mavlink : bool):
+        self.mavlink = mavlink
+        self.buf = bytearray()
+        self.bad_bytes = 0
+
+    def feed(self, data : bytes) -> list:
+        self.buf += data
+        messages = []
+        while True:
+            payload = self._next()
+            if payload is None:
+                return messages
+            if payload is not False:
+                messages.append(BENCH_HEADER.unpack_from(payload) + (len(payload),))
+
+    def _skip(self):
+        del self.buf[0]
+        self.bad_bytes += 1
+        return False
+
+    def _next(self):  # A payload, False on a skipped byte, or None when more is needed
+        start = self.buf.find(bytes([MAVLINK_STX_V2]) if self.mavlink else BENCH_RAW_MAGIC)
+        if start < 0:
+            keep = 0 if self.mavlink else min(1, len(self.buf))  # Half a magic, maybe
+            self.bad_bytes += len(self.buf) - keep
+            del self.buf[:len(self.buf) - keep]
+            return None
+        self.bad_bytes += start
+        del self.buf[:start]
+
+        if self.mavlink:
+            if len(self.buf) < 10:
+                return None
+            size = self.buf[1]
+            if self.buf[7:10] != b'\x00\x00\x00'  or  size < BENCH_HEADER.size:
+                return self._skip()
+            if len(self.buf) < 10 + size + 2:
+                return None
+            crc = crc_x25(bytes([MAVLINK_CRC_EXTRA]), crc_x25(self.buf[1:10 + size]))
+            if struct.unpack_from('<H', self.buf, 10 + size)[0] != crc:
+                return self._skip()
+            payload = bytes(self.buf[10:10 + size])
+            del self.buf[:10 + size + 2]
+            return payload
+
+        if len(self.buf) < 4:
+            return None
+        size = struct.unpack_from('<H', self.buf, 2)[0]
+        if size < BENCH_HEADER.size  or  size > BENCH_RAW_MAX:
+            return self._skip()
+        if len(self.buf) < 4 + size + 4:
+            return None
+        payload = bytes(self.buf[4:4 + size])
+        if struct.unpack_from('<I', self.buf, 4 + size)[0] != zlib.crc32(payload):
+            return self._skip()
+        del self.buf[:4 + size + 4]
+        return payload
+
+
+# -----------------------------------------------------------------------------
+class BenchStream:
+    '''
+    One direction of a trial: sent by one port, received on another, or the same one looped back.
+    '''
+    def __init__(self, name : str):
+        self.name = name
+        self.sent = 0
+        self.first_send = None
+        self.last_send = None
+        self.received = 0
+        self.received_bytes = 0
+        self.last_recv = None
+        self.duplicates = 0
+        self.reordered = 0
+        self.stale = 0  # Of an earlier trial
+        self.max_seq = -1
+        self.seen = set()
+        self.latencies = []  # ms
+
+    def on_receive(self, trial : int, seq : int, sent_ns : int, size : int, now_ns : int, current_trial : int):
+        if trial != current_trial:
+            self.stale += 1
+            return
+        if seq in self.seen:
+            self.duplicates += 1
+            return
+        self.seen.add(seq)
+        if seq < self.max_seq:
+            self.reordered += 1
+        self.max_seq = max(self.max_seq, seq)
+        self.received += 1
+        self.received_bytes += size
+        self.last_recv = now_ns / 1e9
+        self.latencies.append((now_ns - sent_ns) / 1e6)
+
+
+# -----------------------------------------------------------------------------
+def percentile(values : list, p : float):
+    if len(values) == 0:
+        return None
+    values = sorted(values)
+    return round(values[max(0, min(len(values) - 1, math.ceil(p / 100. * len(values)) - 1))], 3)
+
+
+# -----------------------------------------------------------------------------
+def bench_sender(ser, stream : BenchStream, index : int, trial : int, args, size : int, rate : float):
+    start = time.monotonic()  # As the timestamps, for goodput against the receive time
+    stream.first_send = start
+    seq = 0
+    while (time.monotonic() - start) < args.seconds:
+        ser.write(bench_pack(args.mavlink, index, trial, seq, size))
+        seq += 1
+        stream.sent = seq
+        stream.last_send = time.monotonic()
+        if rate > 0:
+            time.sleep(max(0., start + seq / rate - time.monotonic()))
+
+
+# -----------------------------------------------------------------------------
+def bench_reader(ser, parser : BenchParser, streams : list, trial : int, stop : threading.Event):
+    while not stop.is_set():
+        data = ser.read(max(1, ser.in_waiting))  # Up to the port's timeout
+        if len(data) == 0:
+            continue
+        now_ns = time.monotonic_ns()
+        for (index, msg_trial, seq, sent_ns, size) in parser.feed(data):
+            if index < len(streams):
+                streams[index].on_receive(msg_trial, seq, sent_ns, size, now_ns, trial)
+
+
+# -----------------------------------------------------------------------------
+def bench_trial(ports : list, args, trial : int, size : int, rate : float) -> list:
+    '''
+    ports[0] sends stream 0; it is received on ports[1], or on ports[0] itself, looped back.
+    With '--bidir', ports[1] sends stream 1 to ports[0].
+    '''
+    names = ['A->B', 'B->A'] if len(ports) > 1 else ['A->A']
+    streams = [BenchStream(name) for name in names[:2 if args.bidir else 1]]
+
+    time.sleep(DELAY_INTER_TRIAL_SEC)
+    for ser in ports:
+        ser.reset_input_buffer()
+
+    stop = threading.Event()
+    parsers = [BenchParser(args.mavlink) for ser in ports]
+    readers = [threading.Thread(target=bench_reader, args=(ser, parser, streams, trial, stop))
+               for (ser, parser) in zip(ports, parsers)]
+    senders = [threading.Thread(target=bench_sender, args=(ports[i], streams[i], i, trial, args, size, rate))
+               for i in range(len(streams))]
+    for t in readers + senders:
+        t.start()
+    for t in senders:
+        t.join()
+
+    drain_start = time.time()  # For what is still in flight
+    while (time.time() - drain_start) < TMO_PERIOD_SEC:
+        if all(s.received >= s.sent for s in streams):
+            break
+        time.sleep(DELAY_CHECK_SEC)
+    stop.set()
+    for t in readers:
+        t.join()
+
+    rows = []
+    bad_bytes = [parser.bad_bytes for parser in parsers]
+    for (i, s) in enumerate(streams):
+        send_sec = max(s.last_send - s.first_send, 1e-6) if s.sent > 0 else 1e-6
+        recv_sec = max(s.last_recv - s.first_send, 1e-6) if s.received > 0 else 1e-6
+        lost = s.sent - s.received
+        rows.append({
+            'tag': args.tag,
+            'framing': 'mavlink' if args.mavlink else 'raw',
+            'latency': 'one-way' if len(ports) > 1 else 'rtt',
+            'direction': s.name,
+            'size': size,
+            'rate': rate,
+            'seconds': args.seconds,
+            'sent': s.sent,
+            'received': s.received,
+            'lost': lost,
+            'loss_pct': round(lost * 100. / s.sent, 3) if s.sent > 0 else 0.,
+            'duplicates': s.duplicates,
+            'reordered': s.reordered,
+            'stale': s.stale,
+            'bad_bytes': bad_bytes[(i + 1) % len(ports)],  # Of the receiving port
+            'offered_Bps': round(s.sent * size / send_sec, 1),
+            'goodput_Bps': round(s.received_bytes / recv_sec, 1),
+            'p50_ms': percentile(s.latencies, 50),
+            'p90_ms': percentile(s.latencies, 90),
+            'p99_ms': percentile(s.latencies, 99),
+            'max_ms': percentile(s.latencies, 100),
+        })
+    return rows
+
+
+# -----------------------------------------------------------------------------
+def bench_main(argv : list) -> int:
+    parser = argparse.ArgumentParser(prog='{} bench'.format(sys.argv[0]),
+                                     description='Pipelined throughput & latency, over a sweep of sizes and rates')
+    parser.add_argument('port')
+    parser.add_argument('baud', type=int)
+    parser.add_argument('--peer', help='The other end, on this host too; one-way latency instead of RTT')
+    parser.add_argument('--bidir', action='store_true', help='Both ends send at once; needs --peer')
+    parser.add_argument('--sizes', default=BENCH_SIZES, help='Payload bytes, comma separated')
+    parser.add_argument('--rates', default=BENCH_RATES, help='Messages/s, comma separated; 0 is unpaced')
+    parser.add_argument('--seconds', type=float, default=BENCH_SECONDS, help='Sending, per trial')
+    parser.add_argument('--mavlink', action='store_true', help='As MAVLink v2 frames, for the MAVLink message type')
+    parser.add_argument('--tag', default='', help='Label of the run, e.g. firmware version & gaps')
+    parser.add_argument('--csv', help='Append the results to')
+    parser.add_argument('--json', help='Write the run & its results to')
+    args = parser.parse_args(argv)
+
+    sizes = [int(x) for x in args.sizes.split(',')]
+    rates = [float(x) for x in args.rates.split(',')]
+    max_size = MAVLINK_MAX_PAYLOAD if args.mavlink else BENCH_RAW_MAX
+    if any(size < BENCH_HEADER.size  or  size > max_size for size in sizes):
+        print_info('sizes must be {}..{}'.format(BENCH_HEADER.size, max_size))
+        return 1
+    if args.bidir  and  args.peer is None:
+        print_info('--bidir needs --peer')
+        return 1
+    print_info(str(sys.argv))
+
+    ports = [serial.Serial(args.port, args.baud, timeout=DELAY_CHECK_SEC)]
+    if args.peer is not None:
+        ports.append(serial.Serial(args.peer, args.baud, timeout=DELAY_CHECK_SEC))
+
+    results = []
+    started = datetime.now().isoformat(timespec='seconds')
+    trial = 0
+    try:
+        for size in sizes:
+            for rate in rates:
+                rows = bench_trial(ports, args, trial % 256, size, rate)
+                trial += 1
+                for r in rows:
+                    latency = 'no latency' if r['p50_ms'] is None else '{} p50 {:.1f}ms p99 {:.1f}ms max {:.1f}ms'.format(
+                        r['latency'], r['p50_ms'], r['p99_ms'], r['max_ms'])
+                    print_info('size {} rate {:g}/s {}: sent {} received {} loss {:.2f}% dup {} reordered {} '
+                               'goodput {:.0f}B/s of {:.0f}B/s, {}'.format(
+                                   size, rate, r['direction'], r['sent'], r['received'], r['loss_pct'],
+                                   r['duplicates'], r['reordered'], r['goodput_Bps'], r['offered_Bps'], latency))
+                results += rows
+    except KeyboardInterrupt:
+        print_info('interrupted; the trials so far are kept')
+    finally:
+        for ser in ports:
+            ser.close()
+
+    if args.csv is not None:
+        new_file = not os.path.exists(args.csv)  # Appended, so runs add up to compare
+        with open(args.csv, 'a', newline='') as f:
+            writer = csv.DictWriter(f, fieldnames=CSV_FIELDS)
+            if new_file:
+                writer.writeheader()
+            writer.writerows(results)
+        print_info('csv: ' + args.csv)
+    if args.json is not None:
+        run = {'tag': args.tag, 'started': started, 'argv': sys.argv, 'port': args.port, 'peer': args.peer,
+               'baud': args.baud, 'framing': 'mavlink' if args.mavlink else 'raw', 'results': results}
+        with open(args.json, 'w') as f:
+            json.dump(run, f, indent=2)
+        print_info('json: ' + args.json)
+    return 0
+
+
 # -----------------------------------------------------------------------------
 if __name__ == '__main__':
+    if len(sys.argv) >= 2  and  sys.argv[1] == 'bench':
+        sys.exit(bench_main(sys.argv[2:]))
+
     if len(sys.argv) == 1:
         print('Ex.> {} <port> <baud> [payload_len | {}]'.format(sys.argv[0], DEFAULT_PAYLOAD_LEN))
+        print('Ex.> {} bench <port> <baud> [--help]'.format(sys.argv[0]))
     serial_port = sys.argv[1]
     serial_baud = sys.argv[2]
     payload_len = int(sys.argv[3]) if len(sys.argv) >= 4 else DEFAULT_PAYLOAD_LEN